@@ -20,7 +20,7 @@ fi
 
 # Компилируем
 echo "Компиляция..."
-g++ -std=c++17 -I./deps -I./include src/main.cpp -lsqlite3 -pthread -o HotelBooking
+g++ -std=c++17 -I./deps -I./include src/main.cpp -lsqlite3 -lz -pthread -o HotelBooking
 
 if [ $? -eq 0 ]; then
     echo ""
@@ -0,0 +1,126 @@
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Класс стоимости маршрута: тяжелые страницы (списки, панели) ограничиваются
+// первыми, чтобы вход, контакты и формы продолжали обслуживаться при перегрузке
+enum class Cost {
+    Light,
+    Heavy
+};
+
+// Admission control перед обработчиками.
+// Для каждого класса стоимости задаются лимит одновременно выполняемых запросов
+// и предельное время ожидания в очереди соединений. Запрос сверх лимита или
+// пролежавший в очереди дольше срока сразу получает 503 с Retry-After,
+// не занимая поток работой, результат которой клиент, скорее всего, уже не ждет.
+class AdmissionControl {
+public:
+    enum class Decision {
+        Admitted,
+        OverConcurrency,
+        OverDeadline
+    };
+
+    struct Limits {
+        size_t max_concurrent = 0;                     // 0 - без ограничения
+        std::chrono::milliseconds max_queue_wait{0};   // 0 - без ограничения
+    };
+
+    struct ClassStats {
+        std::atomic<size_t> in_flight{0};
+        std::atomic<size_t> peak_in_flight{0};
+        std::atomic<uint64_t> admitted{0};
+        std::atomic<uint64_t> shed_concurrency{0};
+        std::atomic<uint64_t> shed_deadline{0};
+    };
+
+    // Разрешение на выполнение; освобождает слот класса при уничтожении
+    class Ticket {
+    private:
+        ClassStats* stats = nullptr;
+
+    public:
+        Ticket() = default;
+        explicit Ticket(ClassStats* class_stats) : stats(class_stats) {}
+        Ticket(Ticket&& other) noexcept : stats(other.stats) { other.stats = nullptr; }
+        Ticket& operator=(Ticket&& other) noexcept {
+            if (this != &other) {
+                release();
+                stats = other.stats;
+                other.stats = nullptr;
+            }
+            return *this;
+        }
+        Ticket(const Ticket&) = delete;
+        Ticket& operator=(const Ticket&) = delete;
+        ~Ticket() { release(); }
+
+        void release() {
+            if (stats) {
+                stats->in_flight.fetch_sub(1, std::memory_order_relaxed);
+                stats = nullptr;
+            }
+        }
+    };
+
+private:
+    Limits limits[2];
+    ClassStats stats[2];
+    int retry_after_seconds;
+
+    static size_t index(Cost cost) {
+        return cost == Cost::Heavy ? 1 : 0;
+    }
+
+public:
+    AdmissionControl(Limits light, Limits heavy, int retry_after = 2)
+        : limits{light, heavy}, retry_after_seconds(retry_after) {}
+
+    AdmissionControl(const AdmissionControl&) = delete;
+    AdmissionControl& operator=(const AdmissionControl&) = delete;
+
+    // queue_wait - сколько соединение ждало свободного потока
+    Decision try_admit(Cost cost, std::chrono::steady_clock::duration queue_wait, Ticket& ticket) {
+        const Limits& limit = limits[index(cost)];
+        ClassStats& s = stats[index(cost)];
+
+        if (limit.max_queue_wait.count() > 0 && queue_wait > limit.max_queue_wait) {
+            s.shed_deadline.fetch_add(1, std::memory_order_relaxed);
+            return Decision::OverDeadline;
+        }
+
+        size_t in_flight = s.in_flight.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (limit.max_concurrent != 0 && in_flight > limit.max_concurrent) {
+            s.in_flight.fetch_sub(1, std::memory_order_relaxed);
+            s.shed_concurrency.fetch_add(1, std::memory_order_relaxed);
+            return Decision::OverConcurrency;
+        }
+        size_t peak = s.peak_in_flight.load(std::memory_order_relaxed);
+        while (in_flight > peak && !s.peak_in_flight.compare_exchange_weak(peak, in_flight, std::memory_order_relaxed)) {
+        }
+        s.admitted.fetch_add(1, std::memory_order_relaxed);
+        ticket = Ticket(&s);
+        return Decision::Admitted;
+    }
+
+    int retry_after() const {
+        return retry_after_seconds;
+    }
+
+    const Limits& get_limits(Cost cost) const {
+        return limits[index(cost)];
+    }
+
+    const ClassStats& get_stats(Cost cost) const {
+        return stats[index(cost)];
+    }
+};
+
+#endif // ADMISSION_H
@@ -0,0 +1,105 @@
+#ifndef CHANGE_FEED_H
+#define CHANGE_FEED_H
+
+#include "database.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+// Уведомления о новых записях журнала изменений (таблица changes) для long-poll и SSE.
+// Database сообщает seq каждой новой записи; ожидающие запросы спят на условной
+// переменной и перечитывают журнал только когда в нем что-то появилось.
+// Каждый ожидающий занимает рабочий поток, поэтому их число ограничено: лишние
+// получают 503 сразу, а не вытесняют обычные страницы из пула.
+class ChangeFeed {
+public:
+    struct Stats {
+        std::atomic<uint64_t> published{0};
+        std::atomic<uint64_t> rejected{0};  // отказано: все места ожидания заняты
+    };
+
+private:
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    int64_t last_seq;
+    bool stopped = false;
+    size_t max_waiters;
+    std::atomic<size_t> waiters{0};
+    Stats stats;
+
+public:
+    ChangeFeed(Database& db, size_t max_waiters) : last_seq(db.get_last_change_seq()), max_waiters(max_waiters) {
+        db.add_change_listener([this](int64_t seq) { publish(seq); });
+    }
+
+    ~ChangeFeed() {
+        stop();
+    }
+
+    ChangeFeed(const ChangeFeed&) = delete;
+    ChangeFeed& operator=(const ChangeFeed&) = delete;
+
+    void publish(int64_t seq) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            last_seq = std::max(last_seq, seq);
+        }
+        ++stats.published;
+        changed.notify_all();
+    }
+
+    // Будит всех ожидающих; дальнейшие wait возвращаются сразу
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopped = true;
+        }
+        changed.notify_all();
+    }
+
+    bool is_stopped() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stopped;
+    }
+
+    int64_t last() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return last_seq;
+    }
+
+    // Ждет записи новее seen не дольше timeout; true - появилась
+    bool wait(int64_t seen, std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return changed.wait_for(lock, timeout, [this, seen] { return stopped || last_seq > seen; }) && !stopped;
+    }
+
+    // Место ожидания на время запроса или потока SSE; nullptr - мест нет
+    std::shared_ptr<void> acquire() {
+        size_t current = waiters.load();
+        do {
+            if (current >= max_waiters) {
+                ++stats.rejected;
+                return nullptr;
+            }
+        } while (!waiters.compare_exchange_weak(current, current + 1));
+        return std::shared_ptr<void>(static_cast<void*>(this), [this](void*) { --waiters; });
+    }
+
+    size_t get_waiters() const {
+        return waiters.load();
+    }
+
+    size_t get_max_waiters() const {
+        return max_waiters;
+    }
+
+    const Stats& get_stats() const {
+        return stats;
+    }
+};
+
+#endif // CHANGE_FEED_H
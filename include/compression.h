@@ -0,0 +1,389 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include "../deps/httplib.h"
+#include <zlib.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class ContentEncoding {
+    Identity,
+    Gzip,
+    Deflate  // "deflate" в HTTP - поток zlib (RFC 1950)
+};
+
+// Неизменный фрагмент страницы, сжатый один раз при запуске: сырой поток deflate,
+// завершенный Z_SYNC_FLUSH (без последнего блока, выровнен по байту), поэтому его
+// можно вставлять в середину любого ответа как есть.
+struct DeflateFragment {
+    std::string_view text;
+    std::string compressed;
+    uLong crc = 0;
+    uLong adler = 0;
+
+    DeflateFragment(std::string_view source, int level) : text(source) {
+        z_stream z{};
+        if (deflateInit2(&z, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw std::runtime_error("deflateInit2 failed");
+        }
+        compressed.resize(deflateBound(&z, static_cast<uLong>(text.size())) + 16);
+        z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(text.data()));
+        z.avail_in = static_cast<uInt>(text.size());
+        z.next_out = reinterpret_cast<Bytef*>(&compressed[0]);
+        z.avail_out = static_cast<uInt>(compressed.size());
+        deflate(&z, Z_SYNC_FLUSH);
+        compressed.resize(compressed.size() - z.avail_out);
+        deflateEnd(&z);
+        crc = crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(text.data()), static_cast<uInt>(text.size()));
+        adler = adler32(adler32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(text.data()), static_cast<uInt>(text.size()));
+    }
+};
+
+// Потоковое сжатие gzip/zlib. Вывод отдается через sink кусками, что подходит и для
+// сборки ответа в строку, и для chunked-ответов httplib. Между динамическими данными
+// можно вставлять готовые DeflateFragment: после фрагмента компрессор сбрасывается и
+// получает текст фрагмента как словарь, так что следующие данные ссылаются на него.
+class GzipStream {
+public:
+    using Sink = std::function<bool(const char* data, size_t size)>;
+
+private:
+    static constexpr size_t OUT_CHUNK = 16 * 1024;
+
+    ContentEncoding encoding;
+    Sink sink;
+    z_stream z{};
+    uLong checksum;
+    uLong total = 0;
+    char out[OUT_CHUNK];
+    bool ok = true;
+
+    void emit(const char* data, size_t size) {
+        if (ok && size != 0) {
+            ok = sink(data, size);
+        }
+    }
+
+    void run(int flush) {
+        do {
+            z.next_out = reinterpret_cast<Bytef*>(out);
+            z.avail_out = OUT_CHUNK;
+            deflate(&z, flush);
+            emit(out, OUT_CHUNK - z.avail_out);
+        } while (z.avail_out == 0);
+    }
+
+    void update_checksum(const char* data, size_t size) {
+        const Bytef* bytes = reinterpret_cast<const Bytef*>(data);
+        checksum = encoding == ContentEncoding::Gzip ? crc32(checksum, bytes, static_cast<uInt>(size))
+                                                      : adler32(checksum, bytes, static_cast<uInt>(size));
+    }
+
+public:
+    GzipStream(ContentEncoding content_encoding, int level, Sink output)
+        : encoding(content_encoding), sink(std::move(output)) {
+        if (deflateInit2(&z, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw std::runtime_error("deflateInit2 failed");
+        }
+        if (encoding == ContentEncoding::Gzip) {
+            checksum = crc32(0L, Z_NULL, 0);
+            static const char header[10] = {'\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 0, 3};
+            emit(header, sizeof(header));
+        } else {
+            checksum = adler32(0L, Z_NULL, 0);
+            static const char header[2] = {'\x78', '\x9c'};
+            emit(header, sizeof(header));
+        }
+    }
+
+    GzipStream(const GzipStream&) = delete;
+    GzipStream& operator=(const GzipStream&) = delete;
+
+    ~GzipStream() {
+        deflateEnd(&z);
+    }
+
+    // false - получатель закрыл соединение
+    bool write(std::string_view data) {
+        while (!data.empty() && ok) {
+            size_t part = std::min<size_t>(data.size(), 1u << 30);
+            update_checksum(data.data(), part);
+            total += static_cast<uLong>(part);
+            z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+            z.avail_in = static_cast<uInt>(part);
+            run(Z_NO_FLUSH);
+            data.remove_prefix(part);
+        }
+        return ok;
+    }
+
+    // Отдает накопленное сжатое содержимое получателю (для chunked-ответов)
+    bool flush() {
+        run(Z_SYNC_FLUSH);
+        return ok;
+    }
+
+    bool write_fragment(const DeflateFragment& fragment) {
+        run(Z_SYNC_FLUSH);
+        emit(fragment.compressed.data(), fragment.compressed.size());
+        uLong length = static_cast<uLong>(fragment.text.size());
+        checksum = encoding == ContentEncoding::Gzip ? crc32_combine(checksum, fragment.crc, length)
+                                                      : adler32_combine(checksum, fragment.adler, length);
+        total += length;
+        deflateReset(&z);
+        size_t dictionary = std::min<size_t>(fragment.text.size(), 32 * 1024);
+        deflateSetDictionary(&z, reinterpret_cast<const Bytef*>(fragment.text.data() + fragment.text.size() - dictionary),
+                             static_cast<uInt>(dictionary));
+        return ok;
+    }
+
+    bool finish() {
+        run(Z_FINISH);
+        unsigned char trailer[8];
+        if (encoding == ContentEncoding::Gzip) {
+            for (int i = 0; i < 4; ++i) trailer[i] = static_cast<unsigned char>(checksum >> (8 * i));
+            for (int i = 0; i < 4; ++i) trailer[4 + i] = static_cast<unsigned char>(total >> (8 * i));
+            emit(reinterpret_cast<const char*>(trailer), 8);
+        } else {
+            for (int i = 0; i < 4; ++i) trailer[i] = static_cast<unsigned char>(checksum >> (8 * (3 - i)));
+            emit(reinterpret_cast<const char*>(trailer), 4);
+        }
+        return ok;
+    }
+};
+
+// Согласование и сжатие ответов.
+// Сжимаются текстовые ответы не меньше порога, если клиент принимает gzip или deflate.
+// Страницы из base_template сжимаются с подстановкой заранее сжатых неизменных частей
+// макета (шапка, меню, подвал): сжимать заново приходится только заголовок и содержимое.
+class Compression {
+public:
+    struct Stats {
+        std::atomic<uint64_t> compressed{0};
+        std::atomic<uint64_t> skipped_small{0};
+        std::atomic<uint64_t> bytes_in{0};
+        std::atomic<uint64_t> bytes_out{0};
+        std::atomic<uint64_t> fragment_bytes{0};  // байт макета, взятых готовыми
+    };
+
+private:
+    int level;
+    size_t min_size;
+    // Слоты макета по порядку; в слоте - взаимоисключающие варианты (например, меню
+    // гостя, пользователя и организации)
+    std::vector<std::vector<std::unique_ptr<DeflateFragment>>> layout;
+    Stats stats;
+
+    static constexpr size_t SEARCH_WINDOW = 1024;  // динамический текст между частями макета
+
+    static bool compressible(const std::string& content_type) {
+        return content_type.rfind("text/", 0) == 0 || content_type.rfind("application/json", 0) == 0 ||
+               content_type.rfind("application/javascript", 0) == 0;
+    }
+
+    // Находит следующий слот макета в html начиная с pos
+    const DeflateFragment* match(std::string_view html, size_t pos, size_t slot, size_t& at) const {
+        const DeflateFragment* best = nullptr;
+        at = std::string_view::npos;
+        bool first = slot == 0;
+        bool last = slot + 1 == layout.size();
+        for (const auto& fragment : layout[slot]) {
+            std::string_view text = fragment->text;
+            size_t found = std::string_view::npos;
+            if (first) {
+                if (html.substr(0, text.size()) == text) found = 0;
+            } else if (last) {
+                if (html.size() >= pos + text.size() && html.substr(html.size() - text.size()) == text) {
+                    found = html.size() - text.size();
+                }
+            } else {
+                found = html.substr(pos, SEARCH_WINDOW + text.size()).find(text);
+                if (found != std::string_view::npos) found += pos;
+            }
+            if (found != std::string_view::npos && found >= pos && found < at) {
+                at = found;
+                best = fragment.get();
+            }
+        }
+        return best;
+    }
+
+public:
+    // level 0 - сжатие выключено
+    Compression(int compression_level, size_t threshold) : level(compression_level), min_size(threshold) {}
+
+    Compression(const Compression&) = delete;
+    Compression& operator=(const Compression&) = delete;
+
+    // Принимает ли клиент кодировку по заголовку Accept-Encoding (q=0 - отказ)
+    static bool accepts(const std::string& header, std::string_view coding) {
+        size_t pos = 0;
+        while (pos < header.size()) {
+            size_t end = header.find(',', pos);
+            if (end == std::string::npos) end = header.size();
+            std::string_view item(header.data() + pos, end - pos);
+            pos = end + 1;
+            while (!item.empty() && std::isspace(static_cast<unsigned char>(item.front()))) item.remove_prefix(1);
+            size_t semicolon = item.find(';');
+            std::string_view name = item.substr(0, semicolon);
+            while (!name.empty() && std::isspace(static_cast<unsigned char>(name.back()))) name.remove_suffix(1);
+            if (name.size() != coding.size() || !std::equal(name.begin(), name.end(), coding.begin(), [](char a, char b) {
+                    return std::tolower(static_cast<unsigned char>(a)) == b;
+                })) {
+                continue;
+            }
+            if (semicolon != std::string_view::npos) {
+                size_t q = item.find("q=", semicolon);
+                if (q != std::string_view::npos && std::atof(std::string(item.substr(q + 2)).c_str()) <= 0) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // Сжимает части макета один раз; вызывается до запуска сервера
+    void set_layout(const std::vector<std::vector<std::string_view>>& slots) {
+        layout.clear();
+        if (level == 0) {
+            return;
+        }
+        for (const auto& slot : slots) {
+            layout.emplace_back();
+            for (std::string_view text : slot) {
+                layout.back().push_back(std::make_unique<DeflateFragment>(text, level));
+            }
+        }
+    }
+
+    bool enabled() const {
+        return level != 0;
+    }
+
+    // Кодировка, которую принимает клиент; gzip предпочтительнее
+    ContentEncoding negotiate(const httplib::Request& req) const {
+        if (level == 0 || !req.has_header("Accept-Encoding")) {
+            return ContentEncoding::Identity;
+        }
+        std::string header = req.get_header_value("Accept-Encoding");
+        if (accepts(header, "gzip")) return ContentEncoding::Gzip;
+        if (accepts(header, "deflate")) return ContentEncoding::Deflate;
+        return ContentEncoding::Identity;
+    }
+
+    static const char* encoding_name(ContentEncoding encoding) {
+        return encoding == ContentEncoding::Gzip ? "gzip" : "deflate";
+    }
+
+    // Сжатие тела страницы с подстановкой частей макета
+    std::string compress(std::string_view body, ContentEncoding encoding) {
+        std::string result;
+        result.reserve(body.size() / 4 + 64);
+        GzipStream stream(encoding, level, [&result](const char* data, size_t size) {
+            result.append(data, size);
+            return true;
+        });
+        size_t pos = 0;
+        uint64_t reused = 0;
+        for (size_t slot = 0; slot < layout.size(); ++slot) {
+            size_t at = 0;
+            const DeflateFragment* fragment = match(body, pos, slot, at);
+            if (!fragment) {
+                continue;
+            }
+            stream.write(body.substr(pos, at - pos));
+            stream.write_fragment(*fragment);
+            pos = at + fragment->text.size();
+            reused += fragment->text.size();
+        }
+        stream.write(body.substr(pos));
+        stream.finish();
+        stats.fragment_bytes.fetch_add(reused, std::memory_order_relaxed);
+        return result;
+    }
+
+    // Сжимает готовый ответ, если это выгодно и клиент согласен
+    void apply(const httplib::Request& req, httplib::Response& res) {
+        if (level == 0 || res.body.empty() || res.has_header("Content-Encoding") ||
+            !compressible(res.get_header_value("Content-Type"))) {
+            return;
+        }
+        res.set_header("Vary", "Accept-Encoding");
+        ContentEncoding encoding = negotiate(req);
+        if (encoding == ContentEncoding::Identity) {
+            return;
+        }
+        if (res.body.size() < min_size) {
+            stats.skipped_small.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        std::string compressed = compress(res.body, encoding);
+        stats.compressed.fetch_add(1, std::memory_order_relaxed);
+        stats.bytes_in.fetch_add(res.body.size(), std::memory_order_relaxed);
+        stats.bytes_out.fetch_add(compressed.size(), std::memory_order_relaxed);
+        res.body = std::move(compressed);
+        res.set_header("Content-Encoding", encoding_name(encoding));
+        // Сжатое представление - другие байты: сильный ETag получает суффикс кодировки
+        if (res.has_header("ETag")) {
+            std::string etag = res.get_header_value("ETag");
+            if (etag.size() >= 2 && etag.back() == '"') {
+                etag.insert(etag.size() - 1, std::string("-") + encoding_name(encoding));
+                res.headers.erase("ETag");
+                res.set_header("ETag", etag);
+            }
+        }
+    }
+
+    // Chunked-ответ: producer пишет данные в GzipStream (или напрямую, если клиент
+    // не принимает сжатие) и возвращается, когда ответ сформирован полностью
+    void stream(const httplib::Request& req, httplib::Response& res, const std::string& content_type,
+                std::function<void(const std::function<bool(std::string_view)>& write)> producer) {
+        ContentEncoding encoding = negotiate(req);
+        res.set_header("Vary", "Accept-Encoding");
+        if (encoding != ContentEncoding::Identity) {
+            res.set_header("Content-Encoding", encoding_name(encoding));
+        }
+        int stream_level = level;
+        res.set_chunked_content_provider(content_type, [encoding, stream_level, producer](size_t, httplib::DataSink& sink) {
+            if (encoding == ContentEncoding::Identity) {
+                producer([&sink](std::string_view data) {
+                    return sink.write(data.data(), data.size());
+                });
+            } else {
+                GzipStream gzip(encoding, stream_level, [&sink](const char* data, size_t size) {
+                    return sink.write(data, size);
+                });
+                producer([&gzip](std::string_view data) {
+                    return gzip.write(data) && gzip.flush();
+                });
+                gzip.finish();
+            }
+            sink.done();
+            return true;
+        });
+    }
+
+    const Stats& get_stats() const {
+        return stats;
+    }
+
+    int get_level() const {
+        return level;
+    }
+
+    size_t get_min_size() const {
+        return min_size;
+    }
+};
+
+#endif // COMPRESSION_H
@@ -0,0 +1,115 @@
+#ifndef CONDITIONAL_GET_H
+#define CONDITIONAL_GET_H
+
+#include "models.h"
+#include "../deps/httplib.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+// Условный GET (If-None-Match / If-Modified-Since) для страниц из строк базы.
+// ETag - хеш версий всех строк страницы (PageVersion), смешанный с поколением
+// процесса: после перезапуска (новый код или макет) старые ETag не совпадают.
+// Проверка выполняется до рендеринга, поэтому неизмененная страница стоит
+// одного запроса версий. Сжатый ответ получает ETag с суффиксом кодировки
+// (см. Compression::apply), сравнение идет по общей части.
+class ConditionalGet {
+private:
+    std::time_t started_at;
+    uint64_t generation;
+
+    static const char* const* day_names() {
+        static const char* const names[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+        return names;
+    }
+
+    static const char* const* month_names() {
+        static const char* const names[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+        return names;
+    }
+
+    // updated_at хранится в местном времени: "YYYY-MM-DD HH:MM:SS"
+    static std::time_t parse_local(const std::string& text) {
+        std::tm tm{};
+        if (std::sscanf(text.c_str(), "%d-%d-%d %d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 6) {
+            return 0;
+        }
+        tm.tm_year -= 1900;
+        tm.tm_mon -= 1;
+        tm.tm_isdst = -1;
+        return std::mktime(&tm);
+    }
+
+    // IMF-fixdate: "Sun, 06 Nov 1994 08:49:37 GMT"
+    static bool parse_http_date(const std::string& text, std::time_t& result) {
+        std::tm tm{};
+        char month[4] = {};
+        if (std::sscanf(text.c_str(), "%*3s, %d %3s %d %d:%d:%d GMT", &tm.tm_mday, month, &tm.tm_year, &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 6) {
+            return false;
+        }
+        tm.tm_mon = -1;
+        for (int i = 0; i < 12; ++i) {
+            if (std::strcmp(month, month_names()[i]) == 0) {
+                tm.tm_mon = i;
+            }
+        }
+        if (tm.tm_mon < 0) {
+            return false;
+        }
+        tm.tm_year -= 1900;
+        result = timegm(&tm);
+        return true;
+    }
+
+public:
+    ConditionalGet() : started_at(std::time(nullptr)) {
+        generation = static_cast<uint64_t>(started_at) * 0x9e3779b97f4a7c15ull;
+    }
+
+    static std::string http_date(std::time_t time) {
+        std::tm tm{};
+        gmtime_r(&time, &tm);
+        char text[40];
+        std::snprintf(text, sizeof(text), "%s, %02d %s %04d %02d:%02d:%02d GMT", day_names()[tm.tm_wday], tm.tm_mday,
+                      month_names()[tm.tm_mon], tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec);
+        return text;
+    }
+
+    // Ставит заголовки валидации; true - у клиента актуальная копия, ответ 304 готов.
+    // personal: страница с данными пользователя - кэшируется только браузером, отдельно для сессии.
+    // Без last_modified (ETag по телу ответа) валидация только по If-None-Match.
+    bool not_modified(const httplib::Request& req, httplib::Response& res, const PageVersion& version, bool personal) const {
+        char tag[24];
+        std::snprintf(tag, sizeof(tag), "\"%016llx", static_cast<unsigned long long>(version.tag ^ generation));
+        bool dated = !version.last_modified.empty();
+        std::time_t modified = std::max(parse_local(version.last_modified), started_at);
+
+        res.set_header("ETag", std::string(tag) + "\"");
+        if (dated) {
+            res.set_header("Last-Modified", http_date(modified));
+        }
+        res.set_header("Cache-Control", personal ? "private, no-cache" : "no-cache");
+        if (personal) {
+            res.set_header("Vary", "Cookie");
+        }
+
+        bool fresh = false;
+        if (req.has_header("If-None-Match")) {
+            // If-Modified-Since при наличии If-None-Match не учитывается (RFC 7232, 6)
+            std::string header = req.get_header_value("If-None-Match");
+            fresh = header == "*" || header.find(tag) != std::string::npos;
+        } else if (dated && req.has_header("If-Modified-Since")) {
+            std::time_t since = 0;
+            fresh = parse_http_date(req.get_header_value("If-Modified-Since"), since) && modified <= since;
+        }
+        if (fresh) {
+            res.status = 304;
+        }
+        return fresh;
+    }
+};
+
+#endif // CONDITIONAL_GET_H
@@ -2,6 +2,10 @@
 #define DATABASE_H
 
 #include "models.h"
+#include "date_utils.h"
+#include "occupancy.h"
+#include "request_arena.h"
+#include "logger.h"
 #include <sqlite3.h>
 #include <vector>
 #include <memory>
@@ -9,18 +13,69 @@
 #include <sstream>
 #include <iostream>
 #include <iomanip>
+#include <functional>
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+#include <initializer_list>
+#include <unordered_map>
+#include <unordered_set>
 
 class Database {
 private:
     sqlite3* db;
     std::string db_path;
+    std::vector<std::function<void(int64_t)>> user_listeners;
+    std::vector<std::function<void(sqlite3_stmt*, uint64_t)>> statement_listeners;
+    std::vector<std::function<void(sqlite3_stmt*)>> row_listeners;
+    std::vector<std::function<void(int64_t)>> change_listeners;
+    unsigned trace_mask = 0;
+
+    void notify_user_changed(int64_t user_id) {
+        for (const auto& listener : user_listeners) {
+            listener(user_id);
+        }
+    }
+
+    // SQLITE_TRACE_PROFILE вызывается в потоке, выполнявшем запрос, по его завершении,
+    // SQLITE_TRACE_ROW - на каждой строке результата
+    static int trace_callback(unsigned type, void* context, void* p, void* x) {
+        auto* self = static_cast<Database*>(context);
+        if (type == SQLITE_TRACE_PROFILE) {
+            uint64_t nanoseconds = static_cast<uint64_t>(*static_cast<sqlite3_int64*>(x));
+            for (const auto& listener : self->statement_listeners) {
+                listener(static_cast<sqlite3_stmt*>(p), nanoseconds);
+            }
+        } else if (type == SQLITE_TRACE_ROW) {
+            for (const auto& listener : self->row_listeners) {
+                listener(static_cast<sqlite3_stmt*>(p));
+            }
+        }
+        return 0;
+    }
+
+    // Вызывается внутри оператора, до фиксации: слушатели только будят ожидающих,
+    // SQL на этом соединении из обработчика выполнять нельзя
+    static void update_callback(void* context, int, const char*, const char* table, sqlite3_int64 rowid) {
+        auto* self = static_cast<Database*>(context);
+        if (std::strcmp(table, "changes") == 0) {
+            for (const auto& listener : self->change_listeners) {
+                listener(rowid);
+            }
+        }
+    }
+
+    void enable_trace(unsigned mask) {
+        trace_mask |= mask;
+        sqlite3_trace_v2(db, trace_mask, &Database::trace_callback, this);
+    }
 
     void log_error(const std::string& operation, const std::string& error, const std::string& sql = "") {
-        std::cerr << "[ERROR] " << get_current_datetime() << " - " << operation << ": " << error;
-        if (!sql.empty()) {
-            std::cerr << " (SQL: " << sql << ")";
+        if (sql.empty()) {
+            Logger::error(operation, {{"error", error}});
+        } else {
+            Logger::error(operation, {{"error", error}, {"sql", sql}});
         }
-        std::cerr << std::endl;
     }
 
     void execute(const std::string& sql) {
@@ -34,6 +89,417 @@ private:
         }
     }
 
+    // Чтение строк для пакетных выборок; порядок столбцов - как в ROOM_COLUMNS / GUEST_COLUMNS / ...
+    static constexpr const char* ROOM_COLUMNS = "room_id, hotel_id, number, name, description, type_name, price_per_day, created_at, updated_at";
+    static constexpr const char* GUEST_COLUMNS = "guest_id, user_id, first_name, last_name, middle_name, passport_number, email, phone, created_at, updated_at";
+    static constexpr const char* HOTEL_COLUMNS = "hotel_id, organization_id, name, description, address, created_at, updated_at";
+    static constexpr const char* BOOKING_COLUMNS = "b.booking_id, b.guest_id, b.room_id, b.check_in_date, b.check_out_date, b.adults_count, "
+                                                   "b.children_count, b.total_price, b.special_requests, b.created_at, b.updated_at";
+
+    static constexpr const char* CHANGE_COLUMNS = "c.seq, c.entity, c.entity_id, c.operation, c.hotel_id, c.changed_at";
+
+    static Change read_change(sqlite3_stmt* stmt) {
+        Change change;
+        change.seq = sqlite3_column_int64(stmt, 0);
+        change.entity = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        change.entity_id = sqlite3_column_int64(stmt, 2);
+        change.operation = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+        change.hotel_id = sqlite3_column_int64(stmt, 4);
+        change.changed_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
+        return change;
+    }
+
+    static Hotel read_hotel(sqlite3_stmt* stmt) {
+        Hotel hotel;
+        hotel.hotel_id = sqlite3_column_int64(stmt, 0);
+        hotel.organization_id = sqlite3_column_int64(stmt, 1);
+        hotel.name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+        const char* desc = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+        hotel.description = desc ? desc : "";
+        const char* addr = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
+        hotel.address = addr ? addr : "";
+        hotel.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
+        hotel.updated_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 6));
+        return hotel;
+    }
+
+    static Booking read_booking(sqlite3_stmt* stmt) {
+        Booking booking;
+        booking.booking_id = sqlite3_column_int64(stmt, 0);
+        booking.guest_id = sqlite3_column_int64(stmt, 1);
+        booking.room_id = sqlite3_column_int64(stmt, 2);
+        booking.check_in_date = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+        booking.check_out_date = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
+        booking.adults_count = sqlite3_column_int(stmt, 5);
+        booking.children_count = sqlite3_column_int(stmt, 6);
+        booking.total_price = sqlite3_column_double(stmt, 7);
+        const char* requests = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 8));
+        booking.special_requests = requests ? requests : "";
+        booking.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 9));
+        booking.updated_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 10));
+        return booking;
+    }
+
+    static Room read_room(sqlite3_stmt* stmt) {
+        Room room;
+        room.room_id = sqlite3_column_int64(stmt, 0);
+        room.hotel_id = sqlite3_column_int64(stmt, 1);
+        room.number = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+        room.name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+        room.description = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
+        room.type_name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
+        room.price_per_day = sqlite3_column_double(stmt, 6);
+        room.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 7));
+        room.updated_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 8));
+        return room;
+    }
+
+    static Guest read_guest(sqlite3_stmt* stmt) {
+        Guest guest;
+        guest.guest_id = sqlite3_column_int64(stmt, 0);
+        guest.user_id = sqlite3_column_int64(stmt, 1);
+        guest.first_name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+        guest.last_name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+        const char* middle = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
+        guest.middle_name = middle ? middle : "";
+        guest.passport_number = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
+        const char* email = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 6));
+        guest.email = email ? email : "";
+        guest.phone = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 7));
+        guest.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 8));
+        guest.updated_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 9));
+        return guest;
+    }
+
+    // Выборка строк по набору идентификаторов: WHERE id IN (?, ?, ...) порциями,
+    // чтобы не упереться в лимит параметров SQLite
+    template <typename T, typename Read>
+    ArenaMap<int64_t, T> select_by_ids(const std::string& select, const std::string& id_column, ArenaVector<int64_t> ids, Read read) {
+        ArenaMap<int64_t, T> result(RequestArena::current_resource());
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        const size_t chunk = 500;
+        for (size_t offset = 0; offset < ids.size(); offset += chunk) {
+            size_t count = std::min(chunk, ids.size() - offset);
+            std::string sql = select + " WHERE " + id_column + " IN (?";
+            for (size_t i = 1; i < count; ++i) {
+                sql += ", ?";
+            }
+            sql += ")";
+
+            sqlite3_stmt* stmt;
+            if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+                log_error("select_by_ids prepare", sqlite3_errmsg(db), sql);
+                sqlite3_finalize(stmt);
+                throw std::runtime_error("Failed to prepare statement: " + std::string(sqlite3_errmsg(db)));
+            }
+            for (size_t i = 0; i < count; ++i) {
+                sqlite3_bind_int64(stmt, static_cast<int>(i + 1), ids[offset + i]);
+            }
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                T row = read(stmt);
+                int64_t id = sqlite3_column_int64(stmt, 0);
+                result.emplace(id, std::move(row));
+            }
+            sqlite3_finalize(stmt);
+        }
+        return result;
+    }
+
+    template <typename Read>
+    PageVersion page_version(const std::string& sql, int64_t id, Read read) {
+        PageVersion version;
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
+            sqlite3_bind_int64(stmt, 1, id);
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                version.found = true;
+                read(stmt, version);
+            }
+        } else {
+            log_error("page_version prepare", sqlite3_errmsg(db), sql);
+        }
+        sqlite3_finalize(stmt);
+        return version;
+    }
+
+    // Страница по ключу: sql заканчивается на "id > ? ORDER BY id LIMIT ?", параметры
+    // фильтра (filter, если не 0) идут перед ними
+    template <typename T, typename Read>
+    ArenaVector<T> select_page(const std::string& sql, int64_t filter, int64_t after_id, size_t limit, Read read) {
+        ArenaVector<T> rows(RequestArena::current_resource());
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
+            int index = 1;
+            if (filter != 0) {
+                sqlite3_bind_int64(stmt, index++, filter);
+            }
+            sqlite3_bind_int64(stmt, index++, after_id);
+            sqlite3_bind_int64(stmt, index, static_cast<int64_t>(limit));
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                rows.push_back(read(stmt));
+            }
+        } else {
+            log_error("select_page prepare", sqlite3_errmsg(db), sql);
+        }
+        sqlite3_finalize(stmt);
+        return rows;
+    }
+
+    // Дописывает в out символ UTF-8 из text[i], латиница и кириллица - заглавными;
+    // возвращает позицию следующего символа
+    static size_t append_upper_char(std::string& out, const std::string& text, size_t i) {
+        unsigned char first = static_cast<unsigned char>(text[i]);
+        if (first < 0x80) {
+            out += static_cast<char>(first >= 'a' && first <= 'z' ? first - 'a' + 'A' : first);
+            return i + 1;
+        }
+        if (i + 1 < text.size() && (first == 0xd0 || first == 0xd1)) {
+            unsigned char second = static_cast<unsigned char>(text[i + 1]);
+            if (first == 0xd0 && second >= 0xb0 && second <= 0xbf) {         // а-п
+                second = static_cast<unsigned char>(second - 0x20);
+            } else if (first == 0xd1 && second >= 0x80 && second <= 0x8f) {  // р-я
+                first = 0xd0;
+                second = static_cast<unsigned char>(second + 0x20);
+            } else if (first == 0xd1 && second == 0x91) {                    // ё
+                first = 0xd0;
+                second = 0x81;
+            }
+            out += static_cast<char>(first);
+            out += static_cast<char>(second);
+            return i + 2;
+        }
+        size_t next = i + 1;
+        while (next < text.size() && (static_cast<unsigned char>(text[next]) & 0xc0) == 0x80) {
+            ++next;
+        }
+        out.append(text, i, next - i);
+        return next;
+    }
+
+    // Префикс с заглавной первой буквой, чтобы "пет" находил "Петров"
+    // без COLLATE NOCASE, который не работает с кириллицей и не использует индексы
+    static std::string capitalize_first(const std::string& text) {
+        if (text.empty()) {
+            return text;
+        }
+        std::string out;
+        out.reserve(text.size());
+        size_t next = append_upper_char(out, text, 0);
+        out.append(text, next, std::string::npos);
+        return out;
+    }
+
+    // Поиск по началу значения в нескольких столбцах. Каждый столбец - отдельный диапазон
+    // [prefix, prefix + 0xFF) по индексу (байт 0xFF не встречается в UTF-8, поэтому в диапазон
+    // попадают ровно строки с этим началом), из которого читается не больше limit строк;
+    // UNION убирает строки, совпавшие в нескольких столбцах, и итог сортируется по order.
+    // filter_column (если не nullptr) - условие "filter_column = filter" в каждой ветке.
+    template <typename T, typename Read>
+    ArenaVector<T> select_by_prefix(const char* table, const char* columns, const char* filter_column, int64_t filter,
+                                    std::initializer_list<const char*> search_columns, const std::string& prefix,
+                                    const char* order, size_t limit, Read read) {
+        ArenaVector<T> rows(RequestArena::current_resource());
+        std::vector<std::string> prefixes{prefix};
+        std::string capitalized = capitalize_first(prefix);
+        if (capitalized != prefix) {
+            prefixes.push_back(capitalized);
+        }
+
+        std::string sql;
+        for (const char* column : search_columns) {
+            for (size_t i = 0; i < prefixes.size(); ++i) {
+                if (!sql.empty()) {
+                    sql += " UNION ";
+                }
+                sql += std::string("SELECT * FROM (SELECT ") + columns + " FROM " + table + " WHERE ";
+                if (filter_column) {
+                    sql += std::string(filter_column) + " = ? AND ";
+                }
+                sql += std::string(column) + " >= ? AND " + column + " < ? ORDER BY " + column + " LIMIT ?)";
+            }
+        }
+        sql += std::string(" ORDER BY ") + order + " LIMIT ?";
+
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
+            int index = 1;
+            for (size_t c = 0; c < search_columns.size(); ++c) {
+                for (const auto& p : prefixes) {
+                    if (filter_column) {
+                        sqlite3_bind_int64(stmt, index++, filter);
+                    }
+                    std::string upper = p + '\xff';
+                    sqlite3_bind_text(stmt, index++, p.c_str(), static_cast<int>(p.size()), SQLITE_TRANSIENT);
+                    sqlite3_bind_text(stmt, index++, upper.c_str(), static_cast<int>(upper.size()), SQLITE_TRANSIENT);
+                    sqlite3_bind_int64(stmt, index++, static_cast<int64_t>(limit));
+                }
+            }
+            sqlite3_bind_int64(stmt, index, static_cast<int64_t>(limit));
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                rows.push_back(read(stmt));
+            }
+        } else {
+            log_error("select_by_prefix prepare", sqlite3_errmsg(db), sql);
+        }
+        sqlite3_finalize(stmt);
+        return rows;
+    }
+
+    // Заполняет passport_key после пересборки guests. Ключ получает старший гость
+    // пользователя с этим паспортом, остальные (дубликаты) остаются с NULL.
+    // Возвращает число дубликатов.
+    size_t fill_passport_keys() {
+        std::unordered_set<std::string> seen;
+        size_t duplicates = 0;
+        sqlite3_stmt* select;
+        sqlite3_stmt* update;
+        if (sqlite3_prepare_v2(db, "SELECT guest_id, user_id, passport_number FROM guests ORDER BY guest_id", -1, &select, nullptr) != SQLITE_OK) {
+            throw std::runtime_error("Failed to prepare statement: " + std::string(sqlite3_errmsg(db)));
+        }
+        if (sqlite3_prepare_v2(db, "UPDATE guests SET passport_key = ? WHERE guest_id = ?", -1, &update, nullptr) != SQLITE_OK) {
+            sqlite3_finalize(select);
+            throw std::runtime_error("Failed to prepare statement: " + std::string(sqlite3_errmsg(db)));
+        }
+        while (sqlite3_step(select) == SQLITE_ROW) {
+            const char* passport = reinterpret_cast<const char*>(sqlite3_column_text(select, 2));
+            std::string key = passport_key(passport ? passport : "");
+            // Гости без пользователя (до миграции user_id) не сравниваются: NULL в индексе различны
+            if (sqlite3_column_type(select, 1) != SQLITE_NULL &&
+                !seen.insert(std::to_string(sqlite3_column_int64(select, 1)) + '\n' + key).second) {
+                ++duplicates;
+                continue;
+            }
+            sqlite3_bind_text(update, 1, key.c_str(), static_cast<int>(key.size()), SQLITE_TRANSIENT);
+            sqlite3_bind_int64(update, 2, sqlite3_column_int64(select, 0));
+            sqlite3_step(update);
+            sqlite3_reset(update);
+        }
+        sqlite3_finalize(select);
+        sqlite3_finalize(update);
+        return duplicates;
+    }
+
+    // Вставка гостя; upsert - гость с тем же (user_id, passport_key) обновляется
+    // вместо ошибки уникальности. Необязательные поля (отчество, email) обновляются,
+    // только если заданы; версия растет только при настоящем изменении.
+    int64_t insert_guest(const Guest& guest, bool upsert) {
+        const char* context = upsert ? "upsert_guest" : "create_guest";
+        std::string now = get_current_datetime();
+        std::string key = passport_key(guest.passport_number);
+        std::string sql = "INSERT INTO guests (user_id, first_name, last_name, middle_name, passport_number, email, phone, created_at, updated_at, passport_key) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+        if (upsert) {
+            sql += R"(
+                ON CONFLICT (user_id, passport_key) DO UPDATE SET
+                    first_name = excluded.first_name,
+                    last_name = excluded.last_name,
+                    middle_name = CASE WHEN excluded.middle_name <> '' THEN excluded.middle_name ELSE middle_name END,
+                    passport_number = excluded.passport_number,
+                    email = CASE WHEN excluded.email <> '' THEN excluded.email ELSE email END,
+                    phone = excluded.phone,
+                    updated_at = excluded.updated_at,
+                    version = version + 1
+                WHERE (first_name, last_name, passport_number, phone) IS NOT (excluded.first_name, excluded.last_name, excluded.passport_number, excluded.phone)
+                   OR (excluded.middle_name <> '' AND excluded.middle_name IS NOT middle_name)
+                   OR (excluded.email <> '' AND excluded.email IS NOT email))";
+        }
+        sqlite3_stmt* stmt;
+
+        int prepare_result = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
+        if (prepare_result != SQLITE_OK) {
+            std::string error = sqlite3_errmsg(db);
+            log_error(std::string(context) + " (prepare)", error, sql);
+            throw std::runtime_error("Failed to prepare statement: " + error);
+        }
+
+        sqlite3_bind_int64(stmt, 1, guest.user_id);
+        sqlite3_bind_text(stmt, 2, guest.first_name.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 3, guest.last_name.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 4, guest.middle_name.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 5, guest.passport_number.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 6, guest.email.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 7, guest.phone.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 8, now.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 9, now.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 10, key.c_str(), -1, SQLITE_STATIC);
+
+        int step_result = sqlite3_step(stmt);
+        if (step_result != SQLITE_DONE) {
+            std::string error = sqlite3_errmsg(db);
+            std::string error_code = std::to_string(step_result);
+            bool duplicate = sqlite3_extended_errcode(db) == SQLITE_CONSTRAINT_UNIQUE;
+            log_error(std::string(context) + " (step)", "SQLite error code " + error_code + ": " + error, sql);
+            log_error(std::string(context) + " (data)", "user_id=" + std::to_string(guest.user_id) +
+                     ", first_name=" + guest.first_name +
+                     ", last_name=" + guest.last_name +
+                     ", passport=" + guest.passport_number);
+            sqlite3_finalize(stmt);
+            if (duplicate) {
+                throw std::runtime_error("гость с таким номером паспорта уже есть");
+            }
+            throw std::runtime_error("Failed to create guest: " + error + " (code: " + error_code + ")");
+        }
+        sqlite3_finalize(stmt);
+
+        if (!upsert) {
+            return sqlite3_last_insert_rowid(db);
+        }
+        // После DO UPDATE last_insert_rowid не меняется - id берется по ключу
+        int64_t id = 0;
+        if (sqlite3_prepare_v2(db, "SELECT guest_id FROM guests WHERE user_id = ? AND passport_key = ?", -1, &stmt, nullptr) == SQLITE_OK) {
+            sqlite3_bind_int64(stmt, 1, guest.user_id);
+            sqlite3_bind_text(stmt, 2, key.c_str(), -1, SQLITE_STATIC);
+            if (sqlite3_step(stmt) == SQLITE_ROW) {
+                id = sqlite3_column_int64(stmt, 0);
+            }
+        }
+        sqlite3_finalize(stmt);
+        if (id == 0) {
+            throw std::runtime_error("Failed to create guest: upserted row not found");
+        }
+        return id;
+    }
+
+    // Бронирования номеров отеля с условием на даты (два параметра) по номеру комнаты.
+    // Для каждого номера отеля читается диапазон (room_id, check_out_date) от первой даты:
+    // прошедшие бронирования не читаются вовсе, и время не зависит от длины истории.
+    // Унарный плюс у check_in_date не дает планировщику взять индекс по заезду,
+    // по которому пришлось бы пройти всю историю номера.
+    ArenaVector<Booking> select_hotel_bookings(int64_t hotel_id, const char* dates_condition, const std::string& first, const std::string& second) {
+        ArenaVector<Booking> bookings(RequestArena::current_resource());
+        std::string sql = std::string("SELECT ") + BOOKING_COLUMNS +
+                          " FROM rooms r JOIN bookings b ON b.room_id = r.room_id WHERE r.hotel_id = ? AND " +
+                          dates_condition + " ORDER BY r.number, b.booking_id";
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
+            sqlite3_bind_int64(stmt, 1, hotel_id);
+            sqlite3_bind_text(stmt, 2, first.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt, 3, second.c_str(), -1, SQLITE_STATIC);
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                bookings.push_back(read_booking(stmt));
+            }
+        } else {
+            log_error("select_hotel_bookings prepare", sqlite3_errmsg(db), sql);
+        }
+        sqlite3_finalize(stmt);
+        return bookings;
+    }
+
+    bool has_column(const std::string& table, const std::string& column) {
+        bool found = false;
+        sqlite3_stmt* stmt;
+        std::string sql = "PRAGMA table_info(" + table + ")";
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                if (column == reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1))) {
+                    found = true;
+                }
+            }
+        }
+        sqlite3_finalize(stmt);
+        return found;
+    }
+
 public:
     Database(const std::string& path = "hotels.db") : db_path(path), db(nullptr) {
         if (sqlite3_open(path.c_str(), &db) != SQLITE_OK) {
@@ -256,11 +722,12 @@ public:
                         first_name TEXT NOT NULL,
                         last_name TEXT NOT NULL,
                         middle_name TEXT,
-                        passport_number TEXT UNIQUE NOT NULL,
+                        passport_number TEXT NOT NULL,
                         email TEXT,
                         phone TEXT NOT NULL,
                         created_at TEXT NOT NULL,
                         updated_at TEXT NOT NULL,
+                        passport_key TEXT,
                         FOREIGN KEY (user_id) REFERENCES users(user_id)
                     )
                 )");
@@ -282,11 +749,170 @@ public:
                 )
             )");
         }
+
+        // Номер версии строки для ETag: растет при каждом изменении, в отличие от
+        // updated_at не совпадает у двух правок в одну секунду
+        for (const char* table : {"rooms", "guests", "bookings"}) {
+            if (!has_column(table, "version")) {
+                execute(std::string("ALTER TABLE ") + table + " ADD COLUMN version INTEGER NOT NULL DEFAULT 1");
+            }
+        }
+        // Гость уникален по (user_id, passport_key), где passport_key - номер паспорта без
+        // пробелов и разделителей, буквы заглавные. Прежний UNIQUE на passport_number был общим
+        // для всех пользователей и не замечал "4500 123456" и "4500-123456", поэтому таблица
+        // пересобирается без него. Дубликаты, найденные при заполнении ключа, остаются с
+        // passport_key = NULL до запуска --merge-guests (merge_duplicate_guests).
+        if (!has_column("guests", "passport_key")) {
+            execute("BEGIN");
+            execute(R"(
+                CREATE TABLE guests_new (
+                    guest_id INTEGER PRIMARY KEY AUTOINCREMENT,
+                    user_id INTEGER,
+                    first_name TEXT NOT NULL,
+                    last_name TEXT NOT NULL,
+                    middle_name TEXT,
+                    passport_number TEXT NOT NULL,
+                    email TEXT,
+                    phone TEXT NOT NULL,
+                    created_at TEXT NOT NULL,
+                    updated_at TEXT NOT NULL,
+                    version INTEGER NOT NULL DEFAULT 1,
+                    passport_key TEXT,
+                    FOREIGN KEY (user_id) REFERENCES users(user_id)
+                )
+            )");
+            execute(R"(
+                INSERT INTO guests_new (guest_id, user_id, first_name, last_name, middle_name, passport_number, email, phone, created_at, updated_at, version)
+                SELECT guest_id, user_id, first_name, last_name, middle_name, passport_number, email, phone, created_at, updated_at, version
+                FROM guests
+            )");
+            // Триггеры bookings ссылаются на guests и не дают переименовать таблицу; ниже они создаются заново
+            execute("DROP TRIGGER IF EXISTS bookings_touch_guest_on_delete");
+            execute("DROP TRIGGER IF EXISTS bookings_touch_guest_on_move");
+            execute("DROP TABLE guests");
+            execute("ALTER TABLE guests_new RENAME TO guests");
+            size_t duplicates = fill_passport_keys();
+            execute("COMMIT");
+            if (duplicates > 0) {
+                Logger::warn("Guests with duplicate passports found, run with --merge-guests=1", {{"duplicates", duplicates}});
+            }
+        }
+        execute("CREATE UNIQUE INDEX IF NOT EXISTS idx_guests_passport_key ON guests(user_id, passport_key)");
+
+        // Страница гостя показывает его бронирования: удаление или перенос бронирования
+        // к другому гостю - изменение страницы прежнего гостя
+        execute(R"(
+            CREATE TRIGGER IF NOT EXISTS bookings_touch_guest_on_delete AFTER DELETE ON bookings
+            BEGIN
+                UPDATE guests SET version = version + 1, updated_at = datetime('now', 'localtime') WHERE guest_id = OLD.guest_id;
+            END
+        )");
+        execute(R"(
+            CREATE TRIGGER IF NOT EXISTS bookings_touch_guest_on_move AFTER UPDATE OF guest_id ON bookings
+            WHEN OLD.guest_id <> NEW.guest_id
+            BEGIN
+                UPDATE guests SET version = version + 1, updated_at = datetime('now', 'localtime') WHERE guest_id = OLD.guest_id;
+            END
+        )");
+        execute("CREATE INDEX IF NOT EXISTS idx_bookings_guest ON bookings(guest_id)");
+        // Проверка доступности и пакетная выборка идут по номеру и дате заезда
+        execute("CREATE INDEX IF NOT EXISTS idx_bookings_room_dates ON bookings(room_id, check_in_date)");
+        // Стойка регистрации: номера отеля и бронирования, не закончившиеся к дате
+        execute("CREATE INDEX IF NOT EXISTS idx_rooms_hotel ON rooms(hotel_id)");
+        execute("CREATE INDEX IF NOT EXISTS idx_bookings_room_check_out ON bookings(room_id, check_out_date)");
+        // Подсказки в форме бронирования ищут по началу номера, названия, имени, телефона и паспорта
+        execute("CREATE INDEX IF NOT EXISTS idx_rooms_number ON rooms(number)");
+        execute("CREATE INDEX IF NOT EXISTS idx_rooms_name ON rooms(name)");
+        execute("CREATE INDEX IF NOT EXISTS idx_guests_last_name ON guests(user_id, last_name)");
+        execute("CREATE INDEX IF NOT EXISTS idx_guests_first_name ON guests(user_id, first_name)");
+        execute("CREATE INDEX IF NOT EXISTS idx_guests_phone ON guests(user_id, phone)");
+        execute("CREATE INDEX IF NOT EXISTS idx_guests_passport ON guests(user_id, passport_number)");
+
+        // Журнал изменений: триггеры пишут строку в той же транзакции, что и само изменение,
+        // поэтому журнал не расходится с данными. seq не переиспользуется (AUTOINCREMENT).
+        execute(R"(
+            CREATE TABLE IF NOT EXISTS changes (
+                seq INTEGER PRIMARY KEY AUTOINCREMENT,
+                entity TEXT NOT NULL,
+                entity_id INTEGER NOT NULL,
+                operation TEXT NOT NULL,
+                hotel_id INTEGER,
+                changed_at TEXT NOT NULL DEFAULT (datetime('now', 'localtime'))
+            )
+        )");
+        execute("CREATE INDEX IF NOT EXISTS idx_changes_hotel ON changes(hotel_id, seq)");
+        struct Tracked {
+            const char* table;
+            const char* entity;
+            const char* id;
+            const char* hotel;  // выражение для hotel_id от строки ROW
+        };
+        const Tracked tracked[] = {
+            {"hotels", "hotel", "hotel_id", "ROW.hotel_id"},
+            {"rooms", "room", "room_id", "ROW.hotel_id"},
+            {"guests", "guest", "guest_id", "NULL"},
+            {"bookings", "booking", "booking_id", "(SELECT hotel_id FROM rooms WHERE room_id = ROW.room_id)"},
+        };
+        const char* operations[][3] = {{"INSERT", "insert", "NEW"}, {"UPDATE", "update", "NEW"}, {"DELETE", "delete", "OLD"}};
+        for (const auto& t : tracked) {
+            for (const auto& op : operations) {
+                std::string hotel = t.hotel;
+                size_t row = hotel.find("ROW");
+                if (row != std::string::npos) {
+                    hotel.replace(row, 3, op[2]);
+                }
+                execute(std::string("CREATE TRIGGER IF NOT EXISTS ") + t.table + "_log_" + op[1] + " AFTER " + op[0] + " ON " + t.table +
+                        " BEGIN INSERT INTO changes (entity, entity_id, operation, hotel_id) VALUES ('" + t.entity + "', " + op[2] + "." +
+                        t.id + ", '" + op[1] + "', " + hotel + "); END");
+            }
+        }
+        // Бронирование перенесено в номер другого отеля: старый отель тоже должен узнать об этом
+        execute(R"(
+            CREATE TRIGGER IF NOT EXISTS bookings_log_move AFTER UPDATE OF room_id ON bookings
+            WHEN (SELECT hotel_id FROM rooms WHERE room_id = OLD.room_id) IS NOT (SELECT hotel_id FROM rooms WHERE room_id = NEW.room_id)
+            BEGIN
+                INSERT INTO changes (entity, entity_id, operation, hotel_id)
+                VALUES ('booking', OLD.booking_id, 'update', (SELECT hotel_id FROM rooms WHERE room_id = OLD.room_id));
+            END
+        )");
+        sqlite3_update_hook(db, &Database::update_callback, this);
+
+        execute(R"(
+            CREATE TABLE IF NOT EXISTS sessions (
+                token TEXT PRIMARY KEY,
+                user_id INTEGER NOT NULL,
+                expires_at INTEGER NOT NULL,
+                FOREIGN KEY (user_id) REFERENCES users(user_id)
+            )
+        )");
+    }
+
+    // Подписка на изменения пользователя (update_user, update_user_password)
+    void add_user_listener(std::function<void(int64_t)> listener) {
+        user_listeners.push_back(std::move(listener));
+    }
+
+    // Подписка на выполнение SQL-запросов (оператор и время в наносекундах).
+    // Регистрируется до запуска сервера.
+    void add_statement_listener(std::function<void(sqlite3_stmt*, uint64_t)> listener) {
+        statement_listeners.push_back(std::move(listener));
+        enable_trace(SQLITE_TRACE_PROFILE);
+    }
+
+    // Подписка на каждую строку, возвращенную sqlite3_step. Заметно дороже
+    // статистики по операторам, поэтому включается только профилировщиком.
+    void add_row_listener(std::function<void(sqlite3_stmt*)> listener) {
+        row_listeners.push_back(std::move(listener));
+        enable_trace(SQLITE_TRACE_ROW);
+    }
+
+    const std::string& path() const {
+        return db_path;
     }
 
     // Room operations
-    std::vector<Room> get_all_rooms(const std::string& type_filter = "") {
-        std::vector<Room> rooms;
+    ArenaVector<Room> get_all_rooms(const std::string& type_filter = "") {
+        ArenaVector<Room> rooms(RequestArena::current_resource());
         std::string sql = "SELECT room_id, hotel_id, number, name, description, type_name, price_per_day, created_at, updated_at FROM rooms";
         if (!type_filter.empty()) {
             sql += " WHERE type_name LIKE '%" + type_filter + "%'";
@@ -306,7 +932,7 @@ public:
                 room.price_per_day = sqlite3_column_double(stmt, 6);
                 room.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 7));
                 room.updated_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 8));
-                rooms.push_back(room);
+                rooms.push_back(std::move(room));
             }
         }
         sqlite3_finalize(stmt);
@@ -336,8 +962,8 @@ public:
         return room;
     }
 
-    std::vector<Room> get_rooms_by_hotel(int64_t hotel_id) {
-        std::vector<Room> rooms;
+    ArenaVector<Room> get_rooms_by_hotel(int64_t hotel_id) {
+        ArenaVector<Room> rooms(RequestArena::current_resource());
         std::string sql = "SELECT room_id, hotel_id, number, name, description, type_name, price_per_day, created_at, updated_at FROM rooms WHERE hotel_id = ? ORDER BY number";
         sqlite3_stmt* stmt;
         
@@ -354,7 +980,29 @@ public:
                 room.price_per_day = sqlite3_column_double(stmt, 6);
                 room.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 7));
                 room.updated_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 8));
-                rooms.push_back(room);
+                rooms.push_back(std::move(room));
+            }
+        }
+        sqlite3_finalize(stmt);
+        return rooms;
+    }
+
+    // Номера по списку идентификаторов одним запросом (вместо get_room в цикле)
+    ArenaMap<int64_t, Room> get_rooms_by_ids(ArenaVector<int64_t> ids) {
+        return select_by_ids<Room>(std::string("SELECT ") + ROOM_COLUMNS + " FROM rooms", "room_id", std::move(ids), &Database::read_room);
+    }
+
+    // Все номера отелей организации, по отелю и номеру
+    ArenaVector<Room> get_rooms_by_organization(int64_t organization_id) {
+        ArenaVector<Room> rooms(RequestArena::current_resource());
+        std::string sql = "SELECT r.room_id, r.hotel_id, r.number, r.name, r.description, r.type_name, r.price_per_day, r.created_at, r.updated_at "
+                          "FROM rooms r JOIN hotels h ON r.hotel_id = h.hotel_id WHERE h.organization_id = ? ORDER BY r.hotel_id, r.number";
+        sqlite3_stmt* stmt;
+
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
+            sqlite3_bind_int64(stmt, 1, organization_id);
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                rooms.push_back(read_room(stmt));
             }
         }
         sqlite3_finalize(stmt);
@@ -398,7 +1046,7 @@ public:
 
     void update_room(const Room& room) {
         std::string now = get_current_datetime();
-        std::string sql = "UPDATE rooms SET hotel_id = ?, number = ?, name = ?, description = ?, type_name = ?, price_per_day = ?, updated_at = ? WHERE room_id = ?";
+        std::string sql = "UPDATE rooms SET hotel_id = ?, number = ?, name = ?, description = ?, type_name = ?, price_per_day = ?, updated_at = ?, version = version + 1 WHERE room_id = ?";
         sqlite3_stmt* stmt;
         
         int prepare_result = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
@@ -452,14 +1100,14 @@ public:
         sqlite3_finalize(stmt);
     }
 
-    std::vector<std::string> get_room_types() {
-        std::vector<std::string> types;
+    ArenaVector<std::string> get_room_types() {
+        ArenaVector<std::string> types(RequestArena::current_resource());
         std::string sql = "SELECT DISTINCT type_name FROM rooms";
         sqlite3_stmt* stmt;
         
         if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
             while (sqlite3_step(stmt) == SQLITE_ROW) {
-                types.push_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
+                types.emplace_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
             }
         }
         sqlite3_finalize(stmt);
@@ -467,8 +1115,8 @@ public:
     }
 
     // Guest operations
-    std::vector<Guest> get_all_guests(const std::string& search = "", int64_t user_id = 0) {
-        std::vector<Guest> guests;
+    ArenaVector<Guest> get_all_guests(const std::string& search = "", int64_t user_id = 0) {
+        ArenaVector<Guest> guests(RequestArena::current_resource());
         std::string sql = "SELECT guest_id, user_id, first_name, last_name, middle_name, passport_number, email, phone, created_at, updated_at FROM guests";
         
         std::vector<std::string> conditions;
@@ -503,13 +1151,30 @@ public:
                 guest.phone = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 7));
                 guest.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 8));
                 guest.updated_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 9));
-                guests.push_back(guest);
+                guests.push_back(std::move(guest));
             }
         }
         sqlite3_finalize(stmt);
         return guests;
     }
 
+    // Подсказки для формы бронирования: первые limit номеров, у которых с prefix
+    // начинается номер или название (пустой prefix - первые по номеру)
+    ArenaVector<Room> search_rooms_by_prefix(const std::string& prefix, size_t limit) {
+        return select_by_prefix<Room>("rooms", ROOM_COLUMNS, nullptr, 0, {"number", "name"}, prefix, "number, room_id", limit, read_room);
+    }
+
+    // Подсказки гостей пользователя: по началу фамилии, имени, телефона или паспорта
+    ArenaVector<Guest> search_guests_by_prefix(int64_t user_id, const std::string& prefix, size_t limit) {
+        return select_by_prefix<Guest>("guests", GUEST_COLUMNS, "user_id", user_id, {"last_name", "first_name", "phone", "passport_number"},
+                                       prefix, "last_name, first_name, guest_id", limit, read_guest);
+    }
+
+    // Гости по списку идентификаторов одним запросом (вместо get_guest в цикле)
+    ArenaMap<int64_t, Guest> get_guests_by_ids(ArenaVector<int64_t> ids) {
+        return select_by_ids<Guest>(std::string("SELECT ") + GUEST_COLUMNS + " FROM guests", "guest_id", std::move(ids), &Database::read_guest);
+    }
+
     Guest get_guest(int64_t id) {
         std::string sql = "SELECT guest_id, user_id, first_name, last_name, middle_name, passport_number, email, phone, created_at, updated_at FROM guests WHERE guest_id = ?";
         sqlite3_stmt* stmt;
@@ -537,48 +1202,150 @@ public:
     }
 
     int64_t create_guest(const Guest& guest) {
-        std::string now = get_current_datetime();
-        std::string sql = "INSERT INTO guests (user_id, first_name, last_name, middle_name, passport_number, email, phone, created_at, updated_at) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)";
-        sqlite3_stmt* stmt;
-        
-        int prepare_result = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-        if (prepare_result != SQLITE_OK) {
-            std::string error = sqlite3_errmsg(db);
-            log_error("create_guest (prepare)", error, sql);
-            throw std::runtime_error("Failed to prepare statement: " + error);
+        return insert_guest(guest, false);
+    }
+
+    // Гость из формы бронирования: постоянный гость с тем же паспортом не дублируется,
+    // а обновляется; возвращает его id. У анонимных гостей (user_id = 0) общее
+    // пространство ключей, поэтому они только создаются: иначе любой посетитель с чужим
+    // номером паспорта перезаписал бы данные гостя и получил его бронирования
+    int64_t upsert_guest(const Guest& guest) {
+        return insert_guest(guest, guest.user_id > 0);
+    }
+
+    // Ключ паспорта для уникальности гостя: только буквы и цифры, буквы заглавные
+    // ("4500 123456", "4500-123456" и "4500123456" - один паспорт)
+    static std::string passport_key(const std::string& passport) {
+        std::string key;
+        key.reserve(passport.size());
+        for (size_t i = 0; i < passport.size();) {
+            unsigned char c = static_cast<unsigned char>(passport[i]);
+            if (c < 0x80 && !std::isalnum(c)) {
+                ++i;
+            } else if (c >= 0x80 && c != 0xd0 && c != 0xd1) {
+                // Прочие символы вне ASCII и кириллицы (например, "№") - разделители
+                std::string skipped;
+                i = append_upper_char(skipped, passport, i);
+            } else {
+                i = append_upper_char(key, passport, i);
+            }
         }
-        
-        sqlite3_bind_int64(stmt, 1, guest.user_id);
-        sqlite3_bind_text(stmt, 2, guest.first_name.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 3, guest.last_name.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 4, guest.middle_name.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 5, guest.passport_number.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 6, guest.email.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 7, guest.phone.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 8, now.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 9, now.c_str(), -1, SQLITE_STATIC);
-        
-        int step_result = sqlite3_step(stmt);
-        if (step_result != SQLITE_DONE) {
-            std::string error = sqlite3_errmsg(db);
-            std::string error_code = std::to_string(step_result);
-            log_error("create_guest (step)", "SQLite error code " + error_code + ": " + error, sql);
-            log_error("create_guest (data)", "user_id=" + std::to_string(guest.user_id) + 
-                     ", first_name=" + guest.first_name + 
-                     ", last_name=" + guest.last_name + 
-                     ", passport=" + guest.passport_number);
+        return key;
+    }
+
+    struct GuestMergeStats {
+        size_t merged = 0;          // удалено дубликатов
+        size_t bookings_moved = 0;  // бронирований перенесено на оставшегося гостя
+        size_t keyed = 0;           // гостей без пары, получивших ключ
+    };
+
+    // Разовое объединение дубликатов (гости с passport_key = NULL после миграции):
+    // бронирования дубликата переносятся на гостя пользователя с тем же ключом, дубликат
+    // удаляется. Пачками по batch_size гостей, каждая - своя транзакция, чтобы сервер
+    // с той же базой не ждал записи долго.
+    GuestMergeStats merge_duplicate_guests(size_t batch_size = 500) {
+        GuestMergeStats stats;
+        const char* sql[] = {
+            "SELECT guest_id, user_id, passport_number FROM guests WHERE passport_key IS NULL ORDER BY guest_id LIMIT ?",
+            "SELECT guest_id FROM guests WHERE user_id = ? AND passport_key = ?",
+            "UPDATE guests SET passport_key = ? WHERE guest_id = ?",
+            "UPDATE bookings SET guest_id = ? WHERE guest_id = ?",
+            "DELETE FROM guests WHERE guest_id = ?",
+            "UPDATE guests SET version = version + 1, updated_at = datetime('now', 'localtime') WHERE guest_id = ?",
+        };
+        sqlite3_stmt* stmts[6] = {};
+        for (size_t i = 0; i < 6; ++i) {
+            if (sqlite3_prepare_v2(db, sql[i], -1, &stmts[i], nullptr) != SQLITE_OK) {
+                std::string error = sqlite3_errmsg(db);
+                log_error("merge_duplicate_guests prepare", error, sql[i]);
+                for (sqlite3_stmt* stmt : stmts) {
+                    sqlite3_finalize(stmt);
+                }
+                throw std::runtime_error("Failed to prepare statement: " + error);
+            }
+        }
+        sqlite3_stmt* pending = stmts[0];
+        sqlite3_stmt* find_keeper = stmts[1];
+        sqlite3_stmt* set_key = stmts[2];
+        sqlite3_stmt* move_bookings = stmts[3];
+        sqlite3_stmt* remove = stmts[4];
+        sqlite3_stmt* touch = stmts[5];
+        // Ошибка любого шага (BUSY, ограничение) прерывает пачку: catch ниже откатывает
+        // транзакцию, иначе бронирования дубликата остались бы без гостя
+        auto run = [this](sqlite3_stmt* stmt) {
+            if (sqlite3_step(stmt) != SQLITE_DONE) {
+                std::string error = sqlite3_errmsg(db);
+                log_error("merge_duplicate_guests (step)", error, sqlite3_sql(stmt));
+                sqlite3_reset(stmt);
+                throw std::runtime_error("Failed to merge guests: " + error);
+            }
+            sqlite3_reset(stmt);
+        };
+
+        try {
+            for (;;) {
+                struct Row {
+                    int64_t guest_id;
+                    int64_t user_id;
+                    std::string key;
+                };
+                std::vector<Row> batch;
+                sqlite3_bind_int64(pending, 1, static_cast<int64_t>(batch_size));
+                while (sqlite3_step(pending) == SQLITE_ROW) {
+                    const char* passport = reinterpret_cast<const char*>(sqlite3_column_text(pending, 2));
+                    batch.push_back({sqlite3_column_int64(pending, 0), sqlite3_column_int64(pending, 1), passport_key(passport ? passport : "")});
+                }
+                sqlite3_reset(pending);
+                if (batch.empty()) {
+                    break;
+                }
+
+                execute("BEGIN");
+                for (const Row& row : batch) {
+                    int64_t keeper = 0;
+                    sqlite3_bind_int64(find_keeper, 1, row.user_id);
+                    sqlite3_bind_text(find_keeper, 2, row.key.c_str(), -1, SQLITE_STATIC);
+                    if (sqlite3_step(find_keeper) == SQLITE_ROW) {
+                        keeper = sqlite3_column_int64(find_keeper, 0);
+                    }
+                    sqlite3_reset(find_keeper);
+
+                    if (keeper == 0) {
+                        // Старший гость с этим паспортом был удален - дубликат становится основным
+                        sqlite3_bind_text(set_key, 1, row.key.c_str(), -1, SQLITE_STATIC);
+                        sqlite3_bind_int64(set_key, 2, row.guest_id);
+                        run(set_key);
+                        ++stats.keyed;
+                        continue;
+                    }
+                    sqlite3_bind_int64(move_bookings, 1, keeper);
+                    sqlite3_bind_int64(move_bookings, 2, row.guest_id);
+                    run(move_bookings);
+                    stats.bookings_moved += static_cast<size_t>(sqlite3_changes(db));
+                    sqlite3_bind_int64(remove, 1, row.guest_id);
+                    run(remove);
+                    sqlite3_bind_int64(touch, 1, keeper);
+                    run(touch);
+                    ++stats.merged;
+                }
+                execute("COMMIT");
+            }
+        } catch (...) {
+            sqlite3_exec(db, "ROLLBACK", nullptr, nullptr, nullptr);
+            for (sqlite3_stmt* stmt : stmts) {
+                sqlite3_finalize(stmt);
+            }
+            throw;
+        }
+        for (sqlite3_stmt* stmt : stmts) {
             sqlite3_finalize(stmt);
-            throw std::runtime_error("Failed to create guest: " + error + " (code: " + error_code + ")");
         }
-        
-        int64_t id = sqlite3_last_insert_rowid(db);
-        sqlite3_finalize(stmt);
-        return id;
+        return stats;
     }
 
     // Booking operations
-    std::vector<Booking> get_all_bookings(const std::string& search = "", int64_t user_id = 0) {
-        std::vector<Booking> bookings;
+    ArenaVector<Booking> get_all_bookings(const std::string& search = "", int64_t user_id = 0) {
+        ArenaVector<Booking> bookings(RequestArena::current_resource());
         std::string sql = R"(
             SELECT b.booking_id, b.guest_id, b.room_id, b.check_in_date, b.check_out_date, 
                    b.adults_count, b.children_count, b.total_price, b.special_requests, 
@@ -620,7 +1387,7 @@ public:
                 booking.special_requests = requests ? requests : "";
                 booking.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 9));
                 booking.updated_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 10));
-                bookings.push_back(booking);
+                bookings.push_back(std::move(booking));
             }
         }
         sqlite3_finalize(stmt);
@@ -653,8 +1420,52 @@ public:
         return booking;
     }
 
-    std::vector<Booking> get_guest_bookings(int64_t guest_id) {
-        std::vector<Booking> bookings;
+    // Версии страниц для условного GET: один запрос на страницу, без чтения самих данных
+
+    PageVersion get_room_page_version(int64_t room_id) {
+        std::string sql = "SELECT version, updated_at FROM rooms WHERE room_id = ?";
+        return page_version(sql, room_id, [](sqlite3_stmt* stmt, PageVersion& version) {
+            version.add(sqlite3_column_int64(stmt, 0));
+            version.touch(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1)));
+        });
+    }
+
+    // Гость, его бронирования и номера этих бронирований (как на guest_detail)
+    PageVersion get_guest_page_version(int64_t guest_id) {
+        std::string sql = "SELECT g.version, g.updated_at, g.user_id, b.booking_id, b.version, b.updated_at, r.room_id, r.version, r.updated_at "
+                          "FROM guests g LEFT JOIN bookings b ON b.guest_id = g.guest_id LEFT JOIN rooms r ON r.room_id = b.room_id "
+                          "WHERE g.guest_id = ? ORDER BY b.booking_id";
+        return page_version(sql, guest_id, [](sqlite3_stmt* stmt, PageVersion& version) {
+            version.user_id = sqlite3_column_int64(stmt, 2);
+            for (int column : {0, 3, 4, 6, 7}) {
+                version.add(sqlite3_column_int64(stmt, column));
+            }
+            for (int column : {1, 5, 8}) {
+                version.touch(reinterpret_cast<const char*>(sqlite3_column_text(stmt, column)));
+            }
+        });
+    }
+
+    // Бронирование, гость и номер (как на booking_detail) и владельцы для проверки доступа
+    PageVersion get_booking_page_version(int64_t booking_id) {
+        std::string sql = "SELECT b.version, b.updated_at, g.guest_id, g.version, g.updated_at, r.room_id, r.version, r.updated_at, "
+                          "g.user_id, h.organization_id "
+                          "FROM bookings b LEFT JOIN guests g ON g.guest_id = b.guest_id LEFT JOIN rooms r ON r.room_id = b.room_id "
+                          "LEFT JOIN hotels h ON h.hotel_id = r.hotel_id WHERE b.booking_id = ?";
+        return page_version(sql, booking_id, [](sqlite3_stmt* stmt, PageVersion& version) {
+            version.user_id = sqlite3_column_int64(stmt, 8);
+            version.organization_id = sqlite3_column_int64(stmt, 9);
+            for (int column : {0, 2, 3, 5, 6}) {
+                version.add(sqlite3_column_int64(stmt, column));
+            }
+            for (int column : {1, 4, 7}) {
+                version.touch(reinterpret_cast<const char*>(sqlite3_column_text(stmt, column)));
+            }
+        });
+    }
+
+    ArenaVector<Booking> get_guest_bookings(int64_t guest_id) {
+        ArenaVector<Booking> bookings(RequestArena::current_resource());
         std::string sql = "SELECT booking_id, guest_id, room_id, check_in_date, check_out_date, adults_count, children_count, total_price, special_requests, created_at, updated_at FROM bookings WHERE guest_id = ? ORDER BY check_in_date DESC";
         sqlite3_stmt* stmt;
         
@@ -674,7 +1485,7 @@ public:
                 booking.special_requests = requests ? requests : "";
                 booking.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 9));
                 booking.updated_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 10));
-                bookings.push_back(booking);
+                bookings.push_back(std::move(booking));
             }
         }
         sqlite3_finalize(stmt);
@@ -703,6 +1514,149 @@ public:
         return available;
     }
 
+    // Поиск свободных интервалов не дальше этого числа дней от запрошенного
+    static constexpr int64_t FREE_WINDOW_HORIZON = 180;
+
+    // Ближайшие свободные интервалы той же длины, что [check_in, check_out): раньше
+    // (не раньше earliest, обычно сегодня) и позже запрошенного. Бронирования номера
+    // вокруг интервала читаются одним запросом по (room_id, check_out_date) в порядке
+    // заезда, промежутки между ними находятся за один проход - без перебора дат
+    // через is_room_available.
+    FreeWindows find_free_windows(int64_t room_id, const std::string& check_in, const std::string& check_out, const std::string& earliest) {
+        FreeWindows windows;
+        int64_t in_day = 0;
+        int64_t out_day = 0;
+        int64_t first_day = 0;
+        if (!date_utils::parse_day(check_in, in_day) || !date_utils::parse_day(check_out, out_day) ||
+            !date_utils::parse_day(earliest, first_day) || in_day >= out_day) {
+            return windows;
+        }
+        int64_t length = out_day - in_day;
+        int64_t from = std::max(first_day, in_day - FREE_WINDOW_HORIZON);
+        int64_t to = out_day + FREE_WINDOW_HORIZON;  // бронирования дальше не читаются
+
+        int64_t before = 0;
+        int64_t after = 0;
+        // Свободный промежуток [gap_start, gap_end): самое позднее начало раньше in_day
+        // и самое раннее позже in_day, при котором интервал целиком в промежутке
+        auto consider_gap = [&](int64_t gap_start, int64_t gap_end) {
+            int64_t latest = std::min(gap_end - length, in_day - 1);
+            if (latest >= gap_start) {
+                windows.before.found = true;
+                before = latest;
+            }
+            int64_t earliest_start = std::max(gap_start, in_day + 1);
+            if (!windows.after.found && earliest_start + length <= gap_end) {
+                windows.after.found = true;
+                after = earliest_start;
+            }
+        };
+
+        std::string from_date = date_utils::format_day(from);
+        std::string to_date = date_utils::format_day(to);
+        std::string sql = "SELECT check_in_date, check_out_date FROM bookings WHERE room_id = ? AND check_out_date > ? AND +check_in_date < ? ORDER BY check_in_date";
+        sqlite3_stmt* stmt;
+        int64_t cursor = from;  // начало текущего свободного промежутка
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
+            sqlite3_bind_int64(stmt, 1, room_id);
+            sqlite3_bind_text(stmt, 2, from_date.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt, 3, to_date.c_str(), -1, SQLITE_STATIC);
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                int64_t booked_in = 0;
+                int64_t booked_out = 0;
+                const char* booked_in_text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+                const char* booked_out_text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+                if (!booked_in_text || !booked_out_text || !date_utils::parse_day(booked_in_text, booked_in) ||
+                    !date_utils::parse_day(booked_out_text, booked_out)) {
+                    continue;
+                }
+                if (booked_in > cursor) {
+                    consider_gap(cursor, booked_in);
+                }
+                cursor = std::max(cursor, booked_out);
+            }
+        } else {
+            log_error("find_free_windows prepare", sqlite3_errmsg(db), sql);
+        }
+        sqlite3_finalize(stmt);
+        consider_gap(cursor, to);
+
+        if (windows.before.found) {
+            windows.before.check_in = date_utils::format_day(before);
+            windows.before.check_out = date_utils::format_day(before + length);
+        }
+        if (windows.after.found) {
+            windows.after.check_in = date_utils::format_day(after);
+            windows.after.check_out = date_utils::format_day(after + length);
+        }
+        return windows;
+    }
+
+    // Размещение в номерах типа type_name отеля на [check_in, check_out): свободные на весь
+    // срок номера, а если таких нет - цепочка номеров с наименьшим числом переездов.
+    // Занятость всех номеров типа на срок строится одной выборкой в OccupancyCalendar;
+    // цепочка - жадный проход по ночам: с текущей ночи берется номер, свободный дольше
+    // всех (это дает минимум отрезков). Срок - не больше OccupancyCalendar::MAX_DAYS ночей.
+    StayOptions find_stay_options(int64_t hotel_id, const std::string& type_name, const std::string& check_in, const std::string& check_out) {
+        StayOptions options;
+        int64_t in_day = 0;
+        int64_t out_day = 0;
+        if (!date_utils::parse_day(check_in, in_day) || !date_utils::parse_day(check_out, out_day) ||
+            in_day >= out_day || out_day - in_day > OccupancyCalendar::MAX_DAYS) {
+            return options;
+        }
+        int nights = static_cast<int>(out_day - in_day);
+
+        std::vector<Room> rooms;
+        for (auto& room : get_rooms_by_hotel(hotel_id)) {
+            if (room.type_name == type_name) {
+                rooms.push_back(std::move(room));
+            }
+        }
+        std::vector<int64_t> room_ids;
+        room_ids.reserve(rooms.size());
+        for (const auto& room : rooms) {
+            room_ids.push_back(room.room_id);
+        }
+        OccupancyCalendar calendar(in_day, nights, std::move(room_ids));
+        for (const auto& booking : get_hotel_bookings_between(hotel_id, check_in, check_out)) {
+            calendar.occupy(booking.room_id, booking.check_in_date, booking.check_out_date);
+        }
+
+        auto segment = [&](size_t room, int from, int to) {
+            return StaySegment{rooms[room].room_id, rooms[room].number,
+                               date_utils::format_day(in_day + from), date_utils::format_day(in_day + to)};
+        };
+        for (size_t room = 0; room < rooms.size(); ++room) {
+            if (calendar.next_occupied(room, 0) == nights) {
+                options.whole.push_back(segment(room, 0, nights));
+            }
+        }
+        if (!options.whole.empty()) {
+            return options;
+        }
+
+        int night = 0;
+        while (night < nights) {
+            size_t best = rooms.size();
+            int best_until = night;
+            for (size_t room = 0; room < rooms.size(); ++room) {
+                int until = calendar.next_occupied(room, night);
+                if (until > best_until) {
+                    best = room;
+                    best_until = until;
+                }
+            }
+            if (best == rooms.size()) {
+                options.split.clear();  // в эту ночь свободных номеров типа нет
+                break;
+            }
+            options.split.push_back(segment(best, night, best_until));
+            night = best_until;
+        }
+        return options;
+    }
+
     int64_t create_booking(const Booking& booking) {
         std::string now = get_current_datetime();
         std::string sql = "INSERT INTO bookings (guest_id, room_id, check_in_date, check_out_date, adults_count, children_count, total_price, special_requests, created_at, updated_at) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
@@ -742,7 +1696,7 @@ public:
 
     void update_booking(const Booking& booking) {
         std::string now = get_current_datetime();
-        std::string sql = "UPDATE bookings SET guest_id = ?, room_id = ?, check_in_date = ?, check_out_date = ?, adults_count = ?, children_count = ?, total_price = ?, special_requests = ?, updated_at = ? WHERE booking_id = ?";
+        std::string sql = "UPDATE bookings SET guest_id = ?, room_id = ?, check_in_date = ?, check_out_date = ?, adults_count = ?, children_count = ?, total_price = ?, special_requests = ?, updated_at = ?, version = version + 1 WHERE booking_id = ?";
         sqlite3_stmt* stmt;
         
         int prepare_result = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
@@ -798,8 +1752,8 @@ public:
         sqlite3_finalize(stmt);
     }
 
-    std::vector<Booking> get_bookings_by_hotel(int64_t hotel_id) {
-        std::vector<Booking> bookings;
+    ArenaVector<Booking> get_bookings_by_hotel(int64_t hotel_id) {
+        ArenaVector<Booking> bookings(RequestArena::current_resource());
         std::string sql = R"(
             SELECT b.booking_id, b.guest_id, b.room_id, b.check_in_date, b.check_out_date, 
                    b.adults_count, b.children_count, b.total_price, b.special_requests, 
@@ -827,15 +1781,25 @@ public:
                 booking.special_requests = requests ? requests : "";
                 booking.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 9));
                 booking.updated_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 10));
-                bookings.push_back(booking);
+                bookings.push_back(std::move(booking));
             }
         }
         sqlite3_finalize(stmt);
         return bookings;
     }
 
-    std::vector<Booking> get_bookings_by_user(int64_t user_id) {
-        std::vector<Booking> bookings;
+    // Бронирования отеля, затрагивающие дату: заезд <= date <= выезд (заезды, выезды и проживающие)
+    ArenaVector<Booking> get_hotel_bookings_on_date(int64_t hotel_id, const std::string& date) {
+        return select_hotel_bookings(hotel_id, "b.check_out_date >= ? AND +b.check_in_date <= ?", date, date);
+    }
+
+    // Бронирования отеля с ночами в периоде [from, to): выезд после from, заезд до to
+    ArenaVector<Booking> get_hotel_bookings_between(int64_t hotel_id, const std::string& from, const std::string& to) {
+        return select_hotel_bookings(hotel_id, "b.check_out_date > ? AND +b.check_in_date < ?", from, to);
+    }
+
+    ArenaVector<Booking> get_bookings_by_user(int64_t user_id) {
+        ArenaVector<Booking> bookings(RequestArena::current_resource());
         std::string sql = R"(
             SELECT b.booking_id, b.guest_id, b.room_id, b.check_in_date, b.check_out_date, 
                    b.adults_count, b.children_count, b.total_price, b.special_requests, 
@@ -863,7 +1827,7 @@ public:
                 booking.special_requests = requests ? requests : "";
                 booking.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 9));
                 booking.updated_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 10));
-                bookings.push_back(booking);
+                bookings.push_back(std::move(booking));
             }
         }
         sqlite3_finalize(stmt);
@@ -884,6 +1848,22 @@ public:
         return count;
     }
 
+    // Число номеров отеля по индексу idx_rooms_hotel, без чтения самих строк
+    int get_hotel_rooms_count(int64_t hotel_id) {
+        std::string sql = "SELECT COUNT(*) FROM rooms WHERE hotel_id = ?";
+        sqlite3_stmt* stmt;
+        int count = 0;
+
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
+            sqlite3_bind_int64(stmt, 1, hotel_id);
+            if (sqlite3_step(stmt) == SQLITE_ROW) {
+                count = sqlite3_column_int(stmt, 0);
+            }
+        }
+        sqlite3_finalize(stmt);
+        return count;
+    }
+
     int get_guests_count() {
         std::string sql = "SELECT COUNT(*) FROM guests";
         sqlite3_stmt* stmt;
@@ -1026,6 +2006,7 @@ public:
             throw std::runtime_error("Failed to update user: " + error + " (code: " + error_code + ")");
         }
         sqlite3_finalize(stmt);
+        notify_user_changed(user.user_id);
     }
 
     void update_user_password(int64_t user_id, const std::string& new_password) {
@@ -1053,6 +2034,77 @@ public:
             throw std::runtime_error("Failed to update password: " + error + " (code: " + error_code + ")");
         }
         sqlite3_finalize(stmt);
+        notify_user_changed(user_id);
+    }
+
+    // Session operations
+    void create_session(const std::string& token, int64_t user_id, int64_t expires_at) {
+        std::string sql = "INSERT INTO sessions (token, user_id, expires_at) VALUES (?, ?, ?)";
+        sqlite3_stmt* stmt;
+
+        int prepare_result = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
+        if (prepare_result != SQLITE_OK) {
+            std::string error = sqlite3_errmsg(db);
+            log_error("create_session (prepare)", error, sql);
+            throw std::runtime_error("Failed to prepare statement: " + error);
+        }
+
+        sqlite3_bind_text(stmt, 1, token.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 2, user_id);
+        sqlite3_bind_int64(stmt, 3, expires_at);
+
+        int step_result = sqlite3_step(stmt);
+        if (step_result != SQLITE_DONE) {
+            std::string error = sqlite3_errmsg(db);
+            std::string error_code = std::to_string(step_result);
+            log_error("create_session (step)", "SQLite error code " + error_code + ": " + error, sql);
+            sqlite3_finalize(stmt);
+            throw std::runtime_error("Failed to create session: " + error + " (code: " + error_code + ")");
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    bool get_session(const std::string& token, int64_t& user_id, int64_t& expires_at) {
+        std::string sql = "SELECT user_id, expires_at FROM sessions WHERE token = ?";
+        sqlite3_stmt* stmt;
+        bool found = false;
+
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
+            sqlite3_bind_text(stmt, 1, token.c_str(), -1, SQLITE_STATIC);
+            if (sqlite3_step(stmt) == SQLITE_ROW) {
+                user_id = sqlite3_column_int64(stmt, 0);
+                expires_at = sqlite3_column_int64(stmt, 1);
+                found = true;
+            }
+        }
+        sqlite3_finalize(stmt);
+        return found;
+    }
+
+    void delete_session(const std::string& token) {
+        std::string sql = "DELETE FROM sessions WHERE token = ?";
+        sqlite3_stmt* stmt;
+
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
+            sqlite3_bind_text(stmt, 1, token.c_str(), -1, SQLITE_STATIC);
+            if (sqlite3_step(stmt) != SQLITE_DONE) {
+                log_error("delete_session (step)", sqlite3_errmsg(db), sql);
+            }
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    void delete_expired_sessions(int64_t now) {
+        std::string sql = "DELETE FROM sessions WHERE expires_at <= ?";
+        sqlite3_stmt* stmt;
+
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
+            sqlite3_bind_int64(stmt, 1, now);
+            if (sqlite3_step(stmt) != SQLITE_DONE) {
+                log_error("delete_expired_sessions (step)", sqlite3_errmsg(db), sql);
+            }
+        }
+        sqlite3_finalize(stmt);
     }
 
     // Hotel operations
@@ -1089,8 +2141,8 @@ public:
         return id;
     }
 
-    std::vector<Hotel> get_hotels_by_organization(int64_t organization_id) {
-        std::vector<Hotel> hotels;
+    ArenaVector<Hotel> get_hotels_by_organization(int64_t organization_id) {
+        ArenaVector<Hotel> hotels(RequestArena::current_resource());
         std::string sql = "SELECT hotel_id, organization_id, name, description, address, created_at, updated_at FROM hotels WHERE organization_id = ? ORDER BY name";
         sqlite3_stmt* stmt;
         
@@ -1107,7 +2159,7 @@ public:
                 hotel.address = addr ? addr : "";
                 hotel.created_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
                 hotel.updated_at = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 6));
-                hotels.push_back(hotel);
+                hotels.push_back(std::move(hotel));
             }
         }
         sqlite3_finalize(stmt);
@@ -1136,7 +2188,169 @@ public:
         sqlite3_finalize(stmt);
         return hotel;
     }
+
+    // Пакетная проверка доступности: одна выборка бронирований всех затронутых номеров
+    // в общем окне дат, отсортированная по (номер, заезд), затем для каждого запроса -
+    // двоичный поиск по заездам и максимум выездов на префиксе. Результат - в порядке queries.
+    std::vector<Availability> check_availability(const std::vector<AvailabilityQuery>& queries) {
+        std::vector<Availability> result(queries.size(), Availability::UnknownRoom);
+        if (queries.empty()) {
+            return result;
+        }
+        ArenaVector<int64_t> room_ids(RequestArena::current_resource());
+        std::string window_start = queries.front().check_in;
+        std::string window_end = queries.front().check_out;
+        for (const auto& query : queries) {
+            room_ids.push_back(query.room_id);
+            window_start = std::min(window_start, query.check_in);
+            window_end = std::max(window_end, query.check_out);
+        }
+        auto rooms = select_by_ids<int64_t>("SELECT room_id FROM rooms", "room_id", room_ids,
+                                            [](sqlite3_stmt* stmt) { return sqlite3_column_int64(stmt, 0); });
+        room_ids.clear();
+        for (const auto& room : rooms) {
+            room_ids.push_back(room.first);
+        }
+        std::sort(room_ids.begin(), room_ids.end());
+
+        // Заезды и выезды каждого номера; prefix_out[i] - самый поздний выезд среди первых i+1 заездов
+        struct Stays {
+            std::vector<std::string> check_in;
+            std::vector<std::string> prefix_out;
+        };
+        std::unordered_map<int64_t, Stays> stays;
+        const size_t chunk = 500;
+        for (size_t offset = 0; offset < room_ids.size(); offset += chunk) {
+            size_t count = std::min(chunk, room_ids.size() - offset);
+            std::string sql = "SELECT room_id, check_in_date, check_out_date FROM bookings WHERE room_id IN (?";
+            for (size_t i = 1; i < count; ++i) {
+                sql += ", ?";
+            }
+            sql += ") AND check_in_date < ? AND check_out_date > ? ORDER BY room_id, check_in_date";
+
+            sqlite3_stmt* stmt;
+            if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+                log_error("check_availability prepare", sqlite3_errmsg(db), sql);
+                sqlite3_finalize(stmt);
+                throw std::runtime_error("Failed to prepare statement: " + std::string(sqlite3_errmsg(db)));
+            }
+            int index = 1;
+            for (size_t i = 0; i < count; ++i) {
+                sqlite3_bind_int64(stmt, index++, room_ids[offset + i]);
+            }
+            sqlite3_bind_text(stmt, index++, window_end.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt, index, window_start.c_str(), -1, SQLITE_STATIC);
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                Stays& room = stays[sqlite3_column_int64(stmt, 0)];
+                room.check_in.emplace_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1)));
+                std::string check_out = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+                if (!room.prefix_out.empty() && room.prefix_out.back() > check_out) {
+                    check_out = room.prefix_out.back();
+                }
+                room.prefix_out.push_back(std::move(check_out));
+            }
+            sqlite3_finalize(stmt);
+        }
+
+        for (size_t i = 0; i < queries.size(); ++i) {
+            const auto& query = queries[i];
+            if (!rooms.count(query.room_id)) {
+                continue;
+            }
+            result[i] = Availability::Free;
+            auto it = stays.find(query.room_id);
+            if (it == stays.end()) {
+                continue;
+            }
+            // Пересекаются бронирования с заездом раньше query.check_out и выездом позже query.check_in
+            const Stays& room = it->second;
+            size_t before_out = static_cast<size_t>(std::lower_bound(room.check_in.begin(), room.check_in.end(), query.check_out) -
+                                                    room.check_in.begin());
+            if (before_out > 0 && room.prefix_out[before_out - 1] > query.check_in) {
+                result[i] = Availability::Booked;
+            }
+        }
+        return result;
+    }
+
+    // Слушатель новых записей журнала изменений (аргумент - seq), см. update_callback
+    void add_change_listener(std::function<void(int64_t)> listener) {
+        change_listeners.push_back(std::move(listener));
+    }
+
+    int64_t get_last_change_seq() {
+        int64_t seq = 0;
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, "SELECT COALESCE(MAX(seq), 0) FROM changes", -1, &stmt, nullptr) == SQLITE_OK &&
+            sqlite3_step(stmt) == SQLITE_ROW) {
+            seq = sqlite3_column_int64(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+        return seq;
+    }
+
+    // Записи журнала одного отеля после since по возрастанию seq. Права на отель проверяет вызывающий
+    ArenaVector<Change> get_changes(int64_t since, size_t limit, int64_t hotel_id) {
+        std::string sql = std::string("SELECT ") + CHANGE_COLUMNS + " FROM changes c WHERE c.hotel_id = ? AND c.seq > ? ORDER BY c.seq LIMIT ?";
+        return select_page<Change>(sql, hotel_id, since, limit, read_change);
+    }
+
+    // Записи журнала по отелям организации (и о самих отелях)
+    ArenaVector<Change> get_organization_changes(int64_t organization_id, int64_t since, size_t limit) {
+        std::string sql = std::string("SELECT ") + CHANGE_COLUMNS +
+                          " FROM changes c JOIN hotels h ON h.hotel_id = c.hotel_id WHERE h.organization_id = ? AND c.seq > ? ORDER BY c.seq LIMIT ?";
+        return select_page<Change>(sql, organization_id, since, limit, read_change);
+    }
+
+    // Журнал растет с каждым изменением: записи старше keep_days дней удаляются при запуске
+    // (см. ServerConfig::change_retention_days). seq не переиспользуется и после очистки,
+    // клиент со старым курсором просто не получит удаленные записи
+    int prune_changes(int64_t keep_days) {
+        std::string sql = "DELETE FROM changes WHERE changed_at < datetime('now', 'localtime', ?)";
+        std::string modifier = "-" + std::to_string(keep_days) + " days";
+        sqlite3_stmt* stmt;
+        int removed = 0;
+
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
+            sqlite3_bind_text(stmt, 1, modifier.c_str(), -1, SQLITE_STATIC);
+            if (sqlite3_step(stmt) == SQLITE_DONE) {
+                removed = sqlite3_changes(db);
+            } else {
+                log_error("prune_changes (step)", sqlite3_errmsg(db), sql);
+            }
+        }
+        sqlite3_finalize(stmt);
+        return removed;
+    }
+
+    // Постраничные выборки для API: по возрастанию первичного ключа начиная после after_id
+    // (keyset-пагинация, стоимость не зависит от номера страницы)
+
+    ArenaVector<Hotel> get_hotels_page(int64_t after_id, size_t limit) {
+        std::string sql = std::string("SELECT ") + HOTEL_COLUMNS + " FROM hotels WHERE hotel_id > ? ORDER BY hotel_id LIMIT ?";
+        return select_page<Hotel>(sql, 0, after_id, limit, read_hotel);
+    }
+
+    // hotel_id = 0 - номера всех отелей
+    ArenaVector<Room> get_rooms_page(int64_t hotel_id, int64_t after_id, size_t limit) {
+        std::string sql = std::string("SELECT ") + ROOM_COLUMNS + " FROM rooms WHERE " +
+                          (hotel_id != 0 ? "hotel_id = ? AND " : "") + "room_id > ? ORDER BY room_id LIMIT ?";
+        return select_page<Room>(sql, hotel_id, after_id, limit, read_room);
+    }
+
+    ArenaVector<Guest> get_guests_page(int64_t user_id, int64_t after_id, size_t limit) {
+        std::string sql = std::string("SELECT ") + GUEST_COLUMNS + " FROM guests WHERE user_id = ? AND guest_id > ? ORDER BY guest_id LIMIT ?";
+        return select_page<Guest>(sql, user_id, after_id, limit, read_guest);
+    }
+
+    // Бронирования гостей пользователя или, для организации, бронирования в ее отелях
+    ArenaVector<Booking> get_bookings_page(int64_t user_id, bool organization, int64_t after_id, size_t limit) {
+        std::string sql = std::string("SELECT ") + BOOKING_COLUMNS + " FROM bookings b " +
+                          (organization ? "JOIN rooms r ON r.room_id = b.room_id JOIN hotels h ON h.hotel_id = r.hotel_id WHERE h.organization_id = ?"
+                                        : "JOIN guests g ON g.guest_id = b.guest_id WHERE g.user_id = ?") +
+                          " AND b.booking_id > ? ORDER BY b.booking_id LIMIT ?";
+        return select_page<Booking>(sql, user_id, after_id, limit, read_booking);
+    }
 };
 
 #endif // DATABASE_H
-
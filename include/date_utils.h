@@ -0,0 +1,82 @@
+#ifndef DATE_UTILS_H
+#define DATE_UTILS_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Даты "ГГГГ-ММ-ДД" как номера дней от 1970-01-01: сложение дней и разность дат
+// без time_t, mktime и часового пояса (алгоритм days_from_civil / civil_from_days).
+namespace date_utils {
+
+inline int64_t days_from_civil(int64_t year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    unsigned year_of_era = static_cast<unsigned>(year - era * 400);
+    unsigned day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    unsigned day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + static_cast<int64_t>(day_of_era) - 719468;
+}
+
+inline unsigned days_in_month(int64_t year, unsigned month) {
+    static const unsigned days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return month == 2 && leap ? 29 : days[month - 1];
+}
+
+// Строгий разбор: ровно "ГГГГ-ММ-ДД" и существующая дата; false - дата неверна
+inline bool parse_day(const std::string& date, int64_t& day) {
+    if (date.size() != 10 || date[4] != '-' || date[7] != '-') {
+        return false;
+    }
+    unsigned parts[3] = {0, 0, 0};
+    const size_t starts[3] = {0, 5, 8};
+    const size_t lengths[3] = {4, 2, 2};
+    for (int i = 0; i < 3; ++i) {
+        for (size_t j = starts[i]; j < starts[i] + lengths[i]; ++j) {
+            if (date[j] < '0' || date[j] > '9') {
+                return false;
+            }
+            parts[i] = parts[i] * 10 + static_cast<unsigned>(date[j] - '0');
+        }
+    }
+    if (parts[1] < 1 || parts[1] > 12 || parts[2] < 1 || parts[2] > days_in_month(parts[0], parts[1])) {
+        return false;
+    }
+    day = days_from_civil(parts[0], parts[1], parts[2]);
+    return true;
+}
+
+struct CivilDate {
+    int64_t year;
+    unsigned month;
+    unsigned day;
+};
+
+inline CivilDate civil_from_days(int64_t day) {
+    day += 719468;
+    int64_t era = (day >= 0 ? day : day - 146096) / 146097;
+    unsigned day_of_era = static_cast<unsigned>(day - era * 146097);
+    unsigned year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    unsigned day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    unsigned month_index = (5 * day_of_year + 2) / 153;  // март = 0
+    unsigned month = month_index < 10 ? month_index + 3 : month_index - 9;
+    return {static_cast<int64_t>(year_of_era) + era * 400 + (month <= 2), month, day_of_year - (153 * month_index + 2) / 5 + 1};
+}
+
+inline std::string format_day(int64_t day) {
+    CivilDate date = civil_from_days(day);
+    char buffer[16];
+    std::snprintf(buffer, sizeof(buffer), "%04lld-%02u-%02u", static_cast<long long>(date.year), date.month, date.day);
+    return buffer;
+}
+
+// День недели: 0 - понедельник, 6 - воскресенье (1970-01-01 - четверг)
+inline unsigned weekday(int64_t day) {
+    int64_t shifted = (day + 3) % 7;
+    return static_cast<unsigned>(shifted >= 0 ? shifted : shifted + 7);
+}
+
+} // namespace date_utils
+
+#endif // DATE_UTILS_H
@@ -3,41 +3,338 @@
 
 #include "models.h"
 #include "database.h"
+#include "occupancy.h"
+#include "request_arena.h"
+#include "tracing.h"
 #include <string>
+#include <string_view>
 #include <vector>
 #include <sstream>
 #include <algorithm>
 #include <iomanip>
 #include <map>
 
+namespace html_escape {
+
+// Экранированный текст выводится в поток по участкам, без временной строки
+struct Escaped {
+    std::string_view text;
+
+    friend std::ostream& operator<<(std::ostream& os, const Escaped& escaped) {
+        std::string_view text = escaped.text;
+        size_t start = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            const char* entity = nullptr;
+            switch (text[i]) {
+                case '&': entity = "&amp;"; break;
+                case '<': entity = "&lt;"; break;
+                case '>': entity = "&gt;"; break;
+                case '"': entity = "&quot;"; break;
+                case '\'': entity = "&#39;"; break;
+                default: continue;
+            }
+            os.write(text.data() + start, static_cast<std::streamsize>(i - start));
+            os << entity;
+            start = i + 1;
+        }
+        os.write(text.data() + start, static_cast<std::streamsize>(text.size() - start));
+        return os;
+    }
+};
+
+// ФИО гостя, собранное прямо в потоке вместо Guest::full_name()
+struct EscapedFullName {
+    const Guest& guest;
+
+    friend std::ostream& operator<<(std::ostream& os, const EscapedFullName& name) {
+        os << Escaped{name.guest.last_name} << ' ' << Escaped{name.guest.first_name};
+        if (!name.guest.middle_name.empty()) {
+            os << ' ' << Escaped{name.guest.middle_name};
+        }
+        return os;
+    }
+};
+
+// Начало описания для карточки номера, с "..." если текст длиннее limit
+struct EscapedExcerpt {
+    std::string_view text;
+    size_t limit;
+
+    friend std::ostream& operator<<(std::ostream& os, const EscapedExcerpt& excerpt) {
+        if (excerpt.text.size() <= excerpt.limit) {
+            return os << Escaped{excerpt.text};
+        }
+        return os << Escaped{excerpt.text.substr(0, excerpt.limit)} << "...";
+    }
+};
+
+} // namespace html_escape
+
 class HtmlGenerator {
 private:
-    static std::string escape_html(const std::string& text) {
-        std::string result;
-        for (char c : text) {
-            switch (c) {
-                case '&': result += "&amp;"; break;
-                case '<': result += "&lt;"; break;
-                case '>': result += "&gt;"; break;
-                case '"': result += "&quot;"; break;
-                case '\'': result += "&#39;"; break;
-                default: result += c; break;
+    static html_escape::Escaped escape_html(std::string_view text) {
+        return html_escape::Escaped{text};
+    }
+
+    static html_escape::EscapedFullName escape_full_name(const Guest& guest) {
+        return html_escape::EscapedFullName{guest};
+    }
+
+    static html_escape::EscapedExcerpt escape_excerpt(std::string_view text, size_t limit) {
+        return html_escape::EscapedExcerpt{text, limit};
+    }
+
+    // Идентификаторы связанных строк для пакетной выборки (get_guests_by_ids и т.п.)
+    template <typename Rows, typename Key>
+    static ArenaVector<int64_t> collect_ids(const Rows& rows, Key key) {
+        ArenaVector<int64_t> ids(RequestArena::current_resource());
+        ids.reserve(rows.size());
+        for (const auto& row : rows) {
+            ids.push_back(key(row));
+        }
+        return ids;
+    }
+
+    // Строка из пакетной выборки; пустая, если не найдена (как get_guest / get_room)
+    template <typename T>
+    static const T& find_or_empty(const ArenaMap<int64_t, T>& rows, int64_t id) {
+        static const T empty{};
+        auto it = rows.find(id);
+        return it != rows.end() ? it->second : empty;
+    }
+
+    // Формы поиска и фильтра с data-fragment запрашивают только область результатов
+    // (data-target) и подменяют ее; адрес страницы обновляется, чтобы работали
+    // обновление и закладки. Без JavaScript форма отправляется как обычно.
+    static constexpr std::string_view FRAGMENT_SCRIPT = R"(
+
+<script>
+(function() {
+    document.querySelectorAll('form[data-fragment]').forEach(function(form) {
+        const target = document.getElementById(form.dataset.target);
+        if (!target || !window.fetch) {
+            return;
+        }
+        let pending = null;
+        let timer = null;
+        function load() {
+            const query = new URLSearchParams(new FormData(form)).toString();
+            if (pending) {
+                pending.abort();
             }
+            pending = new AbortController();
+            fetch(form.dataset.fragment + '?' + query, {signal: pending.signal, credentials: 'same-origin'})
+                .then(function(response) {
+                    // Истекшая сессия: вместо фрагмента пришла бы страница входа
+                    if (!response.ok || response.redirected) {
+                        throw new Error(response.status);
+                    }
+                    return response.text();
+                })
+                .then(function(html) {
+                    target.innerHTML = html;
+                    history.replaceState(null, '', form.action + (query ? '?' + query : ''));
+                })
+                .catch(function(error) {
+                    if (error.name !== 'AbortError') {
+                        form.submit();
+                    }
+                });
         }
-        return result;
+        form.addEventListener('submit', function(event) {
+            event.preventDefault();
+            load();
+        });
+        form.querySelectorAll('select').forEach(function(select) {
+            select.addEventListener('change', load);
+        });
+        form.querySelectorAll('input[type="text"]').forEach(function(input) {
+            input.addEventListener('input', function() {
+                clearTimeout(timer);
+                timer = setTimeout(load, 250);
+            });
+        });
+    });
+})();
+</script>)";
+
+    // Карточки номеров rooms_list; они же - ответ /rooms/fragment/
+    template <typename Rooms>
+    static void write_room_cards(HtmlStream& content, const Rooms& rooms) {
+        if (rooms.empty()) {
+            content << R"(
+    <div class="col-12">
+        <p class="text-muted">Номера не найдены</p>
+    </div>)";
+        } else {
+            for (const auto& room : rooms) {
+                content << R"(
+    <div class="col-md-4 mb-4">
+        <div class="card h-100">
+            <div class="card-body">
+                <h5 class="card-title">)" << escape_html(room.name) << R"(</h5>
+                <p class="text-muted">Номер: )" << escape_html(room.number) << R"(</p>
+                <p class="card-text">)" << escape_excerpt(room.description, 150) << R"(</p>
+                <p class="badge bg-primary">)" << escape_html(room.type_name) << R"(</p>
+                <p class="mt-2"><strong>Цена за день:</strong> )" << std::fixed << std::setprecision(2) << room.price_per_day << R"( руб.</p>
+            </div>
+            <div class="card-footer">
+                <a href="/rooms/)" << room.room_id << R"(/" class="btn btn-primary">Подробнее</a>
+            </div>
+        </div>
+    </div>)";
+            }
+        }
+    }
+
+    // Строки таблицы guests_list; они же - ответ /guests/fragment/
+    template <typename Guests>
+    static void write_guest_rows(HtmlStream& content, const Guests& guests) {
+        if (guests.empty()) {
+            content << R"(
+                <tr>
+                    <td colspan="5" class="text-center text-muted">Гости не найдены</td>
+                </tr>)";
+        } else {
+            for (const auto& guest : guests) {
+                content << R"(
+                <tr>
+                    <td>)" << escape_full_name(guest) << R"(</td>
+                    <td>)" << escape_html(guest.passport_number) << R"(</td>
+                    <td>)" << escape_html(guest.phone) << R"(</td>
+                    <td>)" << escape_html(guest.email) << R"(</td>
+                    <td><a href="/guests/)" << guest.guest_id << R"(/" class="btn btn-sm btn-primary">Подробнее</a></td>
+                </tr>)";
+            }
+        }
+    }
+
+    // Строки таблицы bookings_list; они же - ответ /bookings/fragment/
+    template <typename Bookings>
+    static void write_booking_rows(HtmlStream& content, Database& db, const Bookings& bookings) {
+        if (bookings.empty()) {
+            content << R"(
+                <tr>
+                    <td colspan="7" class="text-center text-muted">Бронирования не найдены</td>
+                </tr>)";
+        } else {
+            auto guests = db.get_guests_by_ids(collect_ids(bookings, [](const Booking& b) { return b.guest_id; }));
+            auto rooms = db.get_rooms_by_ids(collect_ids(bookings, [](const Booking& b) { return b.room_id; }));
+            for (const auto& booking : bookings) {
+                const Guest& guest = find_or_empty(guests, booking.guest_id);
+                const Room& room = find_or_empty(rooms, booking.room_id);
+                content << R"(
+                <tr>
+                    <td>)" << booking.booking_id << R"(</td>
+                    <td>)" << escape_full_name(guest) << R"(</td>
+                    <td>)" << escape_html(room.number) << R"(</td>
+                    <td>)" << escape_html(booking.check_in_date) << R"(</td>
+                    <td>)" << escape_html(booking.check_out_date) << R"(</td>
+                    <td>)" << std::fixed << std::setprecision(2) << booking.total_price << R"( руб.</td>
+                    <td><a href="/bookings/)" << booking.booking_id << R"(/" class="btn btn-sm btn-primary">Подробнее</a></td>
+                </tr>)";
+            }
+        }
+    }
+
+    // Строка таблицы бронирований отеля; та же разметка уходит в поток SSE (hotel_booking_row)
+    static void write_hotel_booking_row(HtmlStream& content, const Booking& booking, const Guest& guest, const Room& room) {
+        content << R"(
+                <tr data-booking-id=")" << booking.booking_id << R"(" data-check-in=")" << escape_html(booking.check_in_date) << R"(">
+                    <td>)" << booking.booking_id << R"(</td>
+                    <td>)" << escape_full_name(guest) << R"(</td>
+                    <td>)" << escape_html(room.number) << R"(</td>
+                    <td>)" << escape_html(booking.check_in_date) << R"(</td>
+                    <td>)" << escape_html(booking.check_out_date) << R"(</td>
+                    <td>)" << std::fixed << std::setprecision(2) << booking.total_price << R"( руб.</td>
+                    <td>
+                        <a href="/bookings/)" << booking.booking_id << R"(/edit/" class="btn btn-sm btn-primary">Редактировать</a>
+                        <a href="/bookings/)" << booking.booking_id << R"(/" class="btn btn-sm btn-secondary">Подробнее</a>
+                    </td>
+                </tr>)";
+    }
+
+    // Варианты выбора в форме бронирования; они же - ответы /rooms/suggest/ и /guests/suggest/
+    static void write_room_option(HtmlStream& content, const Room& room, bool selected) {
+        content << R"(
+                            <option value=")" << room.room_id << R"(" data-price=")" << room.price_per_day << R"(")" << (selected ? " selected" : "") << R"(>)" << escape_html(room.number) << " - " << escape_html(room.name) << " (" << std::fixed << std::setprecision(2) << room.price_per_day << " руб./день)" << R"(</option>)";
+    }
+
+    static void write_guest_option(HtmlStream& content, const Guest& guest, bool selected) {
+        content << R"(
+                            <option value=")" << guest.guest_id << R"(")" << (selected ? " selected" : "") << R"(>)" << escape_full_name(guest) << R"(</option>)";
+    }
+
+    // Раздел стойки регистрации: таблица как в hotel_bookings_list
+    template <typename Guests, typename Rooms>
+    static void write_front_desk_section(HtmlStream& content, const char* title, const std::vector<const Booking*>& bookings,
+                                         const Guests& guests, const Rooms& rooms) {
+        content << R"(
+<div class="row mb-4">
+    <div class="col-12">
+        <h3>)" << title << R"( <span class="badge bg-secondary">)" << bookings.size() << R"(</span></h3>
+        <table class="table table-striped">
+            <thead>
+                <tr>
+                    <th>ID</th>
+                    <th>Гость</th>
+                    <th>Номер</th>
+                    <th>Заезд</th>
+                    <th>Выезд</th>
+                    <th>Стоимость</th>
+                    <th>Действия</th>
+                </tr>
+            </thead>
+            <tbody>)";
+        if (bookings.empty()) {
+            content << R"(
+                <tr>
+                    <td colspan="7" class="text-center text-muted">Нет</td>
+                </tr>)";
+        }
+        for (const Booking* booking : bookings) {
+            write_hotel_booking_row(content, *booking, find_or_empty(guests, booking->guest_id), find_or_empty(rooms, booking->room_id));
+        }
+        content << R"(
+            </tbody>
+        </table>
+    </div>
+</div>)";
+    }
+
+    // Номера одного отеля из выборки get_rooms_by_organization (упорядочена по hotel_id)
+    struct HotelRooms {
+        const Room* first;
+        const Room* last;
+        const Room* begin() const { return first; }
+        const Room* end() const { return last; }
+        bool empty() const { return first == last; }
+        size_t size() const { return static_cast<size_t>(last - first); }
+    };
+
+    static HotelRooms rooms_of_hotel(const ArenaVector<Room>& rooms, int64_t hotel_id) {
+        auto lower = std::lower_bound(rooms.begin(), rooms.end(), hotel_id, [](const Room& room, int64_t id) {
+            return room.hotel_id < id;
+        });
+        auto upper = std::upper_bound(lower, rooms.end(), hotel_id, [](int64_t id, const Room& room) {
+            return id < room.hotel_id;
+        });
+        return HotelRooms{rooms.data() + (lower - rooms.begin()), rooms.data() + (upper - rooms.begin())};
     }
 
 public:
-    static std::string base_template(const std::string& title, const std::string& content, const std::string& messages = "", const User* user = nullptr) {
-        std::ostringstream html;
-        html << R"(<!DOCTYPE html>
+    // Неизменные части макета base_template. Вынесены в константы, чтобы сжать их
+    // один раз при запуске (см. layout_slots и Compression::set_layout).
+    // {bootstrap_css} и другие подстановки заменяются URL статических файлов в set_static_urls.
+    static constexpr std::string_view LAYOUT_HEAD = R"(<!DOCTYPE html>
 <html lang="ru">
 <head>
     <meta charset="UTF-8">
     <meta name="viewport" content="width=device-width, initial-scale=1.0">
-    <title>)" << escape_html(title) << R"(</title>
-    <link href="https://cdn.jsdelivr.net/npm/bootstrap@5.3.0/dist/css/bootstrap.min.css" rel="stylesheet">
-    <link rel="stylesheet" href="https://cdn.jsdelivr.net/npm/bootstrap-icons@1.10.0/font/bootstrap-icons.css">
+    <title>)";
+    static constexpr std::string_view LAYOUT_NAV_START = R"(</title>
+    <link href="{bootstrap_css}" rel="stylesheet">
+    <link rel="stylesheet" href="{bootstrap_icons_css}">
     <style>
         body { min-height: 100vh; display: flex; flex-direction: column; }
         main { flex: 1; }
@@ -71,33 +368,26 @@ public:
                     <li class="nav-item"><a class="nav-link" href="/rooms/">Номера</a></li>
                     <li class="nav-item"><a class="nav-link" href="/guests/">Гости</a></li>
                     <li class="nav-item"><a class="nav-link" href="/bookings/">Бронирования</a></li>)";
-        
-        if (user && user->user_id != 0) {
-            html << R"(
-                    <li class="nav-item"><a class="nav-link" href="/profile/"><i class="bi bi-person-circle"></i> Профиль</a></li>)";
-            if (user->is_organization()) {
-                html << R"(
-                    <li class="nav-item"><a class="nav-link" href="/organization/dashboard/"><i class="bi bi-building"></i> Панель</a></li>)";
-            } else {
-                html << R"(
-                    <li class="nav-item"><a class="nav-link" href="/my-bookings/"><i class="bi bi-calendar-check"></i> Мои бронирования</a></li>)";
-            }
-            html << R"(
+    static constexpr std::string_view NAV_ORGANIZATION = R"(
+                    <li class="nav-item"><a class="nav-link" href="/profile/"><i class="bi bi-person-circle"></i> Профиль</a></li>
+                    <li class="nav-item"><a class="nav-link" href="/organization/dashboard/"><i class="bi bi-building"></i> Панель</a></li>
                     <li class="nav-item"><a class="nav-link" href="/logout/"><i class="bi bi-box-arrow-right"></i> Выход</a></li>)";
-        } else {
-            html << R"(
+    static constexpr std::string_view NAV_GUEST_USER = R"(
+                    <li class="nav-item"><a class="nav-link" href="/profile/"><i class="bi bi-person-circle"></i> Профиль</a></li>
+                    <li class="nav-item"><a class="nav-link" href="/my-bookings/"><i class="bi bi-calendar-check"></i> Мои бронирования</a></li>
+                    <li class="nav-item"><a class="nav-link" href="/logout/"><i class="bi bi-box-arrow-right"></i> Выход</a></li>)";
+    static constexpr std::string_view NAV_ANONYMOUS = R"(
                     <li class="nav-item"><a class="nav-link" href="/login/"><i class="bi bi-box-arrow-in-right"></i> Вход</a></li>
                     <li class="nav-item"><a class="nav-link" href="/register/">Регистрация</a></li>)";
-        }
-        
-        html << R"(
+    static constexpr std::string_view LAYOUT_NAV_END = R"(
                     <li class="nav-item"><a class="nav-link" href="/contact/">Контакты</a></li>
                 </ul>
             </div>
         </div>
     </nav>
 
-    <main class="container my-4">)" << messages << content << R"(
+    <main class="container my-4">)";
+    static constexpr std::string_view LAYOUT_FOOTER = R"(
     </main>
 
     <footer class="py-4 mt-5">
@@ -106,12 +396,76 @@ public:
         </div>
     </footer>
 
-    <script src="https://cdn.jsdelivr.net/npm/bootstrap@5.3.0/dist/js/bootstrap.bundle.min.js"></script>
+    <script src="{bootstrap_js}"></script>
 </body>
 </html>)";
+
+    // Адреса по умолчанию, пока сервер не отдает собственные файлы из /static/
+    static constexpr std::string_view CDN_BOOTSTRAP_CSS = "https://cdn.jsdelivr.net/npm/bootstrap@5.3.0/dist/css/bootstrap.min.css";
+    static constexpr std::string_view CDN_BOOTSTRAP_ICONS_CSS = "https://cdn.jsdelivr.net/npm/bootstrap-icons@1.10.0/font/bootstrap-icons.css";
+    static constexpr std::string_view CDN_BOOTSTRAP_JS = "https://cdn.jsdelivr.net/npm/bootstrap@5.3.0/dist/js/bootstrap.bundle.min.js";
+
+private:
+    struct Layout {
+        std::string nav_start;
+        std::string footer;
+    };
+
+    static std::string substitute(std::string_view text, std::string_view name, std::string_view value) {
+        std::string result(text);
+        size_t pos = result.find(name);
+        if (pos != std::string::npos) {
+            result.replace(pos, name.size(), value);
+        }
+        return result;
+    }
+
+    static Layout make_layout(std::string_view bootstrap_css, std::string_view bootstrap_icons_css, std::string_view bootstrap_js) {
+        Layout layout;
+        layout.nav_start = substitute(substitute(LAYOUT_NAV_START, "{bootstrap_css}", bootstrap_css),
+                                      "{bootstrap_icons_css}", bootstrap_icons_css);
+        layout.footer = substitute(LAYOUT_FOOTER, "{bootstrap_js}", bootstrap_js);
+        return layout;
+    }
+
+    static Layout& layout() {
+        static Layout instance = make_layout(CDN_BOOTSTRAP_CSS, CDN_BOOTSTRAP_ICONS_CSS, CDN_BOOTSTRAP_JS);
+        return instance;
+    }
+
+public:
+    // Подставляет в макет URL локальных статических файлов; вызывается до запуска сервера
+    static void set_static_urls(std::string_view bootstrap_css, std::string_view bootstrap_icons_css, std::string_view bootstrap_js) {
+        layout() = make_layout(bootstrap_css, bootstrap_icons_css, bootstrap_js);
+    }
+
+    static std::string base_template(std::string_view title, std::string_view content, std::string_view messages = "", const User* user = nullptr) {
+        TraceSpan trace(__func__, "render");
+        HtmlStream html(content.size() + messages.size() + 4096);
+        const Layout& parts = layout();
+        html << LAYOUT_HEAD << escape_html(title) << parts.nav_start;
+        if (user && user->user_id != 0) {
+            html << (user->is_organization() ? NAV_ORGANIZATION : NAV_GUEST_USER);
+        } else {
+            html << NAV_ANONYMOUS;
+        }
+        html << LAYOUT_NAV_END << messages << content << parts.footer;
         return html.str();
     }
+
+    // Части макета в порядке следования; в одном слоте - взаимоисключающие варианты меню
+    static std::vector<std::vector<std::string_view>> layout_slots() {
+        return {
+            {LAYOUT_HEAD},
+            {layout().nav_start},
+            {NAV_ORGANIZATION, NAV_GUEST_USER, NAV_ANONYMOUS},
+            {LAYOUT_NAV_END},
+            {layout().footer}
+        };
+    }
+
     static std::string home_page(Database& db, const User* user = nullptr) {
+        TraceSpan trace(__func__, "render");
         int rooms_count = db.get_rooms_count();
         int guests_count = db.get_guests_count();
         int bookings_count = db.get_bookings_count();
@@ -120,7 +474,7 @@ public:
             available_rooms.resize(3);
         }
 
-        std::ostringstream content;
+        HtmlStream content;
         content << R"(
 <div class="row mb-5">
     <div class="col-12">
@@ -178,17 +532,13 @@ public:
             </div>)";
         } else {
             for (const auto& room : available_rooms) {
-                std::string desc = room.description;
-                if (desc.length() > 100) {
-                    desc = desc.substr(0, 100) + "...";
-                }
                 content << R"(
             <div class="col-md-4 mb-4">
                 <div class="card h-100">
                     <div class="card-body">
                         <h5 class="card-title">)" << escape_html(room.name) << R"(</h5>
                         <p class="text-muted">Номер: )" << escape_html(room.number) << R"(</p>
-                        <p class="card-text">)" << escape_html(desc) << R"(</p>
+                        <p class="card-text">)" << escape_excerpt(room.description, 100) << R"(</p>
                         <p class="badge bg-primary">)" << escape_html(room.type_name) << R"(</p>
                         <p class="mt-2"><strong>Цена за день:</strong> )" << std::fixed << std::setprecision(2) << room.price_per_day << R"( руб.</p>
                     </div>
@@ -305,19 +655,20 @@ public:
 })();
 </script>)";
 
-        return base_template("Главная - Система бронирования отелей", content.str(), "", user);
+        return base_template("Главная - Система бронирования отелей", content.view(), "", user);
     }
 
     static std::string rooms_list(Database& db, const std::string& type_filter = "", const User* user = nullptr) {
+        TraceSpan trace(__func__, "render");
         auto rooms = db.get_all_rooms(type_filter);
         auto room_types = db.get_room_types();
 
-        std::ostringstream content;
+        HtmlStream content;
         content << R"(
 <div class="row mb-4">
     <div class="col-12">
         <h1>Номера отеля</h1>
-        <form method="GET" action="/rooms/" class="mb-3">
+        <form method="GET" action="/rooms/" class="mb-3" data-fragment="/rooms/fragment/" data-target="rooms-results">
             <div class="row">
                 <div class="col-md-4">
                     <select name="type" class="form-select">
@@ -337,55 +688,42 @@ public:
     </div>
 </div>
 
-<div class="row">)";
+<div class="row" id="rooms-results">)";
 
-        if (rooms.empty()) {
-            content << R"(
-    <div class="col-12">
-        <p class="text-muted">Номера не найдены</p>
-    </div>)";
-        } else {
-            for (const auto& room : rooms) {
-                std::string desc = room.description;
-                if (desc.length() > 150) {
-                    desc = desc.substr(0, 150) + "...";
-                }
-                content << R"(
-    <div class="col-md-4 mb-4">
-        <div class="card h-100">
-            <div class="card-body">
-                <h5 class="card-title">)" << escape_html(room.name) << R"(</h5>
-                <p class="text-muted">Номер: )" << escape_html(room.number) << R"(</p>
-                <p class="card-text">)" << escape_html(desc) << R"(</p>
-                <p class="badge bg-primary">)" << escape_html(room.type_name) << R"(</p>
-                <p class="mt-2"><strong>Цена за день:</strong> )" << std::fixed << std::setprecision(2) << room.price_per_day << R"( руб.</p>
-            </div>
-            <div class="card-footer">
-                <a href="/rooms/)" << room.room_id << R"(/" class="btn btn-primary">Подробнее</a>
-            </div>
-        </div>
-    </div>)";
-            }
-        }
+        write_room_cards(content, rooms);
 
         content << R"(
-</div>)";
+</div>)" << FRAGMENT_SCRIPT;
 
-        return base_template("Номера - Система бронирования отелей", content.str(), "", user);
+        return base_template("Номера - Система бронирования отелей", content.view(), "", user);
+    }
+
+    // Только карточки номеров для /rooms/fragment/ (фильтр без перезагрузки страницы)
+    static std::string rooms_fragment(Database& db, const std::string& type_filter = "") {
+        TraceSpan trace(__func__, "render");
+        auto rooms = db.get_all_rooms(type_filter);
+        HtmlStream content;
+        write_room_cards(content, rooms);
+        return std::string(content.view());
     }
 
     static std::string room_detail(Database& db, int64_t room_id, const std::string& check_in = "", const std::string& check_out = "") {
+        TraceSpan trace(__func__, "render");
         Room room = db.get_room(room_id);
         if (room.room_id == 0) {
             return base_template("Ошибка", "<div class='alert alert-danger'>Номер не найден</div>");
         }
 
         bool is_available = true;
+        FreeWindows windows;
         if (!check_in.empty() && !check_out.empty()) {
             is_available = db.is_room_available(room_id, check_in, check_out);
+            if (!is_available) {
+                windows = db.find_free_windows(room_id, check_in, check_out, get_current_date());
+            }
         }
 
-        std::ostringstream content;
+        HtmlStream content;
         content << R"(
 <div class="row">
     <div class="col-12">
@@ -425,7 +763,21 @@ public:
             } else {
                 content << R"(
         <div class="alert alert-danger">
-            <i class="bi bi-x-circle"></i> Номер занят на выбранные даты
+            <i class="bi bi-x-circle"></i> Номер занят на выбранные даты)";
+                if (windows.before.found || windows.after.found) {
+                    content << R"(
+            <div class="mt-2">Ближайшие свободные даты на тот же срок:)";
+                    for (const StayWindow* window : {&windows.before, &windows.after}) {
+                        if (window->found) {
+                            content << R"(
+                <a href="/bookings/create/?room=)" << room_id << R"(&check_in=)" << window->check_in << R"(&check_out=)" << window->check_out
+                                    << R"(" class="btn btn-outline-success btn-sm ms-2">)" << window->check_in << " &ndash; " << window->check_out << R"(</a>)";
+                        }
+                    }
+                    content << R"(
+            </div>)";
+                }
+                content << R"(
         </div>)";
             }
         }
@@ -436,19 +788,20 @@ public:
     </div>
 </div>)";
 
-        return base_template("Номер " + room.number + " - Система бронирования отелей", content.str());
+        return base_template("Номер " + room.number + " - Система бронирования отелей", content.view());
     }
 
     static std::string guests_list(Database& db, const std::string& search = "", int64_t user_id = 0, const User* user = nullptr) {
+        TraceSpan trace(__func__, "render");
         auto guests = db.get_all_guests(search, user_id);
 
-        std::ostringstream content;
+        HtmlStream content;
         content << R"(
 <div class="row mb-4">
     <div class="col-12">
         <h1>Гости</h1>
         <a href="/guests/create/" class="btn btn-primary mb-3">Добавить гостя</a>
-        <form method="GET" action="/guests/" class="mb-3">
+        <form method="GET" action="/guests/" class="mb-3" data-fragment="/guests/fragment/" data-target="guests-results">
             <div class="row">
                 <div class="col-md-6">
                     <input type="text" name="search" class="form-control" placeholder="Поиск по имени, телефону, email..." value=")" << escape_html(search) << R"(">
@@ -473,36 +826,30 @@ public:
                     <th>Действия</th>
                 </tr>
             </thead>
-            <tbody>)";
+            <tbody id="guests-results">)";
 
-        if (guests.empty()) {
-            content << R"(
-                <tr>
-                    <td colspan="5" class="text-center text-muted">Гости не найдены</td>
-                </tr>)";
-        } else {
-            for (const auto& guest : guests) {
-                content << R"(
-                <tr>
-                    <td>)" << escape_html(guest.full_name()) << R"(</td>
-                    <td>)" << escape_html(guest.passport_number) << R"(</td>
-                    <td>)" << escape_html(guest.phone) << R"(</td>
-                    <td>)" << escape_html(guest.email) << R"(</td>
-                    <td><a href="/guests/)" << guest.guest_id << R"(/" class="btn btn-sm btn-primary">Подробнее</a></td>
-                </tr>)";
-            }
-        }
+        write_guest_rows(content, guests);
 
         content << R"(
             </tbody>
         </table>
     </div>
-</div>)";
+</div>)" << FRAGMENT_SCRIPT;
+
+        return base_template("Гости - Система бронирования отелей", content.view(), "", user);
+    }
 
-        return base_template("Гости - Система бронирования отелей", content.str(), "", user);
+    // Только строки таблицы гостей для /guests/fragment/ (поиск без перезагрузки страницы)
+    static std::string guests_fragment(Database& db, const std::string& search = "", int64_t user_id = 0) {
+        TraceSpan trace(__func__, "render");
+        auto guests = db.get_all_guests(search, user_id);
+        HtmlStream content;
+        write_guest_rows(content, guests);
+        return std::string(content.view());
     }
 
     static std::string guest_detail(Database& db, int64_t guest_id) {
+        TraceSpan trace(__func__, "render");
         Guest guest = db.get_guest(guest_id);
         if (guest.guest_id == 0) {
             return base_template("Ошибка", "<div class='alert alert-danger'>Гость не найден</div>");
@@ -510,11 +857,11 @@ public:
 
         auto bookings = db.get_guest_bookings(guest_id);
 
-        std::ostringstream content;
+        HtmlStream content;
         content << R"(
 <div class="row">
     <div class="col-12">
-        <h1>)" << escape_html(guest.full_name()) << R"(</h1>
+        <h1>)" << escape_full_name(guest) << R"(</h1>
         <hr>
         <h3>Информация о госте</h3>
         <table class="table">
@@ -545,8 +892,9 @@ public:
                 </tr>
             </thead>
             <tbody>)";
+            auto rooms = db.get_rooms_by_ids(collect_ids(bookings, [](const Booking& b) { return b.room_id; }));
             for (const auto& booking : bookings) {
-                Room room = db.get_room(booking.room_id);
+                const Room& room = find_or_empty(rooms, booking.room_id);
                 content << R"(
                 <tr>
                     <td>)" << booking.booking_id << R"(</td>
@@ -568,11 +916,11 @@ public:
     </div>
 </div>)";
 
-        return base_template("Гость " + guest.full_name() + " - Система бронирования отелей", content.str());
+        return base_template("Гость " + guest.full_name() + " - Система бронирования отелей", content.view());
     }
 
     static std::string guest_form(const std::string& error = "", const Guest& guest = Guest()) {
-        std::ostringstream content;
+        HtmlStream content;
         content << R"(
 <div class="row">
     <div class="col-md-8">
@@ -613,20 +961,21 @@ public:
     </div>
 </div>)";
 
-        return base_template("Добавить гостя - Система бронирования отелей", content.str());
+        return base_template("Добавить гостя - Система бронирования отелей", content.view());
     }
 
     static std::string bookings_list(Database& db, const std::string& search = "", const User* user = nullptr) {
+        TraceSpan trace(__func__, "render");
         int64_t user_id = (user && user->user_id > 0) ? user->user_id : 0;
         auto bookings = db.get_all_bookings(search, user_id);
 
-        std::ostringstream content;
+        HtmlStream content;
         content << R"(
 <div class="row mb-4">
     <div class="col-12">
         <h1>Бронирования</h1>
         <a href="/bookings/create/" class="btn btn-primary mb-3">Создать бронирование</a>
-        <form method="GET" action="/bookings/" class="mb-3">
+        <form method="GET" action="/bookings/" class="mb-3" data-fragment="/bookings/fragment/" data-target="bookings-results">
             <div class="row">
                 <div class="col-md-6">
                     <input type="text" name="search" class="form-control" placeholder="Поиск по гостю, номеру..." value=")" << escape_html(search) << R"(">
@@ -653,40 +1002,30 @@ public:
                     <th>Действия</th>
                 </tr>
             </thead>
-            <tbody>)";
+            <tbody id="bookings-results">)";
 
-        if (bookings.empty()) {
-            content << R"(
-                <tr>
-                    <td colspan="7" class="text-center text-muted">Бронирования не найдены</td>
-                </tr>)";
-        } else {
-            for (const auto& booking : bookings) {
-                Guest guest = db.get_guest(booking.guest_id);
-                Room room = db.get_room(booking.room_id);
-                content << R"(
-                <tr>
-                    <td>)" << booking.booking_id << R"(</td>
-                    <td>)" << escape_html(guest.full_name()) << R"(</td>
-                    <td>)" << escape_html(room.number) << R"(</td>
-                    <td>)" << escape_html(booking.check_in_date) << R"(</td>
-                    <td>)" << escape_html(booking.check_out_date) << R"(</td>
-                    <td>)" << std::fixed << std::setprecision(2) << booking.total_price << R"( руб.</td>
-                    <td><a href="/bookings/)" << booking.booking_id << R"(/" class="btn btn-sm btn-primary">Подробнее</a></td>
-                </tr>)";
-            }
-        }
+        write_booking_rows(content, db, bookings);
 
         content << R"(
             </tbody>
         </table>
     </div>
-</div>)";
+</div>)" << FRAGMENT_SCRIPT;
 
-        return base_template("Бронирования - Система бронирования отелей", content.str(), "", user);
+        return base_template("Бронирования - Система бронирования отелей", content.view(), "", user);
+    }
+
+    // Только строки таблицы бронирований для /bookings/fragment/
+    static std::string bookings_fragment(Database& db, const std::string& search = "", int64_t user_id = 0) {
+        TraceSpan trace(__func__, "render");
+        auto bookings = db.get_all_bookings(search, user_id);
+        HtmlStream content;
+        write_booking_rows(content, db, bookings);
+        return std::string(content.view());
     }
 
     static std::string booking_detail(Database& db, int64_t booking_id) {
+        TraceSpan trace(__func__, "render");
         Booking booking = db.get_booking(booking_id);
         if (booking.booking_id == 0) {
             return base_template("Ошибка", "<div class='alert alert-danger'>Бронирование не найдено</div>");
@@ -695,7 +1034,7 @@ public:
         Guest guest = db.get_guest(booking.guest_id);
         Room room = db.get_room(booking.room_id);
 
-        std::ostringstream content;
+        HtmlStream content;
         content << R"(
 <div class="row">
     <div class="col-12">
@@ -703,7 +1042,7 @@ public:
         <hr>
         <h3>Информация о бронировании</h3>
         <table class="table">
-            <tr><th>Гость:</th><td><a href="/guests/)" << guest.guest_id << R"(/">)" << escape_html(guest.full_name()) << R"(</a></td></tr>
+            <tr><th>Гость:</th><td><a href="/guests/)" << guest.guest_id << R"(/">)" << escape_full_name(guest) << R"(</a></td></tr>
             <tr><th>Номер:</th><td><a href="/rooms/)" << room.room_id << R"(/">)" << escape_html(room.number) << " - " << escape_html(room.name) << R"(</a></td></tr>
             <tr><th>Дата заезда:</th><td>)" << escape_html(booking.check_in_date) << R"(</td></tr>
             <tr><th>Дата выезда:</th><td>)" << escape_html(booking.check_out_date) << R"(</td></tr>
@@ -717,17 +1056,22 @@ public:
     </div>
 </div>)";
 
-        return base_template("Бронирование #" + std::to_string(booking_id) + " - Система бронирования отелей", content.str());
+        return base_template("Бронирование #" + std::to_string(booking_id) + " - Система бронирования отелей", content.view());
     }
 
-    static std::string booking_form(Database& db, const std::string& error = "", const Booking& booking = Booking(), const Guest& guest = Guest(), int64_t user_id = 0) {
-        auto rooms = db.get_all_rooms();
-        auto guests = db.get_all_guests("", user_id);
-        if (guests.size() > 10) {
-            guests.resize(10);
+    // options - другие номера или проживание с переездом, если выбранный номер занят
+    static std::string booking_form(Database& db, const std::string& error = "", const Booking& booking = Booking(), const Guest& guest = Guest(), int64_t user_id = 0,
+                                    const StayOptions* options = nullptr) {
+        TraceSpan trace(__func__, "render");
+        // Списки не выводятся целиком: в форме только уже выбранные номер и гость,
+        // остальное подсказывает поиск (/rooms/suggest/, /guests/suggest/)
+        Room selected_room = booking.room_id != 0 ? db.get_room(booking.room_id) : Room();
+        Guest selected_guest = guest.guest_id != 0 ? guest : (booking.guest_id != 0 ? db.get_guest(booking.guest_id) : Guest());
+        if (user_id == 0 || selected_guest.user_id != user_id) {
+            selected_guest = Guest();
         }
 
-        std::ostringstream content;
+        HtmlStream content;
         content << R"(
 <div class="row">
     <div class="col-12">
@@ -736,24 +1080,47 @@ public:
             content << R"(
         <div class="alert alert-danger">)" << escape_html(error) << R"(</div>)";
         }
+        if (options && (!options->whole.empty() || !options->split.empty())) {
+            content << R"(
+        <div class="alert alert-info">)";
+            if (!options->whole.empty()) {
+                content << R"(
+            На эти даты свободны номера того же типа:)";
+            } else {
+                content << R"(
+            Номеров того же типа на все даты нет, но можно жить с переездом между номерами (переездов: )" << options->split.size() - 1 << R"():)";
+            }
+            for (const StaySegment& segment : options->whole.empty() ? options->split : options->whole) {
+                content << R"(
+            <a href="/bookings/create/?room=)" << segment.room_id << R"(&check_in=)" << segment.check_in << R"(&check_out=)" << segment.check_out
+                        << R"(" class="btn btn-outline-primary btn-sm ms-2">)" << escape_html(segment.room_number) << " (" << segment.check_in << " &ndash; " << segment.check_out << R"()</a>)";
+            }
+            content << R"(
+        </div>)";
+        }
         content << R"(
         <form method="POST" action="/bookings/create/">
             <div class="row">
                 <div class="col-md-6">
-                    <h3>Информация о госте</h3>
+                    <h3>Информация о госте</h3>)";
+        // Подсказки гостей есть только у вошедшего пользователя: гости принадлежат ему
+        if (user_id > 0) {
+            content << R"(
                     <div class="mb-3">
                         <label class="form-label">Выбрать существующего гостя</label>
-                        <select name="guest_id" class="form-select">
+                        <input type="search" class="form-control mb-2" placeholder="Фамилия, имя, телефон или паспорт" autocomplete="off" data-suggest="/guests/suggest/" data-select="guest_select">
+                        <select name="guest_id" id="guest_select" class="form-select">
                             <option value="">-- Выберите гостя --</option>)";
-        for (const auto& g : guests) {
+            if (selected_guest.guest_id != 0) {
+                write_guest_option(content, selected_guest, true);
+            }
             content << R"(
-                            <option value=")" << g.guest_id << R"(")" << (g.guest_id == booking.guest_id ? " selected" : "") << R"(>)" << escape_html(g.full_name()) << R"(</option>)";
-        }
-        content << R"(
                         </select>
                     </div>
                     <hr>
-                    <h4>Или создать нового гостя</h4>
+                    <h4>Или создать нового гостя</h4>)";
+        }
+        content << R"(
                     <div class="mb-3">
                         <label class="form-label">Имя *</label>
                         <input type="text" name="first_name" class="form-control" value=")" << escape_html(guest.first_name) << R"(">
@@ -783,21 +1150,22 @@ public:
                     <h3>Информация о бронировании</h3>
                     <div class="mb-3">
                         <label class="form-label">Номер *</label>
-                        <select name="room_id" id="room_select" class="form-select" required onchange=\"updatePrice()\">)";
-        for (const auto& room : rooms) {
-            content << R"(
-                            <option value=")" << room.room_id << R"(" data-price=")" << room.price_per_day << R"(")" << (room.room_id == booking.room_id ? " selected" : "") << R"(>)" << escape_html(room.number) << " - " << escape_html(room.name) << " (" << std::fixed << std::setprecision(2) << room.price_per_day << " руб./день)" << R"(</option>)";
+                        <input type="search" class="form-control mb-2" placeholder="Номер или название" autocomplete="off" data-suggest="/rooms/suggest/" data-select="room_select">
+                        <select name="room_id" id="room_select" class="form-select" required onchange="updatePrice();">
+                            <option value="">-- Начните вводить номер или название --</option>)";
+        if (selected_room.room_id != 0) {
+            write_room_option(content, selected_room, true);
         }
         content << R"(
                         </select>
                     </div>
                     <div class="mb-3">
                         <label class="form-label">Дата заезда *</label>
-                        <input type="date" name="check_in_date" id="check_in_date" class="form-control" value=")" << escape_html(booking.check_in_date) << R"(" required onchange=\"updatePrice()\">
+                        <input type="date" name="check_in_date" id="check_in_date" class="form-control" value=")" << escape_html(booking.check_in_date) << R"(" required onchange="updatePrice();">
                     </div>
                     <div class="mb-3">
                         <label class="form-label">Дата выезда *</label>
-                        <input type="date" name="check_out_date" id="check_out_date" class="form-control" value=")" << escape_html(booking.check_out_date) << R"(" required onchange=\"updatePrice()\">
+                        <input type="date" name="check_out_date" id="check_out_date" class="form-control" value=")" << escape_html(booking.check_out_date) << R"(" required onchange="updatePrice();">
                     </div>
                     <div class="mb-3">
                         <label class="form-label">Количество взрослых *</label>
@@ -866,17 +1234,74 @@ function updatePrice() {
     }
 }
 
+// Подсказки: введенный текст уходит на data-suggest, ответ - готовые <option> для списка
+document.querySelectorAll('input[data-suggest]').forEach(function(input) {
+    var select = document.getElementById(input.dataset.select);
+    if (!select || !window.fetch) return;
+    var pending = null;
+    var timer = null;
+    function load() {
+        if (pending) pending.abort();
+        pending = new AbortController();
+        fetch(input.dataset.suggest + '?q=' + encodeURIComponent(input.value), {signal: pending.signal, credentials: 'same-origin'})
+            .then(function(response) {
+                if (!response.ok || response.redirected) throw new Error(response.status);
+                return response.text();
+            })
+            .then(function(html) {
+                var placeholder = select.options[0];
+                select.innerHTML = html;
+                select.insertBefore(placeholder, select.firstChild);
+                select.selectedIndex = select.options.length > 1 ? 1 : 0;
+                select.dispatchEvent(new Event('change'));
+            })
+            .catch(function() {});
+    }
+    input.addEventListener('input', function() {
+        clearTimeout(timer);
+        timer = setTimeout(load, 200);
+    });
+    // Первые варианты - при первом фокусе, если список еще пуст
+    input.addEventListener('focus', function() {
+        if (select.options.length <= 1) load();
+    }, {once: true});
+});
+
 // Инициализация при загрузке страницы
 document.addEventListener('DOMContentLoaded', function() {
     updatePrice();
 });
 </script>)";
 
-        return base_template("Создать бронирование - Система бронирования отелей", content.str());
+        return base_template("Создать бронирование - Система бронирования отелей", content.view());
+    }
+
+    // Подсказки для формы бронирования: первые limit вариантов, начинающихся с prefix
+    static constexpr size_t SUGGEST_LIMIT = 20;
+    static constexpr size_t MAX_SUGGEST_LIMIT = 100;
+
+    static std::string room_options(Database& db, const std::string& prefix, size_t limit = SUGGEST_LIMIT) {
+        TraceSpan trace(__func__, "render");
+        auto rooms = db.search_rooms_by_prefix(prefix, limit);
+        HtmlStream content;
+        for (const auto& room : rooms) {
+            write_room_option(content, room, false);
+        }
+        return std::string(content.view());
+    }
+
+    static std::string guest_options(Database& db, const std::string& prefix, int64_t user_id, size_t limit = SUGGEST_LIMIT) {
+        TraceSpan trace(__func__, "render");
+        auto guests = db.search_guests_by_prefix(user_id, prefix, limit);
+        HtmlStream content;
+        for (const auto& guest : guests) {
+            write_guest_option(content, guest, false);
+        }
+        return std::string(content.view());
     }
 
     static std::string contact_page(const User* user = nullptr) {
-        std::ostringstream content;
+        HtmlStream content;
         content << R"(
 <div class="row">
     <div class="col-12">
@@ -893,16 +1318,92 @@ document.addEventListener('DOMContentLoaded', function() {
     </div>
 </div>)";
 
-        return base_template("Контакты - Система бронирования отелей", content.str(), "", user);
+        return base_template("Контакты - Система бронирования отелей", content.view(), "", user);
+    }
+
+    // Служебная страница /admin/: таблица "параметр - значение"
+    static std::string admin_page(const std::string& title, const std::vector<std::pair<std::string, std::string>>& rows) {
+        HtmlStream content;
+        content << R"(
+<div class="row">
+    <div class="col-12">
+        <h1>)" << escape_html(title) << R"(</h1>
+        <table class="table table-sm table-striped">
+            <tbody>)";
+        for (const auto& row : rows) {
+            content << R"(
+                <tr><th>)" << escape_html(row.first) << R"(</th><td>)" << escape_html(row.second) << R"(</td></tr>)";
+        }
+        content << R"(
+            </tbody>
+        </table>
+    </div>
+</div>)";
+
+        return base_template(title + " - Система бронирования отелей", content.view());
+    }
+
+    // Таблица для служебных страниц; ячейки выводятся с сохранением переносов строк
+    struct AdminTable {
+        std::string caption;
+        std::vector<std::string> columns;
+        std::vector<std::vector<std::string>> rows;
+    };
+
+    static std::string admin_tables_page(const std::string& title, const std::string& note, const std::vector<AdminTable>& tables) {
+        HtmlStream content;
+        content << R"(
+<div class="row">
+    <div class="col-12">
+        <h1>)" << escape_html(title) << R"(</h1>)";
+        if (!note.empty()) {
+            content << R"(
+        <p class="text-muted">)" << escape_html(note) << R"(</p>)";
+        }
+        for (const auto& table : tables) {
+            content << R"(
+        <h2 class="h4 mt-4">)" << escape_html(table.caption) << R"(</h2>
+        <div class="table-responsive">
+            <table class="table table-sm table-striped">
+                <thead><tr>)";
+            for (const auto& column : table.columns) {
+                content << "<th>" << escape_html(column) << "</th>";
+            }
+            content << R"(</tr></thead>
+                <tbody>)";
+            if (table.rows.empty()) {
+                content << R"(
+                    <tr><td colspan=")" << table.columns.size() << R"(" class="text-muted">Нет данных</td></tr>)";
+            }
+            for (const auto& row : table.rows) {
+                content << R"(
+                    <tr>)";
+                for (const auto& cell : row) {
+                    content << R"(<td style="white-space: pre-wrap">)" << escape_html(cell) << "</td>";
+                }
+                content << "</tr>";
+            }
+            content << R"(
+                </tbody>
+            </table>
+        </div>)";
+        }
+        content << R"(
+    </div>
+</div>)";
+
+        return base_template(title + " - Система бронирования отелей", content.view());
     }
 
     static std::string success_message(const std::string& message) {
-        return "<div class='alert alert-success alert-dismissible fade show' role='alert'>" + escape_html(message) + 
-               "<button type='button' class='btn-close' data-bs-dismiss='alert'></button></div>";
+        HtmlStream html(message.size() + 160);
+        html << "<div class='alert alert-success alert-dismissible fade show' role='alert'>" << escape_html(message)
+             << "<button type='button' class='btn-close' data-bs-dismiss='alert'></button></div>";
+        return html.str();
     }
 
     static std::string registration_form(const std::string& error = "", const User& user = User()) {
-        std::ostringstream content;
+        HtmlStream content;
         content << R"(
 <div class="row justify-content-center">
     <div class="col-md-8">
@@ -969,14 +1470,16 @@ if (userType.value === 'organization') {
 }
 </script>)";
 
-        return base_template("Регистрация - Система бронирования отелей", content.str());
+        return base_template("Регистрация - Система бронирования отелей", content.view());
     }
 
     static std::string organization_dashboard(Database& db, int64_t organization_id, const User* user = nullptr) {
+        TraceSpan trace(__func__, "render");
+        int64_t since = db.get_last_change_seq();
         auto hotels = db.get_hotels_by_organization(organization_id);
-        User org = db.get_user(organization_id);
+        User org = (user && user->user_id == organization_id) ? *user : db.get_user(organization_id);
         
-        std::ostringstream content;
+        HtmlStream content;
         content << R"(
 <div class="row mb-4">
     <div class="col-12">
@@ -993,24 +1496,27 @@ if (userType.value === 'organization') {
 </div>
 
 <div class="row">
-    <div class="col-12">
+    <div class="col-12" id="organization-hotels" data-events="/organization/dashboard/events/?since=)" << since << R"(">
         <h2>Мои отели</h2>)";
         
         if (hotels.empty()) {
             content << R"(
         <p class="text-muted">У вас пока нет отелей. Создайте первый отель!</p>)";
         } else {
+            auto organization_rooms = db.get_rooms_by_organization(organization_id);
             for (const auto& hotel : hotels) {
-                auto rooms = db.get_rooms_by_hotel(hotel.hotel_id);
+                auto rooms = rooms_of_hotel(organization_rooms, hotel.hotel_id);
                 content << R"(
         <div class="card mb-3">
             <div class="card-body">
                 <h3 class="card-title">)" << escape_html(hotel.name) << R"(</h3>
                 <p class="card-text">)" << escape_html(hotel.description) << R"(</p>
                 <p class="text-muted">Адрес: )" << escape_html(hotel.address) << R"(</p>
-                <p class="text-muted">Номеров: )" << rooms.size() << R"(</p>
+                <p class="text-muted">Номеров: <span data-hotel-rooms=")" << hotel.hotel_id << R"(">)" << rooms.size() << R"(</span></p>
                 <a href="/hotels/)" << hotel.hotel_id << R"(/rooms/create/" class="btn btn-primary">Добавить номер</a>
                 <a href="/hotels/)" << hotel.hotel_id << R"(/bookings/" class="btn btn-info">Бронирования</a>
+                <a href="/hotels/)" << hotel.hotel_id << R"(/front-desk/" class="btn btn-info">Стойка регистрации</a>
+                <a href="/hotels/)" << hotel.hotel_id << R"(/calendar/" class="btn btn-info">Занятость</a>
                 <a href="/organization/dashboard/" class="btn btn-secondary">Назад</a>
             </div>
         </div>)";
@@ -1019,13 +1525,34 @@ if (userType.value === 'organization') {
         
         content << R"(
     </div>
-</div>)";
+</div>
+
+<script>
+(function() {
+    // Живое обновление счетчиков: сервер присылает изменения по отелям организации
+    const hotels = document.getElementById('organization-hotels');
+    if (!hotels || !window.EventSource) {
+        return;
+    }
+    const source = new EventSource(hotels.dataset.events);
+    source.addEventListener('hotel', function(event) {
+        const delta = JSON.parse(event.data);
+        const rooms = hotels.querySelector('[data-hotel-rooms="' + delta.hotel_id + '"]');
+        if (rooms) {
+            rooms.textContent = delta.rooms;
+        }
+    });
+    source.addEventListener('hotel-added', function() {
+        location.reload();
+    });
+})();
+</script>)";
 
-        return base_template("Панель организации - Система бронирования отелей", content.str(), "", user);
+        return base_template("Панель организации - Система бронирования отелей", content.view(), "", user);
     }
 
     static std::string hotel_form(int64_t organization_id, const std::string& error = "", const Hotel& hotel = Hotel(), const User* user = nullptr) {
-        std::ostringstream content;
+        HtmlStream content;
         content << R"(
 <div class="row">
     <div class="col-md-8">
@@ -1054,11 +1581,12 @@ if (userType.value === 'organization') {
     </div>
 </div>)";
 
-        return base_template("Создать отель - Система бронирования отелей", content.str(), "", user);
+        return base_template("Создать отель - Система бронирования отелей", content.view(), "", user);
     }
 
     static std::string room_form_for_hotel(Database& db, int64_t hotel_id, int64_t organization_id, const std::string& error = "", const Room& room = Room(), const User* user = nullptr) {
-        std::ostringstream content;
+        TraceSpan trace(__func__, "render");
+        HtmlStream content;
         content << R"(
 <div class="row">
     <div class="col-md-8">
@@ -1095,11 +1623,11 @@ if (userType.value === 'organization') {
     </div>
 </div>)";
 
-        return base_template("Добавить номер - Система бронирования отелей", content.str(), "", user);
+        return base_template("Добавить номер - Система бронирования отелей", content.view(), "", user);
     }
 
     static std::string profile_page(const User& user, const std::string& error = "", const std::string& success = "") {
-        std::ostringstream content;
+        HtmlStream content;
         content << R"(
 <div class="row justify-content-center">
     <div class="col-md-8">
@@ -1206,11 +1734,11 @@ if (userType.value === 'organization') {
     </div>
 </div>)";
 
-        return base_template("Профиль - Система бронирования отелей", content.str(), "", &user);
+        return base_template("Профиль - Система бронирования отелей", content.view(), "", &user);
     }
 
     static std::string login_form(const std::string& error = "") {
-        std::ostringstream content;
+        HtmlStream content;
         content << R"(
 <div class="row justify-content-center">
     <div class="col-md-6">
@@ -1235,14 +1763,15 @@ if (userType.value === 'organization') {
     </div>
 </div>)";
 
-        return base_template("Вход - Система бронирования отелей", content.str());
+        return base_template("Вход - Система бронирования отелей", content.view());
     }
 
     // Страницы для управления номерами организации
     static std::string organization_rooms_list(Database& db, int64_t organization_id, const std::string& error = "", const std::string& success = "", const User* user = nullptr) {
+        TraceSpan trace(__func__, "render");
         auto hotels = db.get_hotels_by_organization(organization_id);
         
-        std::ostringstream content;
+        HtmlStream content;
         content << R"(
 <div class="row mb-4">
     <div class="col-12">
@@ -1270,8 +1799,9 @@ if (userType.value === 'organization') {
         <p class="text-muted">У вас пока нет отелей. Создайте отель и добавьте номера!</p>
     </div>)";
         } else {
+            auto organization_rooms = db.get_rooms_by_organization(organization_id);
             for (const auto& hotel : hotels) {
-                auto rooms = db.get_rooms_by_hotel(hotel.hotel_id);
+                auto rooms = rooms_of_hotel(organization_rooms, hotel.hotel_id);
                 content << R"(
     <div class="col-12 mb-4">
         <div class="card">
@@ -1330,16 +1860,17 @@ if (userType.value === 'organization') {
     </div>
 </div>)";
 
-        return base_template("Мои номера - Система бронирования отелей", content.str(), "", user);
+        return base_template("Мои номера - Система бронирования отелей", content.view(), "", user);
     }
 
     static std::string room_edit_form(Database& db, int64_t room_id, const std::string& error = "", const Room& room = Room(), const User* user = nullptr) {
+        TraceSpan trace(__func__, "render");
         Room room_data = room.room_id == 0 ? db.get_room(room_id) : room;
         if (room_data.room_id == 0) {
             return base_template("Ошибка", "<div class='alert alert-danger'>Номер не найден</div>", "", user);
         }
         
-        std::ostringstream content;
+        HtmlStream content;
         content << R"(
 <div class="row">
     <div class="col-md-8">
@@ -1376,18 +1907,21 @@ if (userType.value === 'organization') {
     </div>
 </div>)";
 
-        return base_template("Редактировать номер - Система бронирования отелей", content.str(), "", user);
+        return base_template("Редактировать номер - Система бронирования отелей", content.view(), "", user);
     }
 
     static std::string hotel_bookings_list(Database& db, int64_t hotel_id, const std::string& error = "", const std::string& success = "", const User* user = nullptr) {
+        TraceSpan trace(__func__, "render");
         Hotel hotel = db.get_hotel(hotel_id);
         if (hotel.hotel_id == 0) {
             return base_template("Ошибка", "<div class='alert alert-danger'>Отель не найден</div>", "", user);
         }
         
+        // Курсор журнала до выборки: изменения после него придут по SSE, ни одно не потеряется
+        int64_t since = db.get_last_change_seq();
         auto bookings = db.get_bookings_by_hotel(hotel_id);
         
-        std::ostringstream content;
+        HtmlStream content;
         content << R"(
 <div class="row mb-4">
     <div class="col-12">
@@ -1421,30 +1955,18 @@ if (userType.value === 'organization') {
                     <th>Действия</th>
                 </tr>
             </thead>
-            <tbody>)";
+            <tbody id="hotel-bookings" data-events="/hotels/)" << hotel_id << "/bookings/events/?since=" << since << R"(">)";
         
         if (bookings.empty()) {
             content << R"(
-                <tr>
+                <tr data-empty>
                     <td colspan="7" class="text-center text-muted">Бронирования не найдены</td>
                 </tr>)";
         } else {
+            auto guests = db.get_guests_by_ids(collect_ids(bookings, [](const Booking& b) { return b.guest_id; }));
+            auto rooms = db.get_rooms_by_ids(collect_ids(bookings, [](const Booking& b) { return b.room_id; }));
             for (const auto& booking : bookings) {
-                Guest guest = db.get_guest(booking.guest_id);
-                Room room = db.get_room(booking.room_id);
-                content << R"(
-                <tr>
-                    <td>)" << booking.booking_id << R"(</td>
-                    <td>)" << escape_html(guest.full_name()) << R"(</td>
-                    <td>)" << escape_html(room.number) << R"(</td>
-                    <td>)" << escape_html(booking.check_in_date) << R"(</td>
-                    <td>)" << escape_html(booking.check_out_date) << R"(</td>
-                    <td>)" << std::fixed << std::setprecision(2) << booking.total_price << R"( руб.</td>
-                    <td>
-                        <a href="/bookings/)" << booking.booking_id << R"(/edit/" class="btn btn-sm btn-primary">Редактировать</a>
-                        <a href="/bookings/)" << booking.booking_id << R"(/" class="btn btn-sm btn-secondary">Подробнее</a>
-                    </td>
-                </tr>)";
+                write_hotel_booking_row(content, booking, find_or_empty(guests, booking.guest_id), find_or_empty(rooms, booking.room_id));
             }
         }
         
@@ -1458,12 +1980,238 @@ if (userType.value === 'organization') {
     <div class="col-12">
         <a href="/organization/dashboard/" class="btn btn-secondary">Назад к панели</a>
     </div>
+</div>
+
+<script>
+(function() {
+    // Живое обновление: сервер присылает готовые строки таблицы вместо перезагрузки страницы
+    const body = document.getElementById('hotel-bookings');
+    if (!body || !window.EventSource) {
+        return;
+    }
+    const source = new EventSource(body.dataset.events);
+    function rowOf(id) {
+        return body.querySelector('tr[data-booking-id="' + id + '"]');
+    }
+    source.addEventListener('booking', function(event) {
+        const template = document.createElement('template');
+        template.innerHTML = event.data.trim();
+        const row = template.content.firstElementChild;
+        const old = rowOf(row.dataset.bookingId);
+        if (old) {
+            old.replaceWith(row);
+            return;
+        }
+        const empty = body.querySelector('tr[data-empty]');
+        if (empty) {
+            empty.remove();
+        }
+        // Порядок как на сервере: по дате заезда, поздние сверху
+        const next = Array.from(body.children).find(function(tr) { return tr.dataset.checkIn < row.dataset.checkIn; });
+        body.insertBefore(row, next || null);
+    });
+    source.addEventListener('booking-removed', function(event) {
+        const old = rowOf(event.data);
+        if (old) {
+            old.remove();
+        }
+    });
+})();
+</script>)";
+
+        return base_template("Бронирования отеля - Система бронирования отелей", content.view(), "", user);
+    }
+
+    // Сетка занятости номеров отеля на days дней начиная с first_day: ряд - номер, столбец - ночь.
+    // Строится по битовым картам OccupancyCalendar из одной выборки бронирований периода,
+    // без проверки доступности по клеткам; занятые ночи подряд выводятся одной ячейкой.
+    static std::string occupancy_calendar(Database& db, int64_t hotel_id, int64_t first_day, int days, const User* user = nullptr) {
+        TraceSpan trace(__func__, "render");
+        Hotel hotel = db.get_hotel(hotel_id);
+        if (hotel.hotel_id == 0) {
+            return base_template("Ошибка", "<div class='alert alert-danger'>Отель не найден</div>", "", user);
+        }
+
+        std::string from = date_utils::format_day(first_day);
+        std::string to = date_utils::format_day(first_day + days);
+        auto rooms = db.get_rooms_by_hotel(hotel_id);
+        auto bookings = db.get_hotel_bookings_between(hotel_id, from, to);
+        std::vector<int64_t> room_ids;
+        room_ids.reserve(rooms.size());
+        for (const auto& room : rooms) {
+            room_ids.push_back(room.room_id);
+        }
+        OccupancyCalendar calendar(first_day, days, std::move(room_ids));
+        for (const auto& booking : bookings) {
+            calendar.occupy(booking.room_id, booking.check_in_date, booking.check_out_date);
+        }
+
+        std::string base = "/hotels/" + std::to_string(hotel_id) + "/calendar/";
+        HtmlStream content;
+        content << R"(
+<div class="row mb-4">
+    <div class="col-12">
+        <h1>Занятость номеров: )" << escape_html(hotel.name) << R"(</h1>
+        <form method="GET" action=")" << base << R"(" class="row g-2">
+            <div class="col-auto">
+                <input type="date" name="from" class="form-control" value=")" << from << R"(">
+            </div>
+            <div class="col-auto">
+                <select name="days" class="form-select">)";
+        for (int option : {30, 60, 90}) {
+            content << R"(
+                    <option value=")" << option << R"(")" << (option == days ? " selected" : "") << ">" << option << R"( дней</option>)";
+        }
+        content << R"(
+                </select>
+            </div>
+            <div class="col-auto">
+                <button type="submit" class="btn btn-primary">Показать</button>
+                <a href=")" << base << "?from=" << date_utils::format_day(first_day - days) << "&days=" << days << R"(" class="btn btn-outline-secondary">&larr;</a>
+                <a href=")" << base << "?from=" << date_utils::format_day(first_day + days) << "&days=" << days << R"(" class="btn btn-outline-secondary">&rarr;</a>
+            </div>
+        </form>
+    </div>
+</div>
+
+<div class="row">
+    <div class="col-12 table-responsive">
+        <table class="table table-bordered table-sm small text-center">
+            <thead>
+                <tr>
+                    <th class="text-start">Номер</th>)";
+        for (int day = 0; day < days; ++day) {
+            int64_t date = first_day + day;
+            content << "<th" << (date_utils::weekday(date) >= 5 ? R"( class="text-danger")" : "") << R"( title=")"
+                    << date_utils::format_day(date) << R"(">)" << date_utils::civil_from_days(date).day << "</th>";
+        }
+        content << R"(
+                    <th>Ночей</th>
+                </tr>
+            </thead>
+            <tbody>)";
+        for (size_t room = 0; room < calendar.room_count(); ++room) {
+            content << R"(
+                <tr>
+                    <th class="text-start">)" << escape_html(rooms[room].number) << "</th>";
+            calendar.for_each_run(room, [&](int start, int length, bool occupied) {
+                if (occupied) {
+                    content << R"(<td colspan=")" << length << R"(" class="bg-danger" title=")" << date_utils::format_day(first_day + start)
+                            << " - " << date_utils::format_day(first_day + start + length) << R"("></td>)";
+                } else {
+                    for (int i = 0; i < length; ++i) {
+                        content << "<td></td>";
+                    }
+                }
+            });
+            content << "<td>" << calendar.room_nights(room) << "</td>";
+            content << R"(
+                </tr>)";
+        }
+        content << R"(
+            </tbody>
+            <tfoot>
+                <tr>
+                    <th class="text-start">Занято</th>)";
+        int total_nights = 0;
+        for (int day = 0; day < days; ++day) {
+            int total = calendar.day_total(day);
+            total_nights += total;
+            content << "<th>" << total << "</th>";
+        }
+        int capacity = static_cast<int>(calendar.room_count()) * days;
+        content << "<th>" << total_nights << R"(</th>
+                </tr>
+            </tfoot>
+        </table>
+        <p class="text-muted">Загрузка за период: )" << (capacity > 0 ? total_nights * 100 / capacity : 0) << R"(%</p>
+    </div>
+</div>
+
+<div class="row mt-4">
+    <div class="col-12">
+        <a href="/hotels/)" << hotel_id << R"(/front-desk/" class="btn btn-info">Стойка регистрации</a>
+        <a href="/organization/dashboard/" class="btn btn-secondary">Назад к панели</a>
+    </div>
+</div>)";
+
+        return base_template("Занятость номеров - Система бронирования отелей", content.view(), "", user);
+    }
+
+    // Стойка регистрации: заезды, выезды и проживающие на дату. В выборку попадают только
+    // бронирования, затрагивающие дату, а не вся история отеля (см. get_hotel_bookings_on_date)
+    static std::string front_desk(Database& db, int64_t hotel_id, const std::string& date, const User* user = nullptr) {
+        TraceSpan trace(__func__, "render");
+        Hotel hotel = db.get_hotel(hotel_id);
+        if (hotel.hotel_id == 0) {
+            return base_template("Ошибка", "<div class='alert alert-danger'>Отель не найден</div>", "", user);
+        }
+
+        auto bookings = db.get_hotel_bookings_on_date(hotel_id, date);
+        std::vector<const Booking*> arrivals;
+        std::vector<const Booking*> departures;
+        std::vector<const Booking*> in_house;
+        for (const auto& booking : bookings) {
+            if (booking.check_in_date == date) {
+                arrivals.push_back(&booking);
+            } else if (booking.check_out_date == date) {
+                departures.push_back(&booking);
+            } else {
+                in_house.push_back(&booking);
+            }
+        }
+        auto guests = db.get_guests_by_ids(collect_ids(bookings, [](const Booking& b) { return b.guest_id; }));
+        auto rooms = db.get_rooms_by_ids(collect_ids(bookings, [](const Booking& b) { return b.room_id; }));
+
+        HtmlStream content;
+        content << R"(
+<div class="row mb-4">
+    <div class="col-12">
+        <h1>Стойка регистрации: )" << escape_html(hotel.name) << R"(</h1>
+        <form method="GET" action="/hotels/)" << hotel_id << R"(/front-desk/" class="row g-2">
+            <div class="col-auto">
+                <input type="date" name="date" class="form-control" value=")" << escape_html(date) << R"(">
+            </div>
+            <div class="col-auto">
+                <button type="submit" class="btn btn-primary">Показать</button>
+                <a href="/hotels/)" << hotel_id << R"(/front-desk/" class="btn btn-outline-secondary">Сегодня</a>
+            </div>
+        </form>
+    </div>
+</div>)";
+        write_front_desk_section(content, "Заезды", arrivals, guests, rooms);
+        write_front_desk_section(content, "Выезды", departures, guests, rooms);
+        write_front_desk_section(content, "Проживают", in_house, guests, rooms);
+        content << R"(
+
+<div class="row mt-4">
+    <div class="col-12">
+        <a href="/hotels/)" << hotel_id << R"(/bookings/" class="btn btn-info">Все бронирования</a>
+        <a href="/organization/dashboard/" class="btn btn-secondary">Назад к панели</a>
+    </div>
 </div>)";
 
-        return base_template("Бронирования отеля - Система бронирования отелей", content.str(), "", user);
+        return base_template("Стойка регистрации - Система бронирования отелей", content.view(), "", user);
+    }
+
+    // Одна строка таблицы hotel_bookings_list для потока SSE; пусто, если бронирования
+    // больше нет или оно теперь в номере другого отеля
+    static std::string hotel_booking_row(Database& db, int64_t hotel_id, int64_t booking_id) {
+        Booking booking = db.get_booking(booking_id);
+        if (booking.booking_id == 0) {
+            return "";
+        }
+        Room room = db.get_room(booking.room_id);
+        if (room.hotel_id != hotel_id) {
+            return "";
+        }
+        HtmlStream content;
+        write_hotel_booking_row(content, booking, db.get_guest(booking.guest_id), room);
+        return std::string(content.view());
     }
 
     static std::string booking_edit_form(Database& db, int64_t booking_id, const std::string& error = "", const Booking& booking = Booking(), const User* user = nullptr) {
+        TraceSpan trace(__func__, "render");
         Booking booking_data = booking.booking_id == 0 ? db.get_booking(booking_id) : booking;
         if (booking_data.booking_id == 0) {
             return base_template("Ошибка", "<div class='alert alert-danger'>Бронирование не найдено</div>", "", user);
@@ -1473,7 +2221,7 @@ if (userType.value === 'organization') {
         Room room = db.get_room(booking_data.room_id);
         auto rooms = db.get_rooms_by_hotel(room.hotel_id);
         
-        std::ostringstream content;
+        HtmlStream content;
         content << R"(
 <div class="row">
     <div class="col-12">
@@ -1487,7 +2235,7 @@ if (userType.value === 'organization') {
             <div class="row">
                 <div class="col-md-6">
                     <h3>Информация о госте</h3>
-                    <p><strong>Гость:</strong> )" << escape_html(guest.full_name()) << R"(</p>
+                    <p><strong>Гость:</strong> )" << escape_full_name(guest) << R"(</p>
                     <p><strong>Телефон:</strong> )" << escape_html(guest.phone) << R"(</p>
                     <p><strong>Email:</strong> )" << escape_html(guest.email) << R"(</p>
                 </div>
@@ -1531,13 +2279,14 @@ if (userType.value === 'organization') {
     </div>
 </div>)";
 
-        return base_template("Редактировать бронирование - Система бронирования отелей", content.str(), "", user);
+        return base_template("Редактировать бронирование - Система бронирования отелей", content.view(), "", user);
     }
 
     static std::string user_bookings_list(Database& db, int64_t user_id, const std::string& error = "", const std::string& success = "", const User* user = nullptr) {
+        TraceSpan trace(__func__, "render");
         auto bookings = db.get_bookings_by_user(user_id);
         
-        std::ostringstream content;
+        HtmlStream content;
         content << R"(
 <div class="row mb-4">
     <div class="col-12">
@@ -1579,13 +2328,15 @@ if (userType.value === 'organization') {
                     <td colspan="7" class="text-center text-muted">У вас пока нет бронирований</td>
                 </tr>)";
         } else {
+            auto guests = db.get_guests_by_ids(collect_ids(bookings, [](const Booking& b) { return b.guest_id; }));
+            auto rooms = db.get_rooms_by_ids(collect_ids(bookings, [](const Booking& b) { return b.room_id; }));
             for (const auto& booking : bookings) {
-                Guest guest = db.get_guest(booking.guest_id);
-                Room room = db.get_room(booking.room_id);
+                const Guest& guest = find_or_empty(guests, booking.guest_id);
+                const Room& room = find_or_empty(rooms, booking.room_id);
                 content << R"(
                 <tr>
                     <td>)" << booking.booking_id << R"(</td>
-                    <td>)" << escape_html(guest.full_name()) << R"(</td>
+                    <td>)" << escape_full_name(guest) << R"(</td>
                     <td>)" << escape_html(room.number) << R"(</td>
                     <td>)" << escape_html(booking.check_in_date) << R"(</td>
                     <td>)" << escape_html(booking.check_out_date) << R"(</td>
@@ -1610,7 +2361,7 @@ if (userType.value === 'organization') {
     </div>
 </div>)";
 
-        return base_template("Мои бронирования - Система бронирования отелей", content.str(), "", user);
+        return base_template("Мои бронирования - Система бронирования отелей", content.view(), "", user);
     }
 };
 
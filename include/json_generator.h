@@ -0,0 +1,285 @@
+#ifndef JSON_GENERATOR_H
+#define JSON_GENERATOR_H
+
+#include "models.h"
+#include "database.h"
+#include "json_writer.h"
+#include "tracing.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Представления для JSON API (/api/v1/): те же выборки Database, что и у HtmlGenerator,
+// но запись идет сразу в тело ответа через JsonWriter, без шаблонов и escape_html.
+// Списки постраничные по ключу: {"items": [...], "next": "<url следующей страницы>" | null}.
+class JsonGenerator {
+public:
+    // Параметры страницы списка: ?after=<последний id>&limit=<размер>
+    struct Page {
+        static constexpr size_t DEFAULT_LIMIT = 50;
+        static constexpr size_t MAX_LIMIT = 200;
+
+        int64_t after = 0;
+        size_t limit = DEFAULT_LIMIT;
+    };
+
+    // Смешивается с версией строк, чтобы ETag JSON не совпадал с ETag HTML той же записи
+    static constexpr int64_t ETAG_SALT = 0x4a534f4e;  // "JSON"
+
+private:
+    static void write(JsonWriter& json, const Hotel& hotel) {
+        json.begin_object()
+            .field("id", hotel.hotel_id)
+            .field("organization_id", hotel.organization_id)
+            .field("name", hotel.name)
+            .field("description", hotel.description)
+            .field("address", hotel.address)
+            .field("created_at", hotel.created_at)
+            .field("updated_at", hotel.updated_at)
+            .end_object();
+    }
+
+    static void write(JsonWriter& json, const Room& room) {
+        json.begin_object()
+            .field("id", room.room_id)
+            .field("hotel_id", room.hotel_id)
+            .field("number", room.number)
+            .field("name", room.name)
+            .field("description", room.description)
+            .field("type", room.type_name)
+            .field("price_per_day", room.price_per_day)
+            .field("created_at", room.created_at)
+            .field("updated_at", room.updated_at)
+            .end_object();
+    }
+
+    static void write(JsonWriter& json, const Guest& guest) {
+        json.begin_object()
+            .field("id", guest.guest_id)
+            .field("first_name", guest.first_name)
+            .field("last_name", guest.last_name)
+            .field("middle_name", guest.middle_name)
+            .field("passport_number", guest.passport_number)
+            .field("email", guest.email)
+            .field("phone", guest.phone)
+            .field("created_at", guest.created_at)
+            .field("updated_at", guest.updated_at)
+            .end_object();
+    }
+
+    static void write(JsonWriter& json, const Booking& booking) {
+        json.begin_object()
+            .field("id", booking.booking_id)
+            .field("guest_id", booking.guest_id)
+            .field("room_id", booking.room_id)
+            .field("check_in", booking.check_in_date)
+            .field("check_out", booking.check_out_date)
+            .field("adults", booking.adults_count)
+            .field("children", booking.children_count)
+            .field("total_price", booking.total_price)
+            .field("special_requests", booking.special_requests)
+            .field("created_at", booking.created_at)
+            .field("updated_at", booking.updated_at)
+            .end_object();
+    }
+
+    static void write(JsonWriter& json, const Change& change) {
+        json.begin_object()
+            .field("seq", change.seq)
+            .field("entity", change.entity)
+            .field("id", change.entity_id)
+            .field("op", change.operation);
+        json.key("hotel_id");
+        if (change.hotel_id != 0) {
+            json.value(change.hotel_id);
+        } else {
+            json.null();
+        }
+        json.field("at", change.changed_at).end_object();
+    }
+
+    static void write_window(JsonWriter& json, std::string_view name, const StayWindow& window) {
+        json.key(name);
+        if (window.found) {
+            json.begin_object().field("check_in", window.check_in).field("check_out", window.check_out).end_object();
+        } else {
+            json.null();
+        }
+    }
+
+    // rows выбраны с limit + 1: лишняя строка означает, что есть следующая страница
+    template <typename Rows, typename Id>
+    static std::string page(Rows& rows, const Page& page, const std::string& next_base, Id id) {
+        bool has_next = rows.size() > page.limit;
+        if (has_next) {
+            rows.resize(page.limit);
+        }
+        std::string out;
+        out.reserve(256 + rows.size() * 256);
+        JsonWriter json(out);
+        json.begin_object().key("items").begin_array();
+        for (const auto& row : rows) {
+            write(json, row);
+        }
+        json.end_array().key("next");
+        if (has_next) {
+            json.value(next_base + (next_base.find('?') == std::string::npos ? "?" : "&") +
+                       "after=" + std::to_string(id(rows.back())) + "&limit=" + std::to_string(page.limit));
+        } else {
+            json.null();
+        }
+        json.end_object();
+        return out;
+    }
+
+    template <typename T>
+    static std::string single(const T& row) {
+        std::string out;
+        out.reserve(512);
+        JsonWriter json(out);
+        write(json, row);
+        return out;
+    }
+
+public:
+    static std::string error(std::string_view message) {
+        std::string out;
+        JsonWriter json(out);
+        json.begin_object().field("error", message).end_object();
+        return out;
+    }
+
+    static std::string hotels(Database& db, const Page& p) {
+        TraceSpan trace(__func__, "render");
+        auto rows = db.get_hotels_page(p.after, p.limit + 1);
+        return page(rows, p, "/api/v1/hotels/", [](const Hotel& h) { return h.hotel_id; });
+    }
+
+    static std::string hotel(const Hotel& hotel) {
+        return single(hotel);
+    }
+
+    static std::string rooms(Database& db, int64_t hotel_id, const Page& p) {
+        TraceSpan trace(__func__, "render");
+        auto rows = db.get_rooms_page(hotel_id, p.after, p.limit + 1);
+        std::string base = "/api/v1/rooms/";
+        if (hotel_id != 0) {
+            base += "?hotel_id=" + std::to_string(hotel_id);
+        }
+        return page(rows, p, base, [](const Room& r) { return r.room_id; });
+    }
+
+    static std::string room(const Room& room) {
+        return single(room);
+    }
+
+    static std::string guests(Database& db, int64_t user_id, const Page& p) {
+        TraceSpan trace(__func__, "render");
+        auto rows = db.get_guests_page(user_id, p.after, p.limit + 1);
+        return page(rows, p, "/api/v1/guests/", [](const Guest& g) { return g.guest_id; });
+    }
+
+    static std::string guest(const Guest& guest) {
+        return single(guest);
+    }
+
+    static std::string bookings(Database& db, int64_t user_id, bool organization, const Page& p) {
+        TraceSpan trace(__func__, "render");
+        auto rows = db.get_bookings_page(user_id, organization, p.after, p.limit + 1);
+        return page(rows, p, "/api/v1/bookings/", [](const Booking& b) { return b.booking_id; });
+    }
+
+    static std::string booking(const Booking& booking) {
+        return single(booking);
+    }
+
+    // Для занятого номера - ближайшие свободные интервалы той же длины:
+    // "alternatives": {"before": {"check_in", "check_out"} | null, "after": ... }
+    static std::string availability(int64_t room_id, const std::string& check_in, const std::string& check_out, bool available,
+                                    const FreeWindows* alternatives = nullptr) {
+        std::string out;
+        JsonWriter json(out);
+        json.begin_object()
+            .field("room_id", room_id)
+            .field("check_in", check_in)
+            .field("check_out", check_out)
+            .field("available", available);
+        if (alternatives) {
+            json.key("alternatives").begin_object();
+            write_window(json, "before", alternatives->before);
+            write_window(json, "after", alternatives->after);
+            json.end_object();
+        }
+        json.end_object();
+        return out;
+    }
+
+    // Варианты размещения: {"whole": [...], "split": [...]}, элемент -
+    // {"room_id", "number", "check_in", "check_out"}
+    static std::string stay_options(const StayOptions& options) {
+        std::string out;
+        JsonWriter json(out);
+        json.begin_object();
+        for (const auto* list : {&options.whole, &options.split}) {
+            json.key(list == &options.whole ? "whole" : "split").begin_array();
+            for (const StaySegment& segment : *list) {
+                json.begin_object()
+                    .field("room_id", segment.room_id)
+                    .field("number", segment.room_number)
+                    .field("check_in", segment.check_in)
+                    .field("check_out", segment.check_out)
+                    .end_object();
+            }
+            json.end_array();
+        }
+        json.end_object();
+        return out;
+    }
+
+    // Ответ long-poll журнала изменений: last_seq - курсор для следующего запроса (?since=)
+    template <typename Rows>
+    static std::string changes(const Rows& rows, int64_t last_seq) {
+        std::string out;
+        out.reserve(64 + rows.size() * 128);
+        JsonWriter json(out);
+        json.begin_object().key("changes").begin_array();
+        for (const auto& change : rows) {
+            write(json, change);
+        }
+        json.end_array().field("last_seq", last_seq).end_object();
+        return out;
+    }
+
+    // Одна запись журнала - данные события SSE
+    static std::string change(const Change& change) {
+        return single(change);
+    }
+
+    // Изменение отеля для живой панели организации
+    static std::string hotel_delta(int64_t hotel_id, size_t rooms) {
+        std::string out;
+        JsonWriter json(out);
+        json.begin_object().field("hotel_id", hotel_id).field("rooms", static_cast<uint64_t>(rooms)).end_object();
+        return out;
+    }
+
+    // Ответ пакетной проверки: {"results":[true,false,null,...]} в порядке запросов,
+    // null - номера не существует
+    static std::string availability_batch(const std::vector<Availability>& results) {
+        std::string out;
+        out.reserve(16 + results.size() * 6);
+        JsonWriter json(out);
+        json.begin_object().key("results").begin_array();
+        for (Availability result : results) {
+            if (result == Availability::UnknownRoom) {
+                json.null();
+            } else {
+                json.value(result == Availability::Free);
+            }
+        }
+        json.end_array().end_object();
+        return out;
+    }
+};
+
+#endif // JSON_GENERATOR_H
@@ -0,0 +1,238 @@
+#ifndef JSON_READER_H
+#define JSON_READER_H
+
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// Потоковое чтение JSON из тела запроса без построения дерева: вызывающий код
+// идет по документу в том же порядке, в каком его пишет JsonWriter.
+//   reader.begin_object();
+//   while (reader.next_key(key)) { if (key == "id") id = reader.read_int(); else reader.skip(); }
+// Запятые между элементами отслеживаются битовой маской уровней (до 64 уровней).
+// Ошибка разбора - std::runtime_error с позицией в тексте.
+class JsonReader {
+private:
+    std::string_view text;
+    size_t pos = 0;
+    uint64_t has_items = 0;   // бит уровня: элемент на уровне уже прочитан
+    unsigned depth = 0;
+
+    [[noreturn]] void fail(const char* message) const {
+        throw std::runtime_error(std::string("JSON: ") + message + " at offset " + std::to_string(pos));
+    }
+
+    void skip_space() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r')) {
+            ++pos;
+        }
+    }
+
+    char peek() {
+        skip_space();
+        return pos < text.size() ? text[pos] : '\0';
+    }
+
+    void expect(char c) {
+        if (peek() != c) {
+            fail((std::string("expected '") + c + "'").c_str());
+        }
+        ++pos;
+    }
+
+    void open(char bracket) {
+        expect(bracket);
+        if (++depth >= 64) {
+            fail("nesting too deep");
+        }
+        has_items &= ~(1ull << depth);
+    }
+
+    // true - есть следующий элемент, false - контейнер закрыт
+    bool next(char bracket) {
+        uint64_t bit = 1ull << depth;
+        if (peek() == bracket) {
+            ++pos;
+            --depth;
+            return false;
+        }
+        if (has_items & bit) {
+            expect(',');
+        }
+        has_items |= bit;
+        return true;
+    }
+
+    static void append_utf8(std::string& out, uint32_t code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xc0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xe0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        } else {
+            out += static_cast<char>(0xf0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        }
+    }
+
+    uint32_t read_hex4() {
+        if (pos + 4 > text.size()) {
+            fail("truncated \\u escape");
+        }
+        uint32_t code = 0;
+        auto result = std::from_chars(text.data() + pos, text.data() + pos + 4, code, 16);
+        if (result.ptr != text.data() + pos + 4) {
+            fail("invalid \\u escape");
+        }
+        pos += 4;
+        return code;
+    }
+
+    void skip_literal(std::string_view literal) {
+        if (text.substr(pos, literal.size()) != literal) {
+            fail("invalid literal");
+        }
+        pos += literal.size();
+    }
+
+public:
+    explicit JsonReader(std::string_view input) : text(input) {}
+
+    void begin_object() { open('{'); }
+    void begin_array() { open('['); }
+
+    // Следующее значение - объект (а не массив или скаляр)
+    bool at_object() {
+        return peek() == '{';
+    }
+
+    // Следующий ключ объекта; false - объект закончился
+    bool next_key(std::string& key) {
+        if (!next('}')) {
+            return false;
+        }
+        key = read_string();
+        expect(':');
+        return true;
+    }
+
+    // Есть ли следующий элемент массива; false - массив закончился
+    bool next_element() {
+        return next(']');
+    }
+
+    std::string read_string() {
+        expect('"');
+        std::string out;
+        size_t start = pos;
+        for (;;) {
+            if (pos >= text.size()) {
+                fail("unterminated string");
+            }
+            char c = text[pos];
+            if (c == '"') {
+                out.append(text.data() + start, pos - start);
+                ++pos;
+                return out;
+            }
+            if (static_cast<unsigned char>(c) < 0x20) {
+                fail("control character in string");
+            }
+            if (c != '\\') {
+                ++pos;
+                continue;
+            }
+            out.append(text.data() + start, pos - start);
+            if (++pos >= text.size()) {
+                fail("unterminated string");
+            }
+            char escape = text[pos++];
+            switch (escape) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    uint32_t code = read_hex4();
+                    if (code >= 0xd800 && code < 0xdc00 && text.substr(pos, 2) == "\\u") {
+                        pos += 2;
+                        uint32_t low = read_hex4();
+                        code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                    }
+                    append_utf8(out, code);
+                    break;
+                }
+                default: fail("invalid escape");
+            }
+            start = pos;
+        }
+    }
+
+    int64_t read_int() {
+        skip_space();
+        int64_t value = 0;
+        auto result = std::from_chars(text.data() + pos, text.data() + text.size(), value);
+        if (result.ec != std::errc()) {
+            fail("expected integer");
+        }
+        pos = static_cast<size_t>(result.ptr - text.data());
+        char c = pos < text.size() ? text[pos] : '\0';
+        if (c == '.' || c == 'e' || c == 'E') {
+            fail("expected integer");
+        }
+        return value;
+    }
+
+    // Пропускает значение любого типа (неизвестные поля)
+    void skip() {
+        char c = peek();
+        if (c == '{') {
+            begin_object();
+            std::string key;
+            while (next_key(key)) {
+                skip();
+            }
+        } else if (c == '[') {
+            begin_array();
+            while (next_element()) {
+                skip();
+            }
+        } else if (c == '"') {
+            read_string();
+        } else if (c == 't') {
+            skip_literal("true");
+        } else if (c == 'f') {
+            skip_literal("false");
+        } else if (c == 'n') {
+            skip_literal("null");
+        } else {
+            double number = 0;
+            auto result = std::from_chars(text.data() + pos, text.data() + text.size(), number);
+            if (result.ec != std::errc()) {
+                fail("unexpected character");
+            }
+            pos = static_cast<size_t>(result.ptr - text.data());
+        }
+    }
+
+    // После корневого значения допустимы только пробелы
+    void end() {
+        if (peek() != '\0' || pos != text.size()) {
+            fail("trailing data");
+        }
+    }
+};
+
+#endif // JSON_READER_H
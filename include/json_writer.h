@@ -0,0 +1,164 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// Потоковая запись JSON прямо в строку ответа, без промежуточного дерева.
+// Запятые расставляются по битовой маске уровней вложенности (до 64 уровней),
+// строки экранируются участками: безопасные байты копируются одним append.
+// Числа - через std::to_chars (без локали и потоков).
+class JsonWriter {
+private:
+    std::string& out;
+    uint64_t has_items = 0;   // бит уровня: на уровне уже есть элемент
+    unsigned depth = 0;
+    bool after_key = false;
+
+    // 0 - копировать как есть, иначе символ после '\' ('u' - \u00XX)
+    static const char* escape_table() {
+        static const char* table = [] {
+            static char t[256] = {};
+            for (int c = 0; c < 0x20; ++c) t[c] = 'u';
+            t[static_cast<unsigned char>('"')] = '"';
+            t[static_cast<unsigned char>('\\')] = '\\';
+            t[static_cast<unsigned char>('\b')] = 'b';
+            t[static_cast<unsigned char>('\f')] = 'f';
+            t[static_cast<unsigned char>('\n')] = 'n';
+            t[static_cast<unsigned char>('\r')] = 'r';
+            t[static_cast<unsigned char>('\t')] = 't';
+            return t;
+        }();
+        return table;
+    }
+
+    void separator() {
+        if (after_key) {
+            after_key = false;
+            return;
+        }
+        uint64_t bit = 1ull << depth;
+        if (has_items & bit) {
+            out += ',';
+        }
+        has_items |= bit;
+    }
+
+    void open(char bracket) {
+        separator();
+        out += bracket;
+        if (++depth >= 64) {
+            throw std::runtime_error("JSON nesting too deep");
+        }
+        has_items &= ~(1ull << depth);
+    }
+
+    void close(char bracket) {
+        --depth;
+        out += bracket;
+    }
+
+    void string(std::string_view text) {
+        static const char hex[] = "0123456789abcdef";
+        const char* table = escape_table();
+        out += '"';
+        size_t start = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            char escape = table[static_cast<unsigned char>(text[i])];
+            if (escape == 0) {
+                continue;
+            }
+            out.append(text.data() + start, i - start);
+            out += '\\';
+            out += escape;
+            if (escape == 'u') {
+                unsigned char c = static_cast<unsigned char>(text[i]);
+                out += "00";
+                out += hex[c >> 4];
+                out += hex[c & 0xf];
+            }
+            start = i + 1;
+        }
+        out.append(text.data() + start, text.size() - start);
+        out += '"';
+    }
+
+public:
+    explicit JsonWriter(std::string& output) : out(output) {}
+
+    JsonWriter& begin_object() { open('{'); return *this; }
+    JsonWriter& end_object() { close('}'); return *this; }
+    JsonWriter& begin_array() { open('['); return *this; }
+    JsonWriter& end_array() { close(']'); return *this; }
+
+    JsonWriter& key(std::string_view name) {
+        separator();
+        string(name);
+        out += ':';
+        after_key = true;
+        return *this;
+    }
+
+    JsonWriter& value(std::string_view text) {
+        separator();
+        string(text);
+        return *this;
+    }
+
+    JsonWriter& value(const std::string& text) { return value(std::string_view(text)); }
+    JsonWriter& value(const char* text) { return value(std::string_view(text)); }
+
+    JsonWriter& value(int64_t number) {
+        separator();
+        char buffer[24];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+        out.append(buffer, static_cast<size_t>(result.ptr - buffer));
+        return *this;
+    }
+
+    JsonWriter& value(uint64_t number) {
+        separator();
+        char buffer[24];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+        out.append(buffer, static_cast<size_t>(result.ptr - buffer));
+        return *this;
+    }
+
+    JsonWriter& value(int number) { return value(static_cast<int64_t>(number)); }
+
+    // Кратчайшая запись, однозначно восстанавливающая число; NaN и бесконечность - null
+    JsonWriter& value(double number) {
+        if (!std::isfinite(number)) {
+            return null();
+        }
+        separator();
+        char buffer[32];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+        out.append(buffer, static_cast<size_t>(result.ptr - buffer));
+        return *this;
+    }
+
+    JsonWriter& value(bool flag) {
+        separator();
+        out += flag ? "true" : "false";
+        return *this;
+    }
+
+    JsonWriter& null() {
+        separator();
+        out += "null";
+        return *this;
+    }
+
+    template <typename T>
+    JsonWriter& field(std::string_view name, const T& v) {
+        key(name);
+        return value(v);
+    }
+};
+
+#endif // JSON_WRITER_H
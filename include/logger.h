@@ -0,0 +1,298 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+enum class LogLevel {
+    Debug,
+    Info,
+    Warn,
+    Error
+};
+
+// Поле структурированной записи: key=value (строка или число)
+struct LogField {
+    const char* key;
+    std::string_view text;
+    int64_t number = 0;
+    bool is_number = false;
+
+    LogField(const char* k, std::string_view value) : key(k), text(value) {}
+    LogField(const char* k, const std::string& value) : key(k), text(value) {}
+    LogField(const char* k, const char* value) : key(k), text(value ? value : "") {}
+    template <typename T, typename = std::enable_if_t<std::is_integral<T>::value>>
+    LogField(const char* k, T value) : key(k), number(static_cast<int64_t>(value)), is_number(true) {}
+};
+
+// Асинхронный журнал.
+// Потоки-производители раскладывают запись (уровень, время, сообщение и поля key=value)
+// в ограниченную lock-free очередь MPSC (кольцо ячеек с номерами последовательности,
+// схема Д. Вьюкова) и сразу возвращаются; фоновый поток форматирует время и пишет
+// в stderr пачками. Дата и время до секунды форматируются один раз в секунду.
+// Если кольцо заполнено, запись отбрасывается и учитывается в счетчике своего уровня;
+// сводка об отброшенных записях попадает в журнал, когда место освобождается.
+class Logger {
+public:
+    static constexpr size_t CAPACITY = 4096;       // степень двойки
+    static constexpr size_t TEXT_SIZE = 1000;
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence{0};
+        LogLevel level = LogLevel::Info;
+        int64_t time_us = 0;
+        uint32_t length = 0;
+        char text[TEXT_SIZE];
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    alignas(64) std::atomic<size_t> enqueue_pos{0};
+    alignas(64) size_t dequeue_pos = 0;
+    std::atomic<int> min_level{static_cast<int>(LogLevel::Info)};
+    std::array<std::atomic<uint64_t>, 4> written{};
+    std::array<std::atomic<uint64_t>, 4> dropped{};
+    uint64_t reported_drops = 0;
+
+    std::atomic<bool> stopping{false};
+    std::thread writer;
+
+    // Кэш "YYYY-MM-DD HH:MM:SS" для текущей секунды (используется только фоновым потоком)
+    int64_t cached_second = -1;
+    char cached_time[32] = {};
+
+    // Дописывает текст в буфер записи, обрезая по размеру
+    static void append(char* buffer, uint32_t& length, std::string_view text) {
+        size_t count = std::min(text.size(), TEXT_SIZE - length);
+        std::memcpy(buffer + length, text.data(), count);
+        length += static_cast<uint32_t>(count);
+    }
+
+    static void append_field(char* buffer, uint32_t& length, const LogField& field) {
+        append(buffer, length, " ");
+        append(buffer, length, field.key);
+        append(buffer, length, "=");
+        if (field.is_number) {
+            char number[24];
+            auto result = std::to_chars(number, number + sizeof(number), field.number);
+            append(buffer, length, std::string_view(number, static_cast<size_t>(result.ptr - number)));
+            return;
+        }
+        bool quote = field.text.empty() || field.text.find_first_of(" \"=\n") != std::string_view::npos;
+        if (!quote) {
+            append(buffer, length, field.text);
+            return;
+        }
+        append(buffer, length, "\"");
+        for (char c : field.text) {
+            if (c == '"' || c == '\\') {
+                append(buffer, length, "\\");
+                append(buffer, length, std::string_view(&c, 1));
+            } else if (c == '\n') {
+                append(buffer, length, "\\n");
+            } else {
+                append(buffer, length, std::string_view(&c, 1));
+            }
+        }
+        append(buffer, length, "\"");
+    }
+
+    const char* format_time(int64_t time_us) {
+        int64_t second = time_us / 1000000;
+        if (second != cached_second) {
+            std::time_t t = static_cast<std::time_t>(second);
+            std::tm tm{};
+            localtime_r(&t, &tm);
+            std::strftime(cached_time, sizeof(cached_time), "%Y-%m-%d %H:%M:%S", &tm);
+            cached_second = second;
+        }
+        return cached_time;
+    }
+
+    bool try_dequeue(std::string& out) {
+        Cell& cell = cells[dequeue_pos & (CAPACITY - 1)];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        if (sequence != dequeue_pos + 1) {
+            return false;  // пусто
+        }
+        char millis[8];
+        std::snprintf(millis, sizeof(millis), ".%03d", static_cast<int>((cell.time_us / 1000) % 1000));
+        out += '[';
+        out += level_label(cell.level);
+        out += "] ";
+        out += format_time(cell.time_us);
+        out += millis;
+        out += " - ";
+        out.append(cell.text, cell.length);
+        out += '\n';
+        cell.sequence.store(dequeue_pos + CAPACITY, std::memory_order_release);
+        ++dequeue_pos;
+        return true;
+    }
+
+    void report_drops(std::string& out) {
+        uint64_t total = 0;
+        for (const auto& counter : dropped) {
+            total += counter.load(std::memory_order_relaxed);
+        }
+        if (total == reported_drops) {
+            return;
+        }
+        int64_t now_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        out += "[WARN] ";
+        out += format_time(now_us);
+        out += " - log ring full, dropped=" + std::to_string(total - reported_drops) + "\n";
+        reported_drops = total;
+    }
+
+    void run() {
+        std::string out;
+        out.reserve(64 * 1024);
+        for (;;) {
+            bool stop = stopping.load(std::memory_order_acquire);
+            size_t batch = 0;
+            while (batch < 256 && try_dequeue(out)) {
+                ++batch;
+            }
+            if (batch == 0) {
+                report_drops(out);
+            }
+            if (!out.empty()) {
+                std::fwrite(out.data(), 1, out.size(), stderr);
+                std::fflush(stderr);
+                out.clear();
+            }
+            if (batch == 0) {
+                if (stop) {
+                    return;  // остановка и очередь пуста
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+        }
+    }
+
+    Logger() : cells(new Cell[CAPACITY]) {
+        for (size_t i = 0; i < CAPACITY; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        writer = std::thread([this] { run(); });
+    }
+
+public:
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    ~Logger() {
+        stopping.store(true, std::memory_order_release);
+        if (writer.joinable()) {
+            writer.join();
+        }
+    }
+
+    static Logger& instance() {
+        static Logger logger;
+        return logger;
+    }
+
+    static const char* level_label(LogLevel level) {
+        switch (level) {
+            case LogLevel::Debug: return "DEBUG";
+            case LogLevel::Info: return "INFO";
+            case LogLevel::Warn: return "WARN";
+            case LogLevel::Error: return "ERROR";
+        }
+        return "INFO";
+    }
+
+    static LogLevel parse_level(const std::string& name) {
+        if (name == "debug") return LogLevel::Debug;
+        if (name == "info") return LogLevel::Info;
+        if (name == "warn") return LogLevel::Warn;
+        if (name == "error") return LogLevel::Error;
+        throw std::runtime_error("Invalid log level: " + name + " (expected debug, info, warn or error)");
+    }
+
+    void set_level(LogLevel level) {
+        min_level.store(static_cast<int>(level), std::memory_order_relaxed);
+    }
+
+    bool enabled(LogLevel level) const {
+        return static_cast<int>(level) >= min_level.load(std::memory_order_relaxed);
+    }
+
+    // Кладет запись в очередь; false - уровень отключен или кольцо заполнено
+    bool write(LogLevel level, std::string_view message, std::initializer_list<LogField> fields) {
+        if (!enabled(level)) {
+            return false;
+        }
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells[pos & (CAPACITY - 1)];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            if (sequence == pos) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (sequence < pos) {
+                dropped[static_cast<size_t>(level)].fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->level = level;
+        cell->time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        cell->length = 0;
+        append(cell->text, cell->length, message);
+        for (const auto& field : fields) {
+            append_field(cell->text, cell->length, field);
+        }
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        written[static_cast<size_t>(level)].fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    uint64_t written_count(LogLevel level) const {
+        return written[static_cast<size_t>(level)].load(std::memory_order_relaxed);
+    }
+
+    uint64_t dropped_count(LogLevel level) const {
+        return dropped[static_cast<size_t>(level)].load(std::memory_order_relaxed);
+    }
+
+    static void debug(std::string_view message, std::initializer_list<LogField> fields = {}) {
+        instance().write(LogLevel::Debug, message, fields);
+    }
+
+    static void info(std::string_view message, std::initializer_list<LogField> fields = {}) {
+        instance().write(LogLevel::Info, message, fields);
+    }
+
+    static void warn(std::string_view message, std::initializer_list<LogField> fields = {}) {
+        instance().write(LogLevel::Warn, message, fields);
+    }
+
+    static void error(std::string_view message, std::initializer_list<LogField> fields = {}) {
+        instance().write(LogLevel::Error, message, fields);
+    }
+};
+
+#endif // LOGGER_H
@@ -0,0 +1,275 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Гистограмма задержек в микросекундах с лог-линейными корзинами (как в HDR Histogram):
+// каждый интервал [2^k, 2^(k+1)) делится на SUB_BUCKETS равных частей, что дает
+// относительную точность около 12% от 1 мкс до ~67 с.
+// Пишет только поток-владелец, поэтому запись - это load + store без read-modify-write.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 3;
+    static constexpr uint64_t SUB_BUCKETS = 1u << SUB_BITS;
+    static constexpr int MAX_POWER = 26;  // 2^26 мкс ~ 67 с, дальше - последняя корзина
+    static constexpr size_t BUCKET_COUNT = SUB_BUCKETS + (MAX_POWER - SUB_BITS + 1) * SUB_BUCKETS;
+
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum_us{0};
+
+    static size_t bucket_index(uint64_t us) {
+        if (us < SUB_BUCKETS) {
+            return static_cast<size_t>(us);
+        }
+        int power = 63 - __builtin_clzll(us);
+        if (power > MAX_POWER) {
+            return BUCKET_COUNT - 1;
+        }
+        uint64_t sub = (us >> (power - SUB_BITS)) & (SUB_BUCKETS - 1);
+        return SUB_BUCKETS + static_cast<size_t>(power - SUB_BITS) * SUB_BUCKETS + static_cast<size_t>(sub);
+    }
+
+    // Верхняя граница корзины (не включительно), мкс
+    static uint64_t bucket_upper(size_t index) {
+        if (index < SUB_BUCKETS) {
+            return index + 1;
+        }
+        size_t group = (index - SUB_BUCKETS) / SUB_BUCKETS;
+        uint64_t sub = (index - SUB_BUCKETS) % SUB_BUCKETS;
+        int power = static_cast<int>(group) + SUB_BITS;
+        return (uint64_t(1) << power) + ((sub + 1) << (power - SUB_BITS));
+    }
+
+    void record(uint64_t us) {
+        add(buckets[bucket_index(us)], 1);
+        add(count, 1);
+        add(sum_us, us);
+    }
+
+    static void add(std::atomic<uint64_t>& counter, uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+};
+
+// Метрики в формате Prometheus.
+// Каждый рабочий поток пишет только в свой блок счетчиков (без блокировок и общих
+// кэш-линий); при запросе /metrics блоки всех потоков суммируются.
+class Metrics {
+public:
+    static constexpr size_t STATUS_CLASSES = 5;  // 1xx..5xx
+
+private:
+    struct RouteCounters {
+        std::array<std::atomic<uint64_t>, STATUS_CLASSES> status{};
+        LatencyHistogram duration;
+        std::atomic<uint64_t> buffered_bytes{0};  // только res.body: потоки и content provider - 0
+        std::atomic<uint64_t> render_us{0};
+        std::atomic<uint64_t> sql_queries{0};
+        std::atomic<uint64_t> sql_ns{0};
+    };
+
+    struct ThreadBlock {
+        std::unique_ptr<RouteCounters[]> routes;  // последний элемент - запросы вне маршрутов
+        std::atomic<uint64_t> started{0};
+        std::atomic<uint64_t> finished{0};
+        // SQL текущего запроса потока
+        uint64_t request_queries = 0;
+        uint64_t request_sql_ns = 0;
+    };
+
+    std::vector<std::string> route_names;
+    std::mutex blocks_mutex;
+    std::vector<std::unique_ptr<ThreadBlock>> blocks;
+
+    static inline thread_local ThreadBlock* local_block = nullptr;
+    static inline thread_local const Metrics* local_owner = nullptr;
+
+    ThreadBlock& block() {
+        if (local_owner != this) {
+            auto created = std::make_unique<ThreadBlock>();
+            created->routes.reset(new RouteCounters[route_names.size() + 1]);
+            local_block = created.get();
+            local_owner = this;
+            std::lock_guard<std::mutex> lock(blocks_mutex);
+            blocks.push_back(std::move(created));
+        }
+        return *local_block;
+    }
+
+    static std::string escape_label(const std::string& value) {
+        std::string result;
+        for (char c : value) {
+            if (c == '"' || c == '\\') result += '\\';
+            result += c;
+        }
+        return result;
+    }
+
+    static std::string seconds(uint64_t value, double scale) {
+        std::ostringstream out;
+        out << std::setprecision(9) << value / scale;
+        return out.str();
+    }
+
+public:
+    Metrics() = default;
+
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    // Имена маршрутов задаются один раз до запуска сервера; индекс = Route::id
+    void set_route_names(std::vector<std::string> names) {
+        route_names = std::move(names);
+    }
+
+    void request_started() {
+        ThreadBlock& b = block();
+        LatencyHistogram::add(b.started, 1);
+        b.request_queries = 0;
+        b.request_sql_ns = 0;
+    }
+
+    // Вызывается из обработчика статистики SQLite
+    void record_query(uint64_t nanoseconds) {
+        ThreadBlock& b = block();
+        ++b.request_queries;
+        b.request_sql_ns += nanoseconds;
+    }
+
+    // bytes - размер res.body. Потоковые ответы и content provider пишутся в сокет уже
+    // после наблюдателей, поэтому учитываются как 0 (отсюда имя метрики buffered_bytes)
+    void request_finished(size_t route_id, int status, std::chrono::steady_clock::duration elapsed, uint64_t bytes) {
+        ThreadBlock& b = block();
+        RouteCounters& r = b.routes[route_id < route_names.size() ? route_id : route_names.size()];
+        uint64_t us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+        uint64_t sql_us = b.request_sql_ns / 1000;
+
+        size_t status_class = status >= 100 && status < 600 ? static_cast<size_t>(status / 100 - 1) : STATUS_CLASSES - 1;
+        LatencyHistogram::add(r.status[status_class], 1);
+        r.duration.record(us);
+        LatencyHistogram::add(r.buffered_bytes, bytes);
+        LatencyHistogram::add(r.render_us, us > sql_us ? us - sql_us : 0);
+        LatencyHistogram::add(r.sql_queries, b.request_queries);
+        LatencyHistogram::add(r.sql_ns, b.request_sql_ns);
+        b.request_queries = 0;
+        b.request_sql_ns = 0;
+        LatencyHistogram::add(b.finished, 1);
+    }
+
+    // Текстовый формат Prometheus 0.0.4
+    std::string render() {
+        size_t route_count = route_names.size() + 1;
+        std::vector<uint64_t> status(route_count * STATUS_CLASSES, 0);
+        std::vector<uint64_t> histogram(route_count * LatencyHistogram::BUCKET_COUNT, 0);
+        std::vector<uint64_t> count(route_count, 0), sum_us(route_count, 0), bytes(route_count, 0),
+            render_us(route_count, 0), queries(route_count, 0), sql_ns(route_count, 0);
+        uint64_t started = 0, finished = 0;
+
+        {
+            std::lock_guard<std::mutex> lock(blocks_mutex);
+            for (const auto& b : blocks) {
+                started += b->started.load(std::memory_order_relaxed);
+                finished += b->finished.load(std::memory_order_relaxed);
+                for (size_t i = 0; i < route_count; ++i) {
+                    const RouteCounters& r = b->routes[i];
+                    for (size_t s = 0; s < STATUS_CLASSES; ++s) {
+                        status[i * STATUS_CLASSES + s] += r.status[s].load(std::memory_order_relaxed);
+                    }
+                    for (size_t k = 0; k < LatencyHistogram::BUCKET_COUNT; ++k) {
+                        histogram[i * LatencyHistogram::BUCKET_COUNT + k] += r.duration.buckets[k].load(std::memory_order_relaxed);
+                    }
+                    count[i] += r.duration.count.load(std::memory_order_relaxed);
+                    sum_us[i] += r.duration.sum_us.load(std::memory_order_relaxed);
+                    bytes[i] += r.buffered_bytes.load(std::memory_order_relaxed);
+                    render_us[i] += r.render_us.load(std::memory_order_relaxed);
+                    queries[i] += r.sql_queries.load(std::memory_order_relaxed);
+                    sql_ns[i] += r.sql_ns.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        auto label = [this](size_t i) {
+            return "route=\"" + escape_label(i < route_names.size() ? route_names[i] : "other") + "\"";
+        };
+
+        std::ostringstream out;
+        out << "# HELP hotels_http_requests_in_flight Requests being handled right now.\n"
+            << "# TYPE hotels_http_requests_in_flight gauge\n"
+            << "hotels_http_requests_in_flight " << (started >= finished ? started - finished : 0) << "\n";
+
+        out << "# HELP hotels_http_requests_total Handled requests by route and status class.\n"
+            << "# TYPE hotels_http_requests_total counter\n";
+        for (size_t i = 0; i < route_count; ++i) {
+            if (count[i] == 0) continue;
+            for (size_t s = 0; s < STATUS_CLASSES; ++s) {
+                uint64_t value = status[i * STATUS_CLASSES + s];
+                if (value != 0) {
+                    out << "hotels_http_requests_total{" << label(i) << ",status=\"" << (s + 1) << "xx\"} " << value << "\n";
+                }
+            }
+        }
+
+        // Корзины экспортируются на границах степеней двойки: они совпадают с границами
+        // внутренних корзин, поэтому накопленные значения точные
+        out << "# HELP hotels_http_request_duration_seconds Request handling time by route.\n"
+            << "# TYPE hotels_http_request_duration_seconds histogram\n";
+        for (size_t i = 0; i < route_count; ++i) {
+            if (count[i] == 0) continue;
+            uint64_t cumulative = 0;
+            size_t k = 0;
+            for (int power = 0; power <= LatencyHistogram::MAX_POWER; ++power) {
+                uint64_t bound = uint64_t(1) << power;
+                while (k < LatencyHistogram::BUCKET_COUNT - 1 && LatencyHistogram::bucket_upper(k) <= bound) {
+                    cumulative += histogram[i * LatencyHistogram::BUCKET_COUNT + k];
+                    ++k;
+                }
+                out << "hotels_http_request_duration_seconds_bucket{" << label(i) << ",le=\"" << seconds(bound, 1e6) << "\"} " << cumulative << "\n";
+            }
+            out << "hotels_http_request_duration_seconds_bucket{" << label(i) << ",le=\"+Inf\"} " << count[i] << "\n"
+                << "hotels_http_request_duration_seconds_sum{" << label(i) << "} " << seconds(sum_us[i], 1e6) << "\n"
+                << "hotels_http_request_duration_seconds_count{" << label(i) << "} " << count[i] << "\n";
+        }
+
+        struct Series {
+            const char* name;
+            const char* type;
+            const char* help;
+            const std::vector<uint64_t>& values;
+            double scale;
+        };
+        const Series series[] = {
+            {"hotels_http_response_buffered_bytes_total", "counter",
+             "Buffered response body bytes by route; streamed and content-provider responses (SSE, /static/, trace dump) are not counted.", bytes, 1},
+            {"hotels_page_render_seconds_total", "counter", "Handler time outside SQLite (rendering) by route.", render_us, 1e6},
+            {"hotels_sqlite_queries_total", "counter", "SQLite statements executed by route.", queries, 1},
+            {"hotels_sqlite_query_seconds_total", "counter", "Time spent in SQLite by route.", sql_ns, 1e9},
+        };
+        for (const auto& item : series) {
+            out << "# HELP " << item.name << " " << item.help << "\n"
+                << "# TYPE " << item.name << " " << item.type << "\n";
+            for (size_t i = 0; i < route_count; ++i) {
+                if (count[i] == 0) continue;
+                out << item.name << "{" << label(i) << "} ";
+                if (item.scale == 1) {
+                    out << item.values[i];
+                } else {
+                    out << seconds(item.values[i], item.scale);
+                }
+                out << "\n";
+            }
+        }
+        return out.str();
+    }
+};
+
+#endif // METRICS_H
@@ -1,7 +1,10 @@
 #ifndef MODELS_H
 #define MODELS_H
 
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <ctime>
 #include <chrono>
 #include <sstream>
@@ -102,21 +105,108 @@ struct Hotel {
     Hotel() = default;
 };
 
-// Утилита для получения текущей даты/времени
+// Запись журнала изменений (таблица changes): что изменилось, без данных строки
+struct Change {
+    int64_t seq = 0;        // возрастающий номер, курсор потребителя
+    std::string entity;     // "hotel", "room", "guest", "booking"
+    int64_t entity_id = 0;
+    std::string operation;  // "insert", "update", "delete"
+    int64_t hotel_id = 0;   // отель номера или бронирования, 0 - для гостей
+    std::string changed_at;
+};
+
+// Запрос пакетной проверки доступности: номер и полуинтервал дат [check_in, check_out)
+struct AvailabilityQuery {
+    int64_t room_id = 0;
+    std::string check_in;
+    std::string check_out;
+};
+
+enum class Availability : uint8_t {
+    Free,
+    Booked,
+    UnknownRoom
+};
+
+// Свободный интервал дат [check_in, check_out); found = false - не найден
+struct StayWindow {
+    bool found = false;
+    std::string check_in;
+    std::string check_out;
+};
+
+// Ближайшие свободные интервалы той же длины раньше и позже запрошенного
+struct FreeWindows {
+    StayWindow before;
+    StayWindow after;
+};
+
+// Отрезок проживания: номер на полуинтервал дат [check_in, check_out)
+struct StaySegment {
+    int64_t room_id = 0;
+    std::string room_number;
+    std::string check_in;
+    std::string check_out;
+};
+
+// Варианты размещения в отеле, когда выбранный номер занят
+struct StayOptions {
+    std::vector<StaySegment> whole;  // номера того же типа, свободные на весь срок
+    std::vector<StaySegment> split;  // если таких нет - проживание с наименьшим числом переездов
+};
+
+// Версия данных страницы для условного GET: хеш версий всех показанных строк
+// и самое позднее updated_at. Владельцы нужны для проверки доступа без отдельного запроса.
+struct PageVersion {
+    bool found = false;
+    uint64_t tag = 1469598103934665603ull;  // FNV-1a
+    std::string last_modified;              // "YYYY-MM-DD HH:MM:SS", местное время
+    int64_t user_id = 0;                    // пользователь, создавший гостя
+    int64_t organization_id = 0;            // организация отеля номера
+
+    void add(int64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            tag ^= static_cast<uint64_t>(value >> (8 * i)) & 0xff;
+            tag *= 1099511628211ull;
+        }
+    }
+
+    // Для ответов без версий строк (списки API): хеш готового тела
+    void add_bytes(std::string_view data) {
+        for (unsigned char c : data) {
+            tag ^= c;
+            tag *= 1099511628211ull;
+        }
+    }
+
+    void touch(const char* updated_at) {
+        if (updated_at && last_modified < updated_at) {
+            last_modified = updated_at;
+        }
+    }
+};
+
+// Текущие локальные дата и время "ГГГГ-ММ-ДД ЧЧ:ММ:СС" для полей created_at/updated_at.
+// Строка форматируется не чаще раза в секунду на поток (как время в Logger), а
+// localtime_r не делит статический буфер std::localtime между рабочими потоками.
 inline std::string get_current_datetime() {
-    auto now = std::chrono::system_clock::now();
-    auto time = std::chrono::system_clock::to_time_t(now);
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&time), "%Y-%m-%d %H:%M:%S");
-    return ss.str();
+    struct Cache {
+        std::time_t second = -1;
+        char text[32] = {};
+    };
+    static thread_local Cache cache;
+    std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    if (now != cache.second) {
+        std::tm tm{};
+        localtime_r(&now, &tm);
+        std::strftime(cache.text, sizeof(cache.text), "%Y-%m-%d %H:%M:%S", &tm);
+        cache.second = now;
+    }
+    return cache.text;
 }
 
 inline std::string get_current_date() {
-    auto now = std::chrono::system_clock::now();
-    auto time = std::chrono::system_clock::to_time_t(now);
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&time), "%Y-%m-%d");
-    return ss.str();
+    return get_current_datetime().substr(0, 10);
 }
 
 #endif // MODELS_H
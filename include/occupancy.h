@@ -0,0 +1,153 @@
+#ifndef OCCUPANCY_H
+#define OCCUPANCY_H
+
+#include "date_utils.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Занятость номеров отеля на период до MAX_DAYS дней в виде битовых карт.
+// Две раскладки одних и тех же данных:
+//   rows    - по номеру: бит d - ночь с дня d на d+1 занята (ряд сетки календаря);
+//   columns - по дню: бит r - номер r занят в эту ночь (итоги дня через popcount).
+// Бронирование отмечается масками на целые 64-битные слова, а не по клеткам.
+class OccupancyCalendar {
+public:
+    static constexpr int MAX_DAYS = 90;
+
+private:
+    static constexpr int ROW_WORDS = (MAX_DAYS + 63) / 64;
+    using Row = std::array<uint64_t, ROW_WORDS>;
+
+    int64_t first_day;
+    int days;
+    std::vector<int64_t> room_ids;
+    std::unordered_map<int64_t, size_t> room_index;
+    std::vector<Row> rows;
+    size_t column_words;
+    std::vector<uint64_t> columns;  // days * column_words
+
+    // Биты [from, to) внутри слова word
+    static uint64_t range_mask(int word, int from, int to) {
+        int low = std::max(from - word * 64, 0);
+        int high = std::min(to - word * 64, 64);
+        if (low >= high) {
+            return 0;
+        }
+        uint64_t upper = high == 64 ? ~0ull : (1ull << high) - 1;
+        return upper & ~((1ull << low) - 1);
+    }
+
+public:
+    // room_ids - номера в порядке рядов сетки
+    OccupancyCalendar(int64_t first_day, int days, std::vector<int64_t> rooms)
+        : first_day(first_day), days(days), room_ids(std::move(rooms)), rows(room_ids.size(), Row{}),
+          column_words((room_ids.size() + 63) / 64), columns(static_cast<size_t>(days) * column_words, 0) {
+        if (days < 1 || days > MAX_DAYS) {
+            throw std::runtime_error("Occupancy period must be 1-" + std::to_string(MAX_DAYS) + " days");
+        }
+        room_index.reserve(room_ids.size());
+        for (size_t i = 0; i < room_ids.size(); ++i) {
+            room_index.emplace(room_ids[i], i);
+        }
+    }
+
+    // Ночи бронирования [check_in, check_out), обрезанные по периоду. false - номер не из
+    // этого календаря, даты неверны или бронирование не попадает в период
+    bool occupy(int64_t room_id, const std::string& check_in, const std::string& check_out) {
+        auto it = room_index.find(room_id);
+        int64_t in_day = 0;
+        int64_t out_day = 0;
+        if (it == room_index.end() || !date_utils::parse_day(check_in, in_day) || !date_utils::parse_day(check_out, out_day)) {
+            return false;
+        }
+        int from = static_cast<int>(std::max<int64_t>(in_day - first_day, 0));
+        int to = static_cast<int>(std::min<int64_t>(out_day - first_day, days));
+        if (from >= to) {
+            return false;
+        }
+        size_t room = it->second;
+        Row& row = rows[room];
+        for (int word = from / 64; word <= (to - 1) / 64; ++word) {
+            row[word] |= range_mask(word, from, to);
+        }
+        uint64_t room_bit = 1ull << (room % 64);
+        for (int day = from; day < to; ++day) {
+            columns[static_cast<size_t>(day) * column_words + room / 64] |= room_bit;
+        }
+        return true;
+    }
+
+    int64_t get_first_day() const { return first_day; }
+    int get_days() const { return days; }
+    size_t room_count() const { return room_ids.size(); }
+    int64_t room_id(size_t room) const { return room_ids[room]; }
+
+    bool occupied(size_t room, int day) const {
+        return (rows[room][day / 64] >> (day % 64)) & 1;
+    }
+
+    // Первая занятая ночь номера начиная с day; days - свободен до конца периода
+    int next_occupied(size_t room, int day) const {
+        const Row& row = rows[room];
+        for (int word = day / 64; word < ROW_WORDS; ++word) {
+            uint64_t bits = row[word];
+            if (word == day / 64) {
+                bits &= ~0ull << (day % 64);
+            }
+            if (bits != 0) {
+                return std::min(word * 64 + __builtin_ctzll(bits), days);
+            }
+        }
+        return days;
+    }
+
+    // Занятые ночи номера за период
+    int room_nights(size_t room) const {
+        int nights = 0;
+        for (uint64_t word : rows[room]) {
+            nights += __builtin_popcountll(word);
+        }
+        return nights;
+    }
+
+    // Занятые номера в ночь day
+    int day_total(int day) const {
+        int total = 0;
+        const uint64_t* column = columns.data() + static_cast<size_t>(day) * column_words;
+        for (size_t i = 0; i < column_words; ++i) {
+            total += __builtin_popcountll(column[i]);
+        }
+        return total;
+    }
+
+    // Отрезки одинакового состояния в ряду номера: f(first_day_offset, length, occupied).
+    // Граница отрезка ищется по слову сразу: ctz от слова, где биты текущего состояния погашены.
+    template <typename F>
+    void for_each_run(size_t room, F f) const {
+        const Row& row = rows[room];
+        int pos = 0;
+        while (pos < days) {
+            bool state = occupied(room, pos);
+            int end = days;
+            for (int word = pos / 64; word < ROW_WORDS; ++word) {
+                uint64_t changes = state ? ~row[word] : row[word];
+                if (word == pos / 64) {
+                    changes &= ~0ull << (pos % 64);
+                }
+                if (changes != 0) {
+                    end = std::min(word * 64 + __builtin_ctzll(changes), days);
+                    break;
+                }
+            }
+            f(pos, end - pos, state);
+            pos = end;
+        }
+    }
+};
+
+#endif // OCCUPANCY_H
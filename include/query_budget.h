@@ -0,0 +1,188 @@
+#ifndef QUERY_BUDGET_H
+#define QUERY_BUDGET_H
+
+#include "logger.h"
+#include <sqlite3.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Бюджет SQL-запросов на HTTP-запрос и детектор N+1.
+// Считает операторы, выполненные потоком за время обработки запроса, и повторы
+// одного и того же текста SQL (параметры привязываются через '?', поэтому запрос
+// в цикле по строкам дает один и тот же текст). Превышение пишется в stderr -
+// первый раз для каждого маршрута, дальше только считается. В сборке с
+// HOTELS_STRICT_QUERY_BUDGET превышение - исключение из фильтра ответа, которое Router
+// превращает в ошибку 500 (см. Router::fail), чтобы регрессия N+1 падала на тестовом
+// прогоне, а не доходила до продакшена.
+class QueryBudget {
+public:
+    struct Limits {
+        size_t max_queries = 0;  // всего операторов на запрос, 0 - без ограничения
+        size_t max_repeats = 0;  // повторов одного оператора, 0 - без ограничения
+    };
+
+    struct RouteStats {
+        std::atomic<uint64_t> over_total{0};
+        std::atomic<uint64_t> over_repeats{0};
+        std::atomic<uint64_t> peak_queries{0};
+        std::atomic<bool> reported{false};
+    };
+
+    // Итог запроса: ложь, если бюджет соблюден
+    struct Violation {
+        bool over_total = false;
+        bool over_repeats = false;
+        size_t queries = 0;
+        size_t repeats = 0;
+        std::string repeated_sql;
+
+        explicit operator bool() const {
+            return over_total || over_repeats;
+        }
+    };
+
+private:
+    struct Shape {
+        size_t hash;
+        size_t count;
+    };
+
+    struct ThreadState {
+        size_t queries = 0;
+        std::vector<Shape> shapes;
+        size_t worst_repeats = 0;
+        std::string worst_sql;
+    };
+
+    Limits limits;
+    std::vector<std::string> route_names;
+    std::unique_ptr<RouteStats[]> routes;
+
+    static ThreadState& state() {
+        static thread_local ThreadState instance;
+        return instance;
+    }
+
+    // Итоги запроса потока: обновляет счетчики маршрута
+    Violation evaluate(size_t route_id) {
+        ThreadState& current = state();
+        RouteStats& stats = routes[route_id < route_names.size() ? route_id : route_names.size()];
+        uint64_t peak = stats.peak_queries.load(std::memory_order_relaxed);
+        while (current.queries > peak && !stats.peak_queries.compare_exchange_weak(peak, current.queries, std::memory_order_relaxed)) {
+        }
+
+        Violation violation;
+        violation.queries = current.queries;
+        violation.repeats = current.worst_repeats;
+        if (limits.max_queries != 0 && current.queries > limits.max_queries) {
+            violation.over_total = true;
+            stats.over_total.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (limits.max_repeats != 0 && current.worst_repeats > limits.max_repeats) {
+            violation.over_repeats = true;
+            violation.repeated_sql = current.worst_sql;
+            stats.over_repeats.fetch_add(1, std::memory_order_relaxed);
+        }
+        return violation;
+    }
+
+    void report(const std::string& route_name, const Violation& violation) const {
+        Logger::warn("Query budget exceeded", {
+            {"route", route_name},
+            {"queries", violation.queries},
+            {"query_limit", limits.max_queries},
+            {"repeats", violation.repeats},
+            {"repeat_limit", limits.max_repeats},
+            {"repeated_sql", violation.repeated_sql}
+        });
+    }
+
+public:
+    explicit QueryBudget(Limits budget) : limits(budget) {}
+
+    QueryBudget(const QueryBudget&) = delete;
+    QueryBudget& operator=(const QueryBudget&) = delete;
+
+    // Имена маршрутов задаются один раз до запуска сервера; индекс = Route::id
+    void set_route_names(std::vector<std::string> names) {
+        route_names = std::move(names);
+        routes.reset(new RouteStats[route_names.size() + 1]);
+    }
+
+    void request_started() {
+        ThreadState& current = state();
+        current.queries = 0;
+        current.shapes.clear();
+        current.worst_repeats = 0;
+        current.worst_sql.clear();
+    }
+
+    // Вызывается из обработчика статистики SQLite
+    void record(sqlite3_stmt* stmt) {
+        ThreadState& current = state();
+        ++current.queries;
+        if (limits.max_repeats == 0) {
+            return;
+        }
+        const char* sql = sqlite3_sql(stmt);
+        size_t hash = std::hash<std::string_view>{}(sql ? std::string_view(sql) : std::string_view());
+        for (auto& shape : current.shapes) {
+            if (shape.hash == hash) {
+                ++shape.count;
+                // Текст сохраняется один раз - когда повторы впервые превышают лимит
+                if (shape.count == limits.max_repeats + 1 && current.worst_sql.empty() && sql) {
+                    current.worst_sql = sql;
+                }
+                if (shape.count > current.worst_repeats) {
+                    current.worst_repeats = shape.count;
+                }
+                return;
+            }
+        }
+        current.shapes.push_back({hash, 1});
+    }
+
+    // Проверяет бюджет по завершении запроса: сообщение в лог один раз на маршрут
+    // (каждый раз в строгой сборке)
+    void check(size_t route_id) {
+        Violation violation = evaluate(route_id);
+        if (!violation) {
+            return;
+        }
+        std::string route_name = route_id < route_names.size() ? route_names[route_id] : "other";
+#ifdef HOTELS_STRICT_QUERY_BUDGET
+        report(route_name, violation);
+        throw std::logic_error("Query budget exceeded on " + route_name);
+#else
+        RouteStats& stats = routes[route_id < route_names.size() ? route_id : route_names.size()];
+        if (!stats.reported.exchange(true, std::memory_order_relaxed)) {
+            report(route_name, violation);
+        }
+#endif
+    }
+
+    const Limits& get_limits() const {
+        return limits;
+    }
+
+    size_t route_count() const {
+        return route_names.size();
+    }
+
+    const std::string& get_route_name(size_t route_id) const {
+        return route_names.at(route_id);
+    }
+
+    const RouteStats& get_stats(size_t route_id) const {
+        return routes[route_id < route_names.size() ? route_id : route_names.size()];
+    }
+};
+
+#endif // QUERY_BUDGET_H
@@ -0,0 +1,268 @@
+#ifndef QUERY_PROFILER_H
+#define QUERY_PROFILER_H
+
+#include "models.h"
+#include "logger.h"
+#include <sqlite3.h>
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Профилировщик SQL-запросов (включается --profile-queries=1).
+// Запросы группируются по форме: литералы заменяются на '?', пробелы схлопываются.
+// Для каждой формы копятся число вызовов, время, строки результата и счетчики
+// sqlite3_stmt_status (шаги полного сканирования, сортировки, автоиндексы).
+// Запросы дольше порога пишутся в журнал медленных запросов вместе с
+// EXPLAIN QUERY PLAN, который выполняется на отдельном соединении только для чтения:
+// из обработчика трассировки нельзя готовить операторы на основном соединении.
+class QueryProfiler {
+public:
+    struct QueryStats {
+        std::string sql;
+        uint64_t calls = 0;
+        uint64_t total_ns = 0;
+        uint64_t max_ns = 0;
+        uint64_t rows = 0;
+        uint64_t fullscan_steps = 0;
+        uint64_t sorts = 0;
+        uint64_t autoindexes = 0;
+        uint64_t vm_steps = 0;
+        uint64_t slow = 0;
+    };
+
+    struct SlowQuery {
+        std::string time;
+        std::string sql;
+        uint64_t nanoseconds = 0;
+        uint64_t rows = 0;
+        uint64_t fullscan_steps = 0;
+        uint64_t sorts = 0;
+        std::string plan;
+    };
+
+    static constexpr size_t SLOW_LOG_SIZE = 100;
+
+private:
+    uint64_t slow_threshold_ns;
+    sqlite3* explain_db = nullptr;
+
+    std::mutex mutex;
+    std::unordered_map<std::string, QueryStats> queries;
+    std::deque<SlowQuery> slow_log;
+    std::mutex explain_mutex;
+    std::unordered_map<std::string, std::string> plans;
+
+    // Строки, возвращенные еще не завершенными операторами потока. Операторы могут
+    // перемежаться (цикл по одному запросу с вложенными), поэтому это список, а не одна пара.
+    static inline thread_local std::vector<std::pair<sqlite3_stmt*, uint64_t>> pending_rows;
+
+    static uint64_t take_rows(sqlite3_stmt* stmt) {
+        for (size_t i = 0; i < pending_rows.size(); ++i) {
+            if (pending_rows[i].first == stmt) {
+                uint64_t rows = pending_rows[i].second;
+                pending_rows[i] = pending_rows.back();
+                pending_rows.pop_back();
+                return rows;
+            }
+        }
+        return 0;
+    }
+
+    static bool is_identifier_char(char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    }
+
+    std::string explain(const std::string& sql) {
+        std::lock_guard<std::mutex> lock(explain_mutex);
+        auto cached = plans.find(sql);
+        if (cached != plans.end()) {
+            return cached->second;
+        }
+        std::string plan;
+        sqlite3_stmt* stmt = nullptr;
+        if (explain_db && sqlite3_prepare_v2(explain_db, ("EXPLAIN QUERY PLAN " + sql).c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
+            std::map<int, int> depth;
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                int id = sqlite3_column_int(stmt, 0);
+                int parent = sqlite3_column_int(stmt, 1);
+                const char* detail = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+                int level = depth.count(parent) ? depth[parent] + 1 : 0;
+                depth[id] = level;
+                if (!plan.empty()) plan += "\n";
+                plan += std::string(level * 2, ' ') + (detail ? detail : "");
+            }
+        } else {
+            plan = "план недоступен";
+        }
+        sqlite3_finalize(stmt);
+        plans.emplace(sql, plan);
+        return plan;
+    }
+
+public:
+    QueryProfiler(const std::string& db_path, std::chrono::milliseconds slow_threshold)
+        : slow_threshold_ns(static_cast<uint64_t>(slow_threshold.count()) * 1000000) {
+        if (sqlite3_open_v2(db_path.c_str(), &explain_db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+            Logger::warn("Query profiler: cannot open database for EXPLAIN", {{"path", db_path}, {"error", sqlite3_errmsg(explain_db)}});
+            sqlite3_close(explain_db);
+            explain_db = nullptr;
+        }
+    }
+
+    ~QueryProfiler() {
+        if (explain_db) {
+            sqlite3_close(explain_db);
+        }
+    }
+
+    QueryProfiler(const QueryProfiler&) = delete;
+    QueryProfiler& operator=(const QueryProfiler&) = delete;
+
+    // Форма запроса: строковые и числовые литералы заменены на '?', пробелы схлопнуты
+    static std::string normalize(const char* sql) {
+        std::string result;
+        if (!sql) {
+            return result;
+        }
+        bool space = false;
+        for (const char* p = sql; *p;) {
+            char c = *p;
+            if (std::isspace(static_cast<unsigned char>(c))) {
+                space = true;
+                ++p;
+                continue;
+            }
+            if (space && !result.empty()) {
+                result += ' ';
+            }
+            space = false;
+            if (c == '\'') {
+                ++p;
+                while (*p) {
+                    if (*p == '\'' && p[1] == '\'') {
+                        p += 2;
+                    } else if (*p == '\'') {
+                        ++p;
+                        break;
+                    } else {
+                        ++p;
+                    }
+                }
+                result += '?';
+            } else if (std::isdigit(static_cast<unsigned char>(c)) && (result.empty() || !is_identifier_char(result.back()))) {
+                while (*p && (is_identifier_char(*p) || *p == '.')) {
+                    ++p;
+                }
+                result += '?';
+            } else {
+                result += c;
+                ++p;
+            }
+        }
+        return result;
+    }
+
+    void on_row(sqlite3_stmt* stmt) {
+        for (auto& entry : pending_rows) {
+            if (entry.first == stmt) {
+                ++entry.second;
+                return;
+            }
+        }
+        pending_rows.emplace_back(stmt, 1);
+    }
+
+    // Вызывается по завершении оператора (SQLITE_TRACE_PROFILE)
+    void on_statement(sqlite3_stmt* stmt, uint64_t nanoseconds) {
+        uint64_t rows = take_rows(stmt);
+        // Сбрасываем счетчики: переиспользуемый оператор не должен копить их между выполнениями
+        uint64_t fullscan = static_cast<uint64_t>(sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 1));
+        uint64_t sorts = static_cast<uint64_t>(sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_SORT, 1));
+        uint64_t autoindexes = static_cast<uint64_t>(sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_AUTOINDEX, 1));
+        uint64_t vm_steps = static_cast<uint64_t>(sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_VM_STEP, 1));
+        std::string sql = normalize(sqlite3_sql(stmt));
+        bool is_slow = slow_threshold_ns != 0 && nanoseconds >= slow_threshold_ns;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            QueryStats& stats = queries[sql];
+            if (stats.calls == 0) {
+                stats.sql = sql;
+            }
+            ++stats.calls;
+            stats.total_ns += nanoseconds;
+            stats.max_ns = std::max(stats.max_ns, nanoseconds);
+            stats.rows += rows;
+            stats.fullscan_steps += fullscan;
+            stats.sorts += sorts;
+            stats.autoindexes += autoindexes;
+            stats.vm_steps += vm_steps;
+            if (is_slow) {
+                ++stats.slow;
+            }
+        }
+        if (!is_slow) {
+            return;
+        }
+
+        SlowQuery entry;
+        entry.time = get_current_datetime();
+        entry.sql = sql;
+        entry.nanoseconds = nanoseconds;
+        entry.rows = rows;
+        entry.fullscan_steps = fullscan;
+        entry.sorts = sorts;
+        entry.plan = explain(sql);
+
+        Logger::warn("Slow query", {
+            {"us", nanoseconds / 1000},
+            {"rows", rows},
+            {"fullscan_steps", fullscan},
+            {"sorts", sorts},
+            {"sql", sql},
+            {"plan", entry.plan}
+        });
+
+        std::lock_guard<std::mutex> lock(mutex);
+        slow_log.push_back(std::move(entry));
+        if (slow_log.size() > SLOW_LOG_SIZE) {
+            slow_log.pop_front();
+        }
+    }
+
+    // Формы запросов по убыванию суммарного времени
+    std::vector<QueryStats> get_queries() {
+        std::vector<QueryStats> result;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            result.reserve(queries.size());
+            for (const auto& entry : queries) {
+                result.push_back(entry.second);
+            }
+        }
+        std::sort(result.begin(), result.end(), [](const QueryStats& a, const QueryStats& b) {
+            return a.total_ns > b.total_ns;
+        });
+        return result;
+    }
+
+    // Последние медленные запросы, новые первыми
+    std::vector<SlowQuery> get_slow_log() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return std::vector<SlowQuery>(slow_log.rbegin(), slow_log.rend());
+    }
+
+    uint64_t slow_threshold_ms() const {
+        return slow_threshold_ns / 1000000;
+    }
+};
+
+#endif // QUERY_PROFILER_H
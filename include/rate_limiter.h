@@ -0,0 +1,247 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Ограничение частоты запросов по алгоритму token bucket.
+// Корзина заводится на пару (политика, клиент); запрос может списываться сразу с
+// нескольких корзин (IP-адрес и сессия) и проходит, только если токен есть в каждой,
+// так что новая сессия после повторного входа не обходит лимит адреса. Таблица корзин разбита на шарды со своими мьютексами, так что
+// клиенты почти не конкурируют за блокировки. Фоновый поток периодически удаляет
+// корзины, которые давно не использовались и успели наполниться до краев.
+class RateLimiter {
+public:
+    static constexpr size_t SHARD_COUNT = 16;
+
+    struct Policy {
+        std::string name;
+        double rate = 0;   // токенов в секунду
+        double burst = 0;  // емкость корзины
+    };
+
+    struct PolicyStats {
+        std::atomic<uint64_t> allowed{0};
+        std::atomic<uint64_t> limited{0};
+    };
+
+    // Разбирает "N/SEC" (N запросов за SEC секунд, всплеск до N); "0" - без ограничения
+    static Policy parse_policy(const std::string& name, const std::string& spec) {
+        Policy policy;
+        policy.name = name;
+        if (spec == "0") {
+            return policy;
+        }
+        size_t slash = spec.find('/');
+        try {
+            if (slash == std::string::npos) {
+                throw std::invalid_argument(spec);
+            }
+            size_t pos = 0;
+            double count = std::stod(spec.substr(0, slash), &pos);
+            if (pos != slash) throw std::invalid_argument(spec);
+            double seconds = std::stod(spec.substr(slash + 1), &pos);
+            if (pos != spec.size() - slash - 1) throw std::invalid_argument(spec);
+            if (count < 1 || seconds <= 0) throw std::invalid_argument(spec);
+            policy.rate = count / seconds;
+            policy.burst = count;
+        } catch (const std::exception&) {
+            throw std::runtime_error("Invalid rate limit for " + name + ": " + spec + " (expected N/SEC)");
+        }
+        return policy;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Bucket {
+        double tokens = 0;
+        Clock::time_point updated;
+        size_t policy_id = 0;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<std::string, Bucket> buckets;
+    };
+
+    std::deque<Policy> policies;
+    std::deque<PolicyStats> stats;
+    std::array<Shard, SHARD_COUNT> shards;
+
+    std::chrono::seconds sweep_interval;
+    std::thread sweeper;
+    std::mutex sweeper_mutex;
+    std::condition_variable sweeper_cond;
+    bool stopping = false;
+    std::atomic<uint64_t> swept{0};
+
+    static size_t shard_index(const std::string& key) {
+        return std::hash<std::string>{}(key) % SHARD_COUNT;
+    }
+
+    static void refill(Bucket& bucket, const Policy& policy, Clock::time_point now) {
+        double elapsed = std::chrono::duration<double>(now - bucket.updated).count();
+        bucket.tokens = std::min(policy.burst, bucket.tokens + elapsed * policy.rate);
+        bucket.updated = now;
+    }
+
+    void sweep_loop() {
+        std::unique_lock<std::mutex> lock(sweeper_mutex);
+        while (!sweeper_cond.wait_for(lock, sweep_interval, [this] { return stopping; })) {
+            lock.unlock();
+            sweep();
+            lock.lock();
+        }
+    }
+
+public:
+    explicit RateLimiter(std::chrono::seconds interval = std::chrono::seconds(60))
+        : sweep_interval(interval) {}
+
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    ~RateLimiter() {
+        stop();
+    }
+
+    // Политики регистрируются до запуска сервера; возвращает идентификатор политики
+    size_t add_policy(const Policy& policy) {
+        policies.push_back(policy);
+        stats.emplace_back();
+        return policies.size() - 1;
+    }
+
+    void start() {
+        if (!sweeper.joinable()) {
+            sweeper = std::thread([this] { sweep_loop(); });
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(sweeper_mutex);
+            stopping = true;
+        }
+        sweeper_cond.notify_all();
+        if (sweeper.joinable()) {
+            sweeper.join();
+        }
+    }
+
+    // Списывает по токену с корзины каждого клиента, если токены есть во всех; при отказе
+    // не списывается ничего, а retry_after - через сколько секунд появится следующий
+    bool allow(size_t policy_id, const std::vector<std::string>& clients, int& retry_after) {
+        const Policy& policy = policies.at(policy_id);
+        PolicyStats& counters = stats[policy_id];
+        if (policy.rate <= 0) {
+            counters.allowed.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        std::vector<std::string> keys;
+        std::vector<size_t> shard_ids;
+        keys.reserve(clients.size());
+        for (const auto& client : clients) {
+            keys.push_back(std::to_string(policy_id) + "|" + client);
+            shard_ids.push_back(shard_index(keys.back()));
+        }
+        // Шарды блокируются по возрастанию номера, чтобы два запроса не ждали друг друга
+        std::vector<size_t> order = shard_ids;
+        std::sort(order.begin(), order.end());
+        order.erase(std::unique(order.begin(), order.end()), order.end());
+        std::vector<std::unique_lock<std::mutex>> locks;
+        locks.reserve(order.size());
+        for (size_t id : order) {
+            locks.emplace_back(shards[id].mutex);
+        }
+
+        Clock::time_point now = Clock::now();
+        std::vector<Bucket*> buckets;
+        buckets.reserve(keys.size());
+        double lowest = policy.burst;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            auto inserted = shards[shard_ids[i]].buckets.try_emplace(keys[i], Bucket{policy.burst, now, policy_id});
+            Bucket& bucket = inserted.first->second;
+            if (!inserted.second) {
+                refill(bucket, policy, now);
+            }
+            buckets.push_back(&bucket);
+            lowest = std::min(lowest, bucket.tokens);
+        }
+        if (lowest >= 1) {
+            for (Bucket* bucket : buckets) {
+                bucket->tokens -= 1;
+            }
+            counters.allowed.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        retry_after = static_cast<int>(std::ceil((1 - lowest) / policy.rate));
+        if (retry_after < 1) retry_after = 1;
+        counters.limited.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Удаляет корзины, которые к текущему моменту снова полны: их состояние
+    // не отличается от только что созданной корзины
+    size_t sweep() {
+        Clock::time_point now = Clock::now();
+        size_t removed = 0;
+        for (auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (auto it = shard.buckets.begin(); it != shard.buckets.end();) {
+                const Policy& policy = policies[it->second.policy_id];
+                refill(it->second, policy, now);
+                if (it->second.tokens >= policy.burst) {
+                    it = shard.buckets.erase(it);
+                    ++removed;
+                } else {
+                    ++it;
+                }
+            }
+        }
+        swept.fetch_add(removed, std::memory_order_relaxed);
+        return removed;
+    }
+
+    size_t bucket_count() {
+        size_t count = 0;
+        for (auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            count += shard.buckets.size();
+        }
+        return count;
+    }
+
+    uint64_t swept_count() const {
+        return swept.load(std::memory_order_relaxed);
+    }
+
+    size_t policy_count() const {
+        return policies.size();
+    }
+
+    const Policy& get_policy(size_t policy_id) const {
+        return policies.at(policy_id);
+    }
+
+    const PolicyStats& get_stats(size_t policy_id) const {
+        return stats.at(policy_id);
+    }
+};
+
+#endif // RATE_LIMITER_H
@@ -0,0 +1,142 @@
+#ifndef REQUEST_ARENA_H
+#define REQUEST_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Счетчики выделений памяти в куче (глобальный operator new считает их
+// только при сборке с HOTELS_COUNT_ALLOCATIONS, см. main.cpp)
+namespace allocation_stats {
+    inline thread_local uint64_t heap_allocations = 0;
+}
+
+// Арена памяти на время одного запроса.
+// Монотонный ресурс: сначала расходуется буфер внутри объекта (он живет на стеке
+// рабочего потока), затем блоки берутся из кучи и освобождаются разом в деструкторе.
+// Активная арена потока доступна через current_resource(), поэтому Database и
+// HtmlGenerator используют её без передачи через параметры; вне запроса
+// возвращается обычный new/delete.
+class RequestArena {
+public:
+    static constexpr size_t INITIAL_BYTES = 32 * 1024;
+
+private:
+    // Upstream-ресурс, считающий блоки, которые арене пришлось взять из кучи
+    class CountingResource : public std::pmr::memory_resource {
+    public:
+        size_t allocations = 0;
+        size_t bytes = 0;
+
+    protected:
+        void* do_allocate(size_t size, size_t alignment) override {
+            ++allocations;
+            bytes += size;
+            return std::pmr::new_delete_resource()->allocate(size, alignment);
+        }
+
+        void do_deallocate(void* p, size_t size, size_t alignment) override {
+            std::pmr::new_delete_resource()->deallocate(p, size, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    };
+
+    alignas(std::max_align_t) std::byte initial[INITIAL_BYTES];
+    CountingResource upstream;
+    std::pmr::monotonic_buffer_resource resource;
+    RequestArena* previous;
+
+    static inline thread_local RequestArena* active = nullptr;
+
+public:
+    RequestArena()
+        : resource(initial, sizeof(initial), &upstream), previous(active) {
+        active = this;
+    }
+
+    ~RequestArena() {
+        active = previous;
+    }
+
+    RequestArena(const RequestArena&) = delete;
+    RequestArena& operator=(const RequestArena&) = delete;
+
+    std::pmr::memory_resource* get() {
+        return &resource;
+    }
+
+    // Сколько блоков и байт арена взяла из кучи сверх начального буфера
+    size_t upstream_allocations() const {
+        return upstream.allocations;
+    }
+
+    size_t upstream_bytes() const {
+        return upstream.bytes;
+    }
+
+    static std::pmr::memory_resource* current_resource() {
+        return active ? active->get() : std::pmr::new_delete_resource();
+    }
+};
+
+// Результаты списочных запросов: вектор в арене текущего запроса
+template <typename T>
+using ArenaVector = std::pmr::vector<T>;
+
+// Результаты пакетной выборки по ключу (см. Database::get_guests_by_ids)
+template <typename K, typename V>
+using ArenaMap = std::pmr::unordered_map<K, V>;
+
+// std::ostream поверх std::pmr::string в арене запроса.
+// Заменяет std::ostringstream при сборке HTML: рост буфера не трогает кучу,
+// а готовую страницу можно отдать как string_view без копии.
+class HtmlStream : public std::ostream {
+private:
+    class Buffer : public std::streambuf {
+    public:
+        std::pmr::string data;
+
+        explicit Buffer(std::pmr::memory_resource* resource) : data(resource) {}
+
+    protected:
+        int_type overflow(int_type ch) override {
+            if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+                data.push_back(traits_type::to_char_type(ch));
+            }
+            return traits_type::not_eof(ch);
+        }
+
+        std::streamsize xsputn(const char* s, std::streamsize n) override {
+            data.append(s, static_cast<size_t>(n));
+            return n;
+        }
+    };
+
+    Buffer buffer;
+
+public:
+    explicit HtmlStream(size_t reserve = 4096)
+        : std::ostream(nullptr), buffer(RequestArena::current_resource()) {
+        buffer.data.reserve(reserve);
+        rdbuf(&buffer);
+    }
+
+    std::string_view view() const {
+        return buffer.data;
+    }
+
+    std::string str() const {
+        return std::string(buffer.data);
+    }
+};
+
+#endif // REQUEST_ARENA_H
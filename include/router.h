@@ -0,0 +1,356 @@
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include "models.h"
+#include "request_arena.h"
+#include "admission.h"
+#include "tracing.h"
+#include "logger.h"
+#include "../deps/httplib.h"
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Уровень доступа к маршруту, проверяется middleware до вызова обработчика
+enum class Access {
+    Public,        // сессия разбирается, но вход не обязателен
+    Static,        // статические файлы: без сессии и проверок
+    User,          // нужен вход, иначе редирект на /login/
+    Organization,  // нужен вход под организацией
+    Local          // служебные страницы, только с loopback-адреса
+};
+
+struct Route;
+
+// Контекст запроса: заполняется один раз цепочкой middleware
+// и передается обработчику вместе с разобранными параметрами пути
+struct RequestContext {
+    const Route* route = nullptr;
+    std::chrono::steady_clock::time_point started_at;
+    std::vector<int64_t> params;  // целочисленные параметры пути по порядку
+    std::string session_token;
+    int64_t user_id = 0;
+    User user;
+    AdmissionControl::Ticket admission;  // слот admission control до конца запроса
+
+    int64_t param(size_t index) const {
+        return index < params.size() ? params[index] : 0;
+    }
+
+    bool is_authenticated() const {
+        return user_id != 0;
+    }
+
+    // Принадлежит ли ресурс организации текущего пользователя
+    bool owns(int64_t organization_id) const {
+        return user_id != 0 && organization_id == user_id;
+    }
+};
+
+struct Route {
+    using Handler = std::function<void(RequestContext&, const httplib::Request&, httplib::Response&)>;
+
+    size_t id = 0;  // порядковый номер регистрации, индекс для метрик
+    std::string method;
+    std::string pattern;  // например "/rooms/{id}/edit/"
+    Access access = Access::Public;
+    Cost cost = Cost::Light;
+    Handler handler;
+};
+
+// Диспетчер маршрутов на префиксном дереве сегментов пути.
+// Сегмент "{name}" захватывает целое число; литеральные сегменты имеют приоритет.
+// Последний сегмент "*" принимает любой непустой остаток пути (обработчик разбирает req.path).
+// Маршруты компилируются при регистрации, поэтому на запрос нет ни одного регулярного выражения.
+class Router {
+public:
+    using Middleware = std::function<bool(RequestContext&, const httplib::Request&, httplib::Response&)>;
+    // Вызывается после обработки каждого найденного маршрута, в том числе отклоненного middleware
+    using Observer = std::function<void(const RequestContext&, const httplib::Request&, const httplib::Response&)>;
+    // Преобразует готовый ответ (например, сжимает тело); выполняется перед наблюдателями
+    using Filter = std::function<void(const RequestContext&, const httplib::Request&, httplib::Response&)>;
+
+private:
+    struct Node {
+        std::vector<std::pair<std::string, std::unique_ptr<Node>>> literals;
+        std::unique_ptr<Node> capture;
+        std::unique_ptr<Node> tail;        // "*" - остаток пути
+        std::vector<const Route*> routes;  // по одному на метод
+    };
+
+    Node root;
+    std::vector<std::unique_ptr<Route>> routes;
+    std::vector<Middleware> middlewares;
+    std::vector<Observer> observers;
+    std::vector<Filter> filters;
+
+    static std::vector<std::string> split_pattern(const std::string& pattern) {
+        std::vector<std::string> segments;
+        size_t start = 1;
+        while (start <= pattern.size()) {
+            size_t end = pattern.find('/', start);
+            if (end == std::string::npos) {
+                end = pattern.size();
+            }
+            segments.push_back(pattern.substr(start, end - start));
+            start = end + 1;
+        }
+        return segments;
+    }
+
+    static bool parse_int(std::string_view segment, int64_t& value) {
+        if (segment.empty() || segment.size() > 18) return false;
+        value = 0;
+        for (char c : segment) {
+            if (c < '0' || c > '9') return false;
+            value = value * 10 + (c - '0');
+        }
+        return true;
+    }
+
+    Node* insert(const std::string& pattern) {
+        if (pattern.empty() || pattern[0] != '/') {
+            throw std::invalid_argument("Route pattern must start with '/': " + pattern);
+        }
+        Node* node = &root;
+        std::vector<std::string> segments = split_pattern(pattern);
+        for (size_t i = 0; i < segments.size(); ++i) {
+            const std::string& segment = segments[i];
+            if (segment == "*") {
+                if (i + 1 != segments.size()) {
+                    throw std::invalid_argument("'*' must be the last segment of a route pattern: " + pattern);
+                }
+                if (!node->tail) {
+                    node->tail = std::make_unique<Node>();
+                }
+                node = node->tail.get();
+                continue;
+            }
+            if (segment.size() > 2 && segment.front() == '{' && segment.back() == '}') {
+                if (!node->capture) {
+                    node->capture = std::make_unique<Node>();
+                }
+                node = node->capture.get();
+                continue;
+            }
+            Node* next = nullptr;
+            for (auto& literal : node->literals) {
+                if (literal.first == segment) {
+                    next = literal.second.get();
+                    break;
+                }
+            }
+            if (!next) {
+                node->literals.emplace_back(segment, std::make_unique<Node>());
+                next = node->literals.back().second.get();
+            }
+            node = next;
+        }
+        return node;
+    }
+
+    // Спуск по дереву; при неудаче литеральной ветки пробуется захват числа
+    const Route* match(const Node* node, std::string_view path, const std::string& method, std::vector<int64_t>& params) const {
+        if (path.empty()) {
+            for (const Route* route : node->routes) {
+                if (route->method == method) {
+                    return route;
+                }
+            }
+            return nullptr;
+        }
+        // path начинается с '/'
+        size_t end = path.find('/', 1);
+        std::string_view segment = path.substr(1, end == std::string_view::npos ? std::string_view::npos : end - 1);
+        std::string_view rest = end == std::string_view::npos ? std::string_view() : path.substr(end);
+
+        for (const auto& literal : node->literals) {
+            if (literal.first == segment) {
+                if (const Route* route = match(literal.second.get(), rest, method, params)) {
+                    return route;
+                }
+                break;
+            }
+        }
+        int64_t value = 0;
+        if (node->capture && parse_int(segment, value)) {
+            params.push_back(value);
+            if (const Route* route = match(node->capture.get(), rest, method, params)) {
+                return route;
+            }
+            params.pop_back();
+        }
+        if (node->tail && !segment.empty()) {
+            return match(node->tail.get(), std::string_view(), method, params);
+        }
+        return nullptr;
+    }
+
+    // Исключение из middleware, обработчика или фильтра: недописанный ответ заменяется на 500,
+    // а остальные фильтры и наблюдатели (метрики, сжатие) все равно выполняются
+    static void fail(const RequestContext& ctx, const httplib::Request& req, httplib::Response& res, const char* what) {
+        Logger::error("Unhandled exception in request", {
+            {"method", req.method},
+            {"route", ctx.route->pattern},
+            {"path", req.path},
+            {"error", what}
+        });
+        res = httplib::Response();
+        res.status = 500;
+        res.set_content("Internal Server Error", "text/plain; charset=utf-8");
+    }
+
+    template <typename F>
+    static void guarded(const RequestContext& ctx, const httplib::Request& req, httplib::Response& res, F&& f) {
+        try {
+            f();
+        } catch (const std::exception& e) {
+            fail(ctx, req, res, e.what());
+        } catch (...) {
+            fail(ctx, req, res, "unknown exception");
+        }
+    }
+
+public:
+    Router() = default;
+    Router(const Router&) = delete;
+    Router& operator=(const Router&) = delete;
+
+    void use(Middleware middleware) {
+        middlewares.push_back(std::move(middleware));
+    }
+
+    void observe(Observer observer) {
+        observers.push_back(std::move(observer));
+    }
+
+    void filter(Filter response_filter) {
+        filters.push_back(std::move(response_filter));
+    }
+
+    const Route& add(const std::string& method, const std::string& pattern, Access access, Cost cost, Route::Handler handler) {
+        auto route = std::make_unique<Route>();
+        route->id = routes.size();
+        route->method = method;
+        route->pattern = pattern;
+        route->access = access;
+        route->cost = cost;
+        route->handler = std::move(handler);
+        Node* node = insert(pattern);
+        for (const Route* existing : node->routes) {
+            if (existing->method == method) {
+                throw std::invalid_argument("Duplicate route: " + method + " " + pattern);
+            }
+        }
+        node->routes.push_back(route.get());
+        routes.push_back(std::move(route));
+        return *routes.back();
+    }
+
+    const Route& get(const std::string& pattern, Access access, Route::Handler handler) {
+        return add("GET", pattern, access, Cost::Light, std::move(handler));
+    }
+
+    const Route& get(const std::string& pattern, Access access, Cost cost, Route::Handler handler) {
+        return add("GET", pattern, access, cost, std::move(handler));
+    }
+
+    const Route& post(const std::string& pattern, Access access, Route::Handler handler) {
+        return add("POST", pattern, access, Cost::Light, std::move(handler));
+    }
+
+    const Route& post(const std::string& pattern, Access access, Cost cost, Route::Handler handler) {
+        return add("POST", pattern, access, cost, std::move(handler));
+    }
+
+    // Зарегистрированный маршрут по методу и шаблону; nullptr, если его нет
+    const Route* route(const std::string& method, const std::string& pattern) const {
+        for (const auto& r : routes) {
+            if (r->method == method && r->pattern == pattern) {
+                return r.get();
+            }
+        }
+        return nullptr;
+    }
+
+    const std::vector<std::unique_ptr<Route>>& all_routes() const {
+        return routes;
+    }
+
+    void run(RequestContext& ctx, const httplib::Request& req, httplib::Response& res) const {
+        for (const auto& middleware : middlewares) {
+            if (!middleware(ctx, req, res)) {
+                return;
+            }
+        }
+        TraceSpan span("handler", "router");
+        ctx.route->handler(ctx, req, res);
+    }
+
+    // Находит маршрут и заполняет параметры пути; nullptr, если маршрута нет
+    const Route* find(const std::string& method, const std::string& path, std::vector<int64_t>& params) const {
+        params.clear();
+        return match(&root, path, method == "HEAD" ? "GET" : method, params);
+    }
+
+    // Возвращает false, если маршрут не найден (ответ тогда формирует httplib)
+    // Все временные данные обработчика (строки списков, буферы HTML) живут в арене запроса
+    bool dispatch(const httplib::Request& req, httplib::Response& res) const {
+#ifdef HOTELS_COUNT_ALLOCATIONS
+        uint64_t heap_before = allocation_stats::heap_allocations;
+#endif
+        RequestArena arena;
+        RequestContext ctx;
+        ctx.started_at = std::chrono::steady_clock::now();
+        ctx.route = find(req.method, req.path, ctx.params);
+        if (!ctx.route) {
+            return false;
+        }
+        guarded(ctx, req, res, [&] { run(ctx, req, res); });
+        for (const auto& response_filter : filters) {
+            guarded(ctx, req, res, [&] { response_filter(ctx, req, res); });
+        }
+        // Ответ уже готов: ошибка наблюдателя только пишется в лог и не мешает остальным
+        for (const auto& observer : observers) {
+            try {
+                observer(ctx, req, res);
+            } catch (const std::exception& e) {
+                Logger::error("Request observer failed", {{"route", ctx.route->pattern}, {"error", e.what()}});
+            }
+        }
+#ifdef HOTELS_COUNT_ALLOCATIONS
+        Logger::info("Allocations", {
+            {"method", req.method},
+            {"path", req.path},
+            {"heap", allocation_stats::heap_allocations - heap_before},
+            {"arena_chunks", arena.upstream_allocations()},
+            {"arena_bytes", arena.upstream_bytes()}
+        });
+#endif
+        return true;
+    }
+
+    // Подключение к httplib: GET/HEAD обрабатываются в pre-routing без регулярных выражений,
+    // а для POST тело читается только после pre-routing, поэтому используется единственный
+    // обработчик-заглушка, передающий запрос в дерево.
+    void attach(httplib::Server& svr) const {
+        svr.set_pre_routing_handler([this](const httplib::Request& req, httplib::Response& res) {
+            if (req.method != "GET" && req.method != "HEAD") {
+                return httplib::Server::HandlerResponse::Unhandled;
+            }
+            return dispatch(req, res) ? httplib::Server::HandlerResponse::Handled
+                                      : httplib::Server::HandlerResponse::Unhandled;
+        });
+        svr.Post(".*", [this](const httplib::Request& req, httplib::Response& res) {
+            if (!dispatch(req, res)) {
+                res.status = 404;
+            }
+        });
+    }
+};
+
+#endif // ROUTER_H
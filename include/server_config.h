@@ -0,0 +1,291 @@
+#ifndef SERVER_CONFIG_H
+#define SERVER_CONFIG_H
+
+#include "logger.h"
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+// Настройки HTTP-сервера и базы данных.
+// Источники по возрастанию приоритета: значения по умолчанию, файл конфигурации
+// (строки "ключ = значение", # - комментарий), переменные окружения HOTELS_<КЛЮЧ>,
+// аргументы командной строки --ключ=значение.
+struct ServerConfig {
+    std::string host = "0.0.0.0";
+    int port = 8080;
+    std::string db_path = "hotels.db";
+
+    size_t threads = 0;             // 0 - по числу ядер
+    size_t max_queued = 0;          // 0 - threads * 64; больше - соединение отклоняется
+    size_t keep_alive_max_count = 100;
+    time_t keep_alive_timeout = 5;  // секунды
+    time_t read_timeout = 5;
+    time_t write_timeout = 5;
+    size_t payload_max_length = 1024 * 1024;
+
+    // Admission control (см. admission.h)
+    size_t heavy_max_concurrent = 0;  // 0 - половина рабочих потоков
+    size_t heavy_queue_deadline_ms = 1000;
+    size_t queue_deadline_ms = 5000;  // для легких страниц
+    int retry_after = 2;              // секунды в ответе 503
+
+    // Ограничение частоты записи: "N/SEC" на клиента (сессию или IP), "0" - выключено
+    std::string rate_login = "10/60";
+    std::string rate_register = "5/300";
+    std::string rate_booking = "20/60";
+    std::string rate_guest = "30/60";
+
+    // Профилировщик SQL (см. query_profiler.h)
+    bool profile_queries = false;
+    size_t slow_query_ms = 100;  // 0 - журнал медленных запросов выключен
+
+    // Бюджет SQL на HTTP-запрос (см. query_budget.h), 0 - без ограничения
+    size_t query_budget = 40;
+    size_t query_repeat_budget = 5;
+
+    // Трассировка: каждый N-й запрос потока пишется для /admin/trace/, 0 - выключена
+    size_t trace_sample = 100;
+
+    std::string log_level = "info";  // debug, info, warn, error
+
+    // Каталог статических файлов для /static/ (см. static_assets.h)
+    std::string static_dir = "static";
+
+    // Сжатие ответов (см. compression.h): уровень zlib 1-9, 0 - выключено
+    size_t gzip_level = 6;
+    size_t gzip_min_size = 1024;  // меньшие ответы отдаются без сжатия
+
+    // Журнал изменений (см. change_feed.h): одновременных long-poll и SSE, 0 - четверть рабочих потоков
+    size_t change_waiters = 0;
+    // Срок хранения журнала в днях: старые записи удаляются при запуске, 0 - хранить все
+    size_t change_retention_days = 30;
+
+    // Разовое обслуживание: объединить гостей с одинаковым паспортом и выйти (см. Database::merge_duplicate_guests)
+    bool merge_guests = false;
+
+    std::string config_file;
+
+    static const char* usage() {
+        return "Параметры (файл, HOTELS_<КЛЮЧ> или --ключ=значение):\n"
+               "  --config=PATH               файл конфигурации\n"
+               "  --host=ADDR                 адрес (0.0.0.0)\n"
+               "  --port=N                    порт (8080)\n"
+               "  --db=PATH                   файл базы данных (hotels.db)\n"
+               "  --threads=N                 рабочие потоки (0 - по числу ядер)\n"
+               "  --max-queued=N              длина очереди соединений (0 - threads * 64)\n"
+               "  --keep-alive-max-count=N    запросов на одно соединение (100)\n"
+               "  --keep-alive-timeout=SEC    ожидание следующего запроса (5)\n"
+               "  --read-timeout=SEC          таймаут чтения (5)\n"
+               "  --write-timeout=SEC         таймаут записи (5)\n"
+               "  --payload-max-length=BYTES  максимальный размер тела запроса (1048576)\n"
+               "  --heavy-max-concurrent=N    одновременных тяжелых запросов (0 - threads / 2)\n"
+               "  --heavy-queue-deadline-ms=N срок ожидания в очереди для тяжелых страниц (1000)\n"
+               "  --queue-deadline-ms=N       срок ожидания в очереди для остальных (5000)\n"
+               "  --retry-after=SEC           Retry-After в ответе 503 (2)\n"
+               "  --rate-login=N/SEC          POST /login/ на клиента (10/60)\n"
+               "  --rate-register=N/SEC       POST /register/ (5/300)\n"
+               "  --rate-booking=N/SEC        POST /bookings/create/ (20/60)\n"
+               "  --rate-guest=N/SEC          POST /guests/create/ (30/60)\n"
+               "  --profile-queries=0|1       профилировщик SQL, /admin/queries/ (0)\n"
+               "  --slow-query-ms=N           порог журнала медленных запросов (100, 0 - выключен)\n"
+               "  --query-budget=N            SQL-операторов на запрос (40, 0 - без ограничения)\n"
+               "  --query-repeat-budget=N     повторов одного оператора на запрос (5)\n"
+               "  --trace-sample=N            трассировать каждый N-й запрос, /admin/trace/ (100, 0 - выключено)\n"
+               "  --log-level=LEVEL           debug, info, warn или error (info)\n"
+               "  --static-dir=PATH           каталог статических файлов (static)\n"
+               "  --gzip-level=N              уровень сжатия ответов 1-9 (6, 0 - выключено)\n"
+               "  --gzip-min-size=BYTES       не сжимать ответы меньше (1024)\n"
+               "  --change-waiters=N          одновременных подписчиков /api/v1/changes/ (0 - threads / 4)\n"
+               "  --change-retention-days=N   хранить журнал изменений N дней (30, 0 - без очистки)\n"
+               "  --merge-guests=1            объединить гостей с одинаковым паспортом и выйти\n";
+    }
+
+    // Число рабочих потоков с учетом автоопределения
+    size_t worker_threads() const {
+        if (threads != 0) {
+            return threads;
+        }
+        size_t cores = std::thread::hardware_concurrency();
+        return cores != 0 ? cores : 4;
+    }
+
+    size_t heavy_concurrency() const {
+        if (heavy_max_concurrent != 0) {
+            return heavy_max_concurrent;
+        }
+        size_t half = worker_threads() / 2;
+        return half != 0 ? half : 1;
+    }
+
+    size_t change_waiter_limit() const {
+        if (change_waiters != 0) {
+            return change_waiters;
+        }
+        size_t quarter = worker_threads() / 4;
+        return quarter != 0 ? quarter : 1;
+    }
+
+    size_t queue_capacity() const {
+        return max_queued != 0 ? max_queued : worker_threads() * 64;
+    }
+
+    // Применяет одну настройку; ключи пишутся через '-' или '_'
+    void set(std::string key, const std::string& value) {
+        for (char& c : key) {
+            if (c == '_') c = '-';
+            else c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        if (key == "host") host = value;
+        else if (key == "port") port = static_cast<int>(parse_number(key, value, 1, 65535));
+        else if (key == "db") db_path = value;
+        else if (key == "threads") threads = parse_number(key, value, 0, 1024);
+        else if (key == "max-queued") max_queued = parse_number(key, value, 0, 1000000);
+        else if (key == "keep-alive-max-count") keep_alive_max_count = parse_number(key, value, 1, 1000000);
+        else if (key == "keep-alive-timeout") keep_alive_timeout = static_cast<time_t>(parse_number(key, value, 0, 3600));
+        else if (key == "read-timeout") read_timeout = static_cast<time_t>(parse_number(key, value, 1, 3600));
+        else if (key == "write-timeout") write_timeout = static_cast<time_t>(parse_number(key, value, 1, 3600));
+        else if (key == "payload-max-length") payload_max_length = parse_number(key, value, 1, std::numeric_limits<size_t>::max());
+        else if (key == "heavy-max-concurrent") heavy_max_concurrent = parse_number(key, value, 0, 1024);
+        else if (key == "heavy-queue-deadline-ms") heavy_queue_deadline_ms = parse_number(key, value, 0, 3600000);
+        else if (key == "queue-deadline-ms") queue_deadline_ms = parse_number(key, value, 0, 3600000);
+        else if (key == "retry-after") retry_after = static_cast<int>(parse_number(key, value, 1, 3600));
+        else if (key == "rate-login") rate_login = value;
+        else if (key == "rate-register") rate_register = value;
+        else if (key == "rate-booking") rate_booking = value;
+        else if (key == "rate-guest") rate_guest = value;
+        else if (key == "profile-queries") profile_queries = parse_number(key, value, 0, 1) != 0;
+        else if (key == "slow-query-ms") slow_query_ms = parse_number(key, value, 0, 3600000);
+        else if (key == "query-budget") query_budget = parse_number(key, value, 0, 1000000);
+        else if (key == "query-repeat-budget") query_repeat_budget = parse_number(key, value, 0, 1000000);
+        else if (key == "trace-sample") trace_sample = parse_number(key, value, 0, 1000000);
+        else if (key == "static-dir") static_dir = value;
+        else if (key == "gzip-level") gzip_level = parse_number(key, value, 0, 9);
+        else if (key == "gzip-min-size") gzip_min_size = parse_number(key, value, 0, 1 << 30);
+        else if (key == "change-waiters") change_waiters = parse_number(key, value, 0, 1024);
+        else if (key == "change-retention-days") change_retention_days = parse_number(key, value, 0, 36500);
+        else if (key == "merge-guests") merge_guests = parse_number(key, value, 0, 1) != 0;
+        else if (key == "log-level") {
+            Logger::parse_level(value);  // проверка значения
+            log_level = value;
+        }
+        else if (key == "config") config_file = value;
+        else throw std::runtime_error("Unknown option: " + key);
+    }
+
+    void load_file(const std::string& path) {
+        std::ifstream file(path);
+        if (!file) {
+            throw std::runtime_error("Cannot open config file: " + path);
+        }
+        std::string line;
+        int line_number = 0;
+        while (std::getline(file, line)) {
+            ++line_number;
+            size_t comment = line.find('#');
+            if (comment != std::string::npos) {
+                line.erase(comment);
+            }
+            line = trim(line);
+            if (line.empty()) {
+                continue;
+            }
+            size_t eq = line.find('=');
+            if (eq == std::string::npos) {
+                throw std::runtime_error(path + ":" + std::to_string(line_number) + ": expected key = value");
+            }
+            set(trim(line.substr(0, eq)), trim(line.substr(eq + 1)));
+        }
+    }
+
+    // Ключи берутся из usage(), поэтому новый параметр сразу доступен и как HOTELS_<КЛЮЧ>
+    // (--config читается отдельно в load как HOTELS_CONFIG)
+    void load_env() {
+        std::string text = usage();
+        for (size_t pos = text.find("\n  --"); pos != std::string::npos; pos = text.find("\n  --", pos + 1)) {
+            size_t begin = pos + 5;
+            size_t end = text.find('=', begin);
+            std::string key = text.substr(begin, end - begin);
+            if (key == "config") {
+                continue;
+            }
+            std::string name = "HOTELS_";
+            for (char c : key) {
+                name += c == '-' ? '_' : static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+            }
+            if (const char* value = std::getenv(name.c_str())) {
+                set(key, value);
+            }
+        }
+    }
+
+    // Собирает конфигурацию из всех источников. Возвращает false, если запрошена справка.
+    static bool load(int argc, char** argv, ServerConfig& config) {
+        std::string config_path;
+        if (const char* env = std::getenv("HOTELS_CONFIG")) {
+            config_path = env;
+        }
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg.rfind("--config=", 0) == 0) {
+                config_path = arg.substr(9);
+            } else if (arg == "--config" && i + 1 < argc) {
+                config_path = argv[i + 1];
+            }
+        }
+        if (!config_path.empty()) {
+            config.load_file(config_path);
+            config.config_file = config_path;
+        }
+        config.load_env();
+
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h") {
+                std::cout << usage();
+                return false;
+            }
+            if (arg.rfind("--", 0) != 0) {
+                throw std::runtime_error("Unexpected argument: " + arg);
+            }
+            size_t eq = arg.find('=');
+            if (eq == std::string::npos) {
+                if (i + 1 >= argc) {
+                    throw std::runtime_error("Missing value for " + arg);
+                }
+                config.set(arg.substr(2), argv[++i]);
+            } else {
+                config.set(arg.substr(2, eq - 2), arg.substr(eq + 1));
+            }
+        }
+        return true;
+    }
+
+private:
+    static std::string trim(const std::string& s) {
+        size_t start = s.find_first_not_of(" \t\r\n");
+        if (start == std::string::npos) return "";
+        size_t end = s.find_last_not_of(" \t\r\n");
+        return s.substr(start, end - start + 1);
+    }
+
+    static size_t parse_number(const std::string& key, const std::string& value, size_t min, size_t max) {
+        size_t pos = 0;
+        unsigned long long number = 0;
+        try {
+            number = std::stoull(value, &pos);
+        } catch (...) {
+            pos = 0;
+        }
+        if (pos == 0 || pos != value.size() || value[0] == '-' || number < min || number > max) {
+            throw std::runtime_error("Invalid value for " + key + ": " + value);
+        }
+        return static_cast<size_t>(number);
+    }
+};
+
+#endif // SERVER_CONFIG_H
@@ -0,0 +1,205 @@
+#ifndef SESSION_STORE_H
+#define SESSION_STORE_H
+
+#include "models.h"
+#include "database.h"
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+// Серверное хранилище сессий.
+// В cookie лежит только непрозрачный случайный токен, а соответствие токен -> пользователь
+// хранится в памяти (таблица разбита на шарды со своими мьютексами) и, при желании, в SQLite,
+// чтобы сессии переживали перезапуск сервера. В записи сессии кэшируется User,
+// поэтому авторизованные запросы не обращаются к таблице users.
+class SessionStore {
+public:
+    static constexpr size_t SHARD_COUNT = 16;
+    static constexpr size_t TOKEN_BYTES = 32;
+
+private:
+    struct Entry {
+        int64_t user_id = 0;
+        int64_t expires_at = 0;  // unix time, секунды
+        bool user_loaded = false;
+        User user;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<std::string, Entry> sessions;
+    };
+
+    Database& db;
+    std::chrono::seconds ttl;
+    bool persistent;
+    std::array<Shard, SHARD_COUNT> shards;
+
+    static int64_t now_seconds() {
+        return std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    Shard& shard_for(const std::string& token) {
+        return shards[std::hash<std::string>{}(token) % SHARD_COUNT];
+    }
+
+    static std::string generate_token() {
+        static const char* hex = "0123456789abcdef";
+        std::random_device rd;
+        std::string token;
+        token.reserve(TOKEN_BYTES * 2);
+        for (size_t i = 0; i < TOKEN_BYTES; i += 4) {
+            uint32_t value = rd();
+            for (int b = 0; b < 4; ++b) {
+                unsigned char byte = static_cast<unsigned char>(value >> (b * 8));
+                token += hex[byte >> 4];
+                token += hex[byte & 0x0F];
+            }
+        }
+        return token;
+    }
+
+    static bool is_valid_token(const std::string& token) {
+        if (token.size() != TOKEN_BYTES * 2) return false;
+        for (char c : token) {
+            if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) return false;
+        }
+        return true;
+    }
+
+    // Находит живую запись сессии; при промахе подгружает её из SQLite.
+    // Вызывается под мьютексом шарда.
+    Entry* find_locked(Shard& shard, const std::string& token, int64_t now) {
+        auto it = shard.sessions.find(token);
+        if (it != shard.sessions.end()) {
+            if (it->second.expires_at > now) {
+                return &it->second;
+            }
+            shard.sessions.erase(it);
+            if (persistent) {
+                db.delete_session(token);
+            }
+            return nullptr;
+        }
+        if (!persistent) {
+            return nullptr;
+        }
+        int64_t user_id = 0;
+        int64_t expires_at = 0;
+        if (!db.get_session(token, user_id, expires_at) || expires_at <= now) {
+            return nullptr;
+        }
+        Entry& entry = shard.sessions[token];
+        entry.user_id = user_id;
+        entry.expires_at = expires_at;
+        return &entry;
+    }
+
+public:
+    SessionStore(Database& database, std::chrono::seconds session_ttl = std::chrono::hours(24 * 7), bool persist = true)
+        : db(database), ttl(session_ttl), persistent(persist) {
+        db.add_user_listener([this](int64_t user_id) { invalidate_user(user_id); });
+        if (persistent) {
+            db.delete_expired_sessions(now_seconds());
+        }
+    }
+
+    SessionStore(const SessionStore&) = delete;
+    SessionStore& operator=(const SessionStore&) = delete;
+
+    std::chrono::seconds get_ttl() const {
+        return ttl;
+    }
+
+    // Создает новую сессию и возвращает её токен
+    std::string create(int64_t user_id) {
+        std::string token = generate_token();
+        int64_t expires_at = now_seconds() + ttl.count();
+        if (persistent) {
+            db.create_session(token, user_id, expires_at);
+        }
+        Shard& shard = shard_for(token);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        Entry& entry = shard.sessions[token];
+        entry.user_id = user_id;
+        entry.expires_at = expires_at;
+        return token;
+    }
+
+    // ID пользователя по токену или 0, если сессии нет или она истекла
+    int64_t get_user_id(const std::string& token) {
+        if (!is_valid_token(token)) return 0;
+        Shard& shard = shard_for(token);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        Entry* entry = find_locked(shard, token, now_seconds());
+        return entry ? entry->user_id : 0;
+    }
+
+    // Пользователь по токену; запись users читается только при первом обращении к сессии
+    User get_user(const std::string& token) {
+        if (!is_valid_token(token)) return User();
+        Shard& shard = shard_for(token);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        Entry* entry = find_locked(shard, token, now_seconds());
+        if (!entry) {
+            return User();
+        }
+        if (!entry->user_loaded) {
+            entry->user = db.get_user(entry->user_id);
+            entry->user_loaded = true;
+        }
+        return entry->user;
+    }
+
+    void destroy(const std::string& token) {
+        if (!is_valid_token(token)) return;
+        Shard& shard = shard_for(token);
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.sessions.erase(token);
+        }
+        if (persistent) {
+            db.delete_session(token);
+        }
+    }
+
+    // Сбрасывает закэшированного пользователя во всех его сессиях
+    void invalidate_user(int64_t user_id) {
+        for (auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (auto& item : shard.sessions) {
+                if (item.second.user_id == user_id) {
+                    item.second.user_loaded = false;
+                    item.second.user = User();
+                }
+            }
+        }
+    }
+
+    // Удаляет истекшие сессии из памяти и из базы
+    size_t purge_expired() {
+        int64_t now = now_seconds();
+        size_t removed = 0;
+        for (auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (auto it = shard.sessions.begin(); it != shard.sessions.end();) {
+                if (it->second.expires_at <= now) {
+                    it = shard.sessions.erase(it);
+                    ++removed;
+                } else {
+                    ++it;
+                }
+            }
+        }
+        if (persistent) {
+            db.delete_expired_sessions(now);
+        }
+        return removed;
+    }
+};
+
+#endif // SESSION_STORE_H
@@ -0,0 +1,270 @@
+#ifndef STATIC_ASSETS_H
+#define STATIC_ASSETS_H
+
+#include "compression.h"
+#include "logger.h"
+#include "../deps/httplib.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Статические файлы (Bootstrap, иконки) из локального каталога вместо CDN.
+// Все файлы читаются в память при запуске; к имени добавляется хеш содержимого
+// (css/bootstrap.min.3f2a9c0d1e.css), поэтому такой URL можно кэшировать навсегда:
+// новая версия файла получит новый URL. Для текстовых файлов заранее готовится
+// gzip-вариант (или берется лежащий рядом file.gz). Ссылки url(...) внутри CSS
+// переписываются на хешированные URL шрифтов и картинок.
+// Ответ отдается из памяти через content provider, без копирования в тело ответа.
+class StaticAssets {
+public:
+    static constexpr const char* URL_PREFIX = "/static/";
+
+    struct Asset {
+        std::string path;          // относительно каталога: "css/bootstrap.min.css"
+        std::string url;           // "/static/css/bootstrap.min.<hash>.css"
+        std::string content_type;
+        std::string hash;          // хеш содержимого, он же ETag ("<hash>" или "<hash>-gz")
+        std::string body;
+        std::string gzip;          // пусто, если сжатие не дает выигрыша
+    };
+
+private:
+    std::vector<std::unique_ptr<Asset>> assets;
+    std::unordered_map<std::string, const Asset*> by_path;  // путь после /static/: логический и с хешем
+
+    static uint64_t fnv1a(std::string_view data) {
+        uint64_t hash = 1469598103934665603ull;
+        for (unsigned char c : data) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    static std::string hex(uint64_t value) {
+        char text[17];
+        std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(value));
+        return text;
+    }
+
+    static std::string content_type_for(const std::string& path) {
+        std::string ext = std::filesystem::path(path).extension().string();
+        if (ext == ".css") return "text/css; charset=utf-8";
+        if (ext == ".js") return "application/javascript; charset=utf-8";
+        if (ext == ".json" || ext == ".map") return "application/json";
+        if (ext == ".svg") return "image/svg+xml";
+        if (ext == ".woff2") return "font/woff2";
+        if (ext == ".woff") return "font/woff";
+        if (ext == ".ttf") return "font/ttf";
+        if (ext == ".png") return "image/png";
+        if (ext == ".jpg" || ext == ".jpeg") return "image/jpeg";
+        if (ext == ".ico") return "image/x-icon";
+        if (ext == ".txt") return "text/plain; charset=utf-8";
+        return "application/octet-stream";
+    }
+
+    static bool compressible(const std::string& content_type) {
+        return content_type.rfind("text/", 0) == 0 || content_type.rfind("application/javascript", 0) == 0 ||
+               content_type.rfind("application/json", 0) == 0 || content_type.rfind("image/svg", 0) == 0;
+    }
+
+    static std::string read_file(const std::filesystem::path& file) {
+        std::ifstream in(file, std::ios::binary);
+        if (!in) {
+            throw std::runtime_error("Cannot read static file: " + file.string());
+        }
+        std::ostringstream data;
+        data << in.rdbuf();
+        return data.str();
+    }
+
+    // "a/b/../c/./d" -> "a/c/d"; false, если путь выходит за пределы каталога
+    static bool normalize(const std::string& path, std::string& result) {
+        std::vector<std::string> parts;
+        size_t start = 0;
+        while (start <= path.size()) {
+            size_t end = path.find('/', start);
+            if (end == std::string::npos) end = path.size();
+            std::string part = path.substr(start, end - start);
+            start = end + 1;
+            if (part.empty() || part == ".") continue;
+            if (part == "..") {
+                if (parts.empty()) return false;
+                parts.pop_back();
+                continue;
+            }
+            parts.push_back(part);
+        }
+        result.clear();
+        for (const auto& part : parts) {
+            if (!result.empty()) result += '/';
+            result += part;
+        }
+        return true;
+    }
+
+    // Переписывает url(...) в CSS на хешированные URL уже загруженных файлов
+    std::string rewrite_css(const std::string& css_path, const std::string& css) const {
+        std::string dir = css_path.substr(0, css_path.rfind('/') == std::string::npos ? 0 : css_path.rfind('/') + 1);
+        std::string out;
+        out.reserve(css.size());
+        size_t pos = 0;
+        for (;;) {
+            size_t open = css.find("url(", pos);
+            size_t close = open == std::string::npos ? open : css.find(')', open);
+            if (close == std::string::npos) {
+                out.append(css, pos, std::string::npos);
+                return out;
+            }
+            std::string ref = css.substr(open + 4, close - open - 4);
+            ref.erase(0, ref.find_first_not_of(" \t\"'"));
+            ref.erase(ref.find_last_not_of(" \t\"'") + 1);
+            std::string target;
+            const Asset* asset = nullptr;
+            if (ref.rfind("data:", 0) != 0 && ref.find("://") == std::string::npos && !ref.empty() && ref[0] != '/' &&
+                normalize(dir + ref.substr(0, ref.find_first_of("?#")), target)) {
+                auto it = by_path.find(target);
+                asset = it == by_path.end() ? nullptr : it->second;
+            }
+            out.append(css, pos, open - pos);
+            if (asset) {
+                out += "url(\"" + asset->url + "\")";
+            } else {
+                out.append(css, open, close + 1 - open);
+            }
+            pos = close + 1;
+        }
+    }
+
+    void add(const std::filesystem::path& dir, const std::string& path, std::string body) {
+        auto asset = std::make_unique<Asset>();
+        asset->path = path;
+        asset->content_type = content_type_for(path);
+        if (asset->content_type.rfind("text/css", 0) == 0) {
+            body = rewrite_css(path, body);
+        }
+        asset->body = std::move(body);
+        asset->hash = hex(fnv1a(asset->body));
+
+        std::string ext = std::filesystem::path(path).extension().string();
+        std::string stem = path.substr(0, path.size() - ext.size());
+        asset->url = URL_PREFIX + stem + "." + asset->hash.substr(0, 10) + ext;
+
+        if (compressible(asset->content_type)) {
+            std::filesystem::path precompressed = dir / (path + ".gz");
+            if (ext != ".css" && std::filesystem::exists(precompressed)) {
+                asset->gzip = read_file(precompressed);  // CSS переписан, готовый .gz к нему не подходит
+            } else {
+                GzipStream stream(ContentEncoding::Gzip, Z_BEST_COMPRESSION, [&asset](const char* data, size_t size) {
+                    asset->gzip.append(data, size);
+                    return true;
+                });
+                stream.write(asset->body);
+                stream.finish();
+            }
+            if (asset->gzip.size() >= asset->body.size()) {
+                asset->gzip.clear();
+            }
+        }
+        by_path[asset->path] = asset.get();
+        by_path[asset->url.substr(std::char_traits<char>::length(URL_PREFIX))] = asset.get();
+        assets.push_back(std::move(asset));
+    }
+
+    // Совпадение по хешу подходит для обоих вариантов ETag (обычного и gzip)
+    static bool etag_matches(const std::string& header, const std::string& hash) {
+        return header == "*" || header.find(hash) != std::string::npos;
+    }
+
+public:
+    StaticAssets() = default;
+    StaticAssets(const StaticAssets&) = delete;
+    StaticAssets& operator=(const StaticAssets&) = delete;
+
+    // Загружает каталог целиком; отсутствующий каталог - не ошибка (ссылки останутся на CDN)
+    size_t load(const std::string& directory) {
+        std::filesystem::path dir(directory);
+        if (!std::filesystem::is_directory(dir)) {
+            return 0;
+        }
+        std::vector<std::string> css;
+        std::vector<std::string> other;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(dir)) {
+            if (!entry.is_regular_file() || entry.path().extension() == ".gz") {
+                continue;
+            }
+            std::string path = std::filesystem::relative(entry.path(), dir).generic_string();
+            (entry.path().extension() == ".css" ? css : other).push_back(path);
+        }
+        // CSS - последними: их содержимое (и хеш) зависит от URL шрифтов
+        std::sort(other.begin(), other.end());
+        std::sort(css.begin(), css.end());
+        for (const auto& path : other) {
+            add(dir, path, read_file(dir / path));
+        }
+        for (const auto& path : css) {
+            add(dir, path, read_file(dir / path));
+        }
+        return assets.size();
+    }
+
+    // Хешированный URL файла; fallback, если файла нет
+    std::string url(std::string_view path, std::string_view fallback) const {
+        auto it = by_path.find(std::string(path));
+        if (it == by_path.end()) {
+            Logger::warn("Static file not found, using fallback URL", {{"path", path}, {"url", fallback}});
+            return std::string(fallback);
+        }
+        return it->second->url;
+    }
+
+    const std::vector<std::unique_ptr<Asset>>& all() const {
+        return assets;
+    }
+
+    // Отдает файл по req.path; false - файла нет
+    bool serve(const httplib::Request& req, httplib::Response& res) const {
+        std::string_view path(req.path);
+        std::string_view prefix(URL_PREFIX);
+        if (path.substr(0, prefix.size()) != prefix) {
+            return false;
+        }
+        auto it = by_path.find(std::string(path.substr(prefix.size())));
+        if (it == by_path.end()) {
+            return false;
+        }
+        const Asset& asset = *it->second;
+        bool hashed = req.path == asset.url;
+        // По хешированному URL содержимое не меняется никогда; по логическому - проверять каждый раз
+        res.set_header("Cache-Control", hashed ? "public, max-age=31536000, immutable" : "no-cache");
+        bool gzip = !asset.gzip.empty() && req.has_header("Accept-Encoding") &&
+                    Compression::accepts(req.get_header_value("Accept-Encoding"), "gzip");
+        res.set_header("ETag", "\"" + asset.hash + (gzip ? "-gz\"" : "\""));
+        if (!asset.gzip.empty()) {
+            res.set_header("Vary", "Accept-Encoding");
+        }
+        if (req.has_header("If-None-Match") && etag_matches(req.get_header_value("If-None-Match"), asset.hash)) {
+            res.status = 304;
+            return true;
+        }
+        const std::string* body = &asset.body;
+        if (gzip) {
+            body = &asset.gzip;
+            res.set_header("Content-Encoding", "gzip");
+        }
+        res.set_content_provider(body->size(), asset.content_type, [body](size_t offset, size_t length, httplib::DataSink& sink) {
+            return sink.write(body->data() + offset, length);
+        });
+        return true;
+    }
+};
+
+#endif // STATIC_ASSETS_H
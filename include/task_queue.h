@@ -0,0 +1,133 @@
+#ifndef TASK_QUEUE_H
+#define TASK_QUEUE_H
+
+#include "../deps/httplib.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Счетчики очереди соединений. Живут отдельно от самой очереди: httplib
+// создает и удаляет TaskQueue внутри listen(), а страница /admin/server/ читает их.
+struct TaskQueueStats {
+    size_t threads = 0;
+    size_t capacity = 0;
+    std::atomic<size_t> depth{0};       // соединений ждут свободного потока
+    std::atomic<size_t> peak_depth{0};
+    std::atomic<size_t> active{0};      // потоков обслуживают соединение
+    std::atomic<uint64_t> accepted{0};
+    std::atomic<uint64_t> rejected{0};  // очередь была полна, соединение закрыто
+    std::atomic<uint64_t> completed{0};
+};
+
+// Пул рабочих потоков с ограниченной очередью для httplib::Server::new_task_queue.
+// Когда очередь заполнена, enqueue возвращает false и httplib сразу закрывает
+// соединение, вместо того чтобы копить его в неограниченной очереди ThreadPool.
+class BoundedTaskQueue : public httplib::TaskQueue {
+private:
+    struct Job {
+        std::function<void()> fn;
+        std::chrono::steady_clock::time_point enqueued_at;
+    };
+
+    std::deque<Job> jobs;
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool shutting_down = false;
+    std::vector<std::thread> workers;
+    std::shared_ptr<TaskQueueStats> stats;
+
+    // Сколько текущее соединение ждало потока; отдается первому запросу соединения
+    static inline thread_local std::chrono::steady_clock::duration pending_wait{};
+
+    void worker() {
+        for (;;) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [this] { return shutting_down || !jobs.empty(); });
+                if (jobs.empty()) {
+                    return;  // shutting_down и работы больше нет
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+                stats->depth.store(jobs.size(), std::memory_order_relaxed);
+            }
+            pending_wait = std::chrono::steady_clock::now() - job.enqueued_at;
+            stats->active.fetch_add(1, std::memory_order_relaxed);
+            job.fn();
+            pending_wait = {};
+            stats->active.fetch_sub(1, std::memory_order_relaxed);
+            stats->completed.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+public:
+    BoundedTaskQueue(size_t thread_count, size_t capacity, std::shared_ptr<TaskQueueStats> queue_stats)
+        : stats(std::move(queue_stats)) {
+        stats->threads = thread_count;
+        stats->capacity = capacity;
+        workers.reserve(thread_count);
+        for (size_t i = 0; i < thread_count; ++i) {
+            workers.emplace_back([this] { worker(); });
+        }
+    }
+
+    BoundedTaskQueue(const BoundedTaskQueue&) = delete;
+    BoundedTaskQueue& operator=(const BoundedTaskQueue&) = delete;
+
+    ~BoundedTaskQueue() override {
+        shutdown();
+    }
+
+    bool enqueue(std::function<void()> fn) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (shutting_down || jobs.size() >= stats->capacity) {
+                stats->rejected.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            jobs.push_back(Job{std::move(fn), std::chrono::steady_clock::now()});
+            size_t depth = jobs.size();
+            stats->depth.store(depth, std::memory_order_relaxed);
+            if (depth > stats->peak_depth.load(std::memory_order_relaxed)) {
+                stats->peak_depth.store(depth, std::memory_order_relaxed);
+            }
+        }
+        stats->accepted.fetch_add(1, std::memory_order_relaxed);
+        cond.notify_one();
+        return true;
+    }
+
+    // Время ожидания в очереди для запроса на текущем потоке. Ненулевое только у
+    // первого запроса соединения: следующие keep-alive запросы очередь не проходят.
+    static std::chrono::steady_clock::duration take_queue_wait() {
+        auto wait = pending_wait;
+        pending_wait = {};
+        return wait;
+    }
+
+    void shutdown() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (shutting_down) {
+                return;
+            }
+            shutting_down = true;
+        }
+        cond.notify_all();
+        for (auto& thread : workers) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+    }
+};
+
+#endif // TASK_QUEUE_H
@@ -0,0 +1,316 @@
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Трассировка выборки запросов с выгрузкой в формате Chrome trace_event
+// (chrome://tracing, Perfetto). Трассируется каждый N-й запрос потока; у остальных
+// TraceSpan сводится к чтению thread_local указателя. События пишутся в кольцевой
+// буфер своего потока без выделения памяти: имена - строковые литералы или
+// долгоживущие строки (шаблоны маршрутов), подробности копируются в поле фиксированной длины.
+class Tracer {
+public:
+    static constexpr size_t RING_SIZE = 4096;
+    static constexpr size_t DETAIL_SIZE = 96;
+
+    struct Event {
+        uint64_t request = 0;
+        uint64_t start_ns = 0;
+        uint64_t duration_ns = 0;
+        const char* name = "";
+        const char* category = "";
+        char detail[DETAIL_SIZE] = {};
+    };
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Ring {
+        std::mutex mutex;
+        std::unique_ptr<Event[]> events{new Event[RING_SIZE]};
+        size_t next = 0;
+        size_t size = 0;
+        uint32_t thread_index = 0;
+    };
+
+    // Состояние потока. Инициализируется константами, поэтому thread_local без
+    // защиты от повторной инициализации и проверка active - одно чтение.
+    struct ThreadState {
+        Tracer* active;            // трассируемый сейчас запрос, иначе nullptr
+        const Tracer* owner;
+        Ring* ring;
+        uint64_t request;
+        uint64_t request_start_ns;
+        uint64_t handler_end_ns;
+        const char* request_name;
+        char request_label[DETAIL_SIZE];
+        uint64_t counter;
+    };
+
+    static ThreadState& state() {
+        static thread_local ThreadState instance{};
+        return instance;
+    }
+
+    uint64_t sample_every;
+    Clock::time_point epoch = Clock::now();
+    std::atomic<uint64_t> next_request{1};
+    std::atomic<uint64_t> sampled{0};
+    std::mutex rings_mutex;
+    std::vector<std::unique_ptr<Ring>> rings;
+
+    Ring& ring(ThreadState& s) {
+        if (s.owner != this) {
+            auto created = std::make_unique<Ring>();
+            s.ring = created.get();
+            s.owner = this;
+            std::lock_guard<std::mutex> lock(rings_mutex);
+            created->thread_index = static_cast<uint32_t>(rings.size() + 1);
+            rings.push_back(std::move(created));
+        }
+        return *s.ring;
+    }
+
+    static void copy_detail(char* target, std::string_view text) {
+        size_t length = std::min(text.size(), DETAIL_SIZE - 1);
+        std::memcpy(target, text.data(), length);
+        target[length] = '\0';
+    }
+
+    static void append_json_string(std::string& out, const char* text) {
+        out += '"';
+        for (const char* p = text; *p; ++p) {
+            unsigned char c = static_cast<unsigned char>(*p);
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += static_cast<char>(c);
+            } else if (c < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            } else {
+                out += static_cast<char>(c);
+            }
+        }
+        out += '"';
+    }
+
+    static void append_microseconds(std::string& out, uint64_t nanoseconds) {
+        char number[32];
+        std::snprintf(number, sizeof(number), "%.3f", nanoseconds / 1000.0);
+        out += number;
+    }
+
+public:
+    // sample_every: трассируется каждый N-й запрос потока, 0 - трассировка выключена
+    explicit Tracer(uint64_t every) : sample_every(every) {}
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    ~Tracer() {
+        ThreadState& s = state();
+        if (s.owner == this) {
+            s.active = nullptr;
+            s.owner = nullptr;
+            s.ring = nullptr;
+        }
+    }
+
+    // Трассировщик текущего запроса потока или nullptr, если запрос не в выборке
+    static Tracer* current() {
+        return state().active;
+    }
+
+    uint64_t now_ns() const {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch).count());
+    }
+
+    // name должен жить дольше трассировщика (шаблон маршрута)
+    void begin_request(const char* name, std::string_view method, std::string_view path, Clock::time_point started_at) {
+        ThreadState& s = state();
+        s.active = nullptr;
+        if (sample_every == 0 || ++s.counter % sample_every != 0) {
+            return;
+        }
+        ring(s);
+        s.active = this;
+        s.request = next_request.fetch_add(1, std::memory_order_relaxed);
+        s.request_start_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(started_at - epoch).count());
+        s.handler_end_ns = 0;
+        s.request_name = name;
+        size_t length = std::min(method.size(), DETAIL_SIZE - 2);
+        std::memcpy(s.request_label, method.data(), length);
+        s.request_label[length] = ' ';
+        copy_detail(s.request_label + length + 1, path.substr(0, DETAIL_SIZE - length - 2));
+        sampled.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void record(const char* name, const char* category, uint64_t start_ns, uint64_t end_ns, std::string_view detail = {}) {
+        ThreadState& s = state();
+        Ring& r = *s.ring;
+        std::lock_guard<std::mutex> lock(r.mutex);
+        Event& event = r.events[r.next];
+        event.request = s.request;
+        event.start_ns = start_ns;
+        event.duration_ns = end_ns > start_ns ? end_ns - start_ns : 0;
+        event.name = name;
+        event.category = category;
+        copy_detail(event.detail, detail);
+        r.next = (r.next + 1) % RING_SIZE;
+        r.size = std::min(r.size + 1, RING_SIZE);
+    }
+
+    // Обработчик маршрута завершен; дальше - запись ответа в сокет
+    void handler_finished() {
+        ThreadState& s = state();
+        if (s.active == this) {
+            s.handler_end_ns = now_ns();
+        }
+    }
+
+    // Вызывается из логгера httplib, то есть после записи ответа
+    void end_request() {
+        ThreadState& s = state();
+        if (s.active != this) {
+            return;
+        }
+        uint64_t end = now_ns();
+        if (s.handler_end_ns != 0) {
+            record("write", "http", s.handler_end_ns, end);
+        }
+        // Корневое событие пишется последним: запрос без него еще не завершен
+        record(s.request_name, "request", s.request_start_ns, end, s.request_label);
+        s.active = nullptr;
+    }
+
+    uint64_t sampled_count() const {
+        return sampled.load(std::memory_order_relaxed);
+    }
+
+    uint64_t sample_rate() const {
+        return sample_every;
+    }
+
+    // Последние max_requests завершенных запросов в формате Chrome trace_event (JSON).
+    // Текст отдается в write частями по ~16 КБ; false из write прерывает выгрузку.
+    void write_chrome_json(size_t max_requests, const std::function<bool(std::string_view)>& write) {
+        struct Collected {
+            Event event;
+            uint32_t thread_index;
+        };
+        std::vector<Collected> events;
+        std::set<uint64_t> finished;
+        std::vector<uint32_t> threads;
+        {
+            std::lock_guard<std::mutex> rings_lock(rings_mutex);
+            for (const auto& r : rings) {
+                std::lock_guard<std::mutex> lock(r->mutex);
+                threads.push_back(r->thread_index);
+                size_t first = (r->next + RING_SIZE - r->size) % RING_SIZE;
+                for (size_t i = 0; i < r->size; ++i) {
+                    const Event& event = r->events[(first + i) % RING_SIZE];
+                    events.push_back({event, r->thread_index});
+                    if (std::strcmp(event.category, "request") == 0) {
+                        finished.insert(event.request);
+                    }
+                }
+            }
+        }
+        while (finished.size() > max_requests) {
+            finished.erase(finished.begin());
+        }
+
+        constexpr size_t FLUSH_SIZE = 16 * 1024;
+        std::string out;
+        out.reserve(FLUSH_SIZE + 512);
+        out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        for (uint32_t thread : threads) {
+            if (!first) out += ',';
+            first = false;
+            out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(thread) +
+                   ",\"args\":{\"name\":\"worker " + std::to_string(thread) + "\"}}";
+        }
+        for (const auto& item : events) {
+            const Event& event = item.event;
+            if (finished.count(event.request) == 0) {
+                continue;
+            }
+            if (!first) out += ',';
+            first = false;
+            out += "{\"name\":";
+            append_json_string(out, event.name);
+            out += ",\"cat\":";
+            append_json_string(out, event.category);
+            out += ",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(item.thread_index) + ",\"ts\":";
+            append_microseconds(out, event.start_ns);
+            out += ",\"dur\":";
+            append_microseconds(out, event.duration_ns);
+            out += ",\"args\":{\"request\":" + std::to_string(event.request);
+            if (event.detail[0] != '\0') {
+                out += ",\"detail\":";
+                append_json_string(out, event.detail);
+            }
+            out += "}}";
+            if (out.size() >= FLUSH_SIZE) {
+                if (!write(out)) {
+                    return;
+                }
+                out.clear();
+            }
+        }
+        out += "]}";
+        write(out);
+    }
+
+    std::string chrome_json(size_t max_requests) {
+        std::string json;
+        write_chrome_json(max_requests, [&json](std::string_view part) {
+            json += part;
+            return true;
+        });
+        return json;
+    }
+};
+
+// Интервал трассировки: от создания до выхода из области видимости.
+// Вне выборки не делает ничего, кроме проверки Tracer::current().
+class TraceSpan {
+private:
+    Tracer* tracer;
+    const char* name;
+    const char* category;
+    uint64_t start_ns = 0;
+
+public:
+    TraceSpan(const char* span_name, const char* span_category)
+        : tracer(Tracer::current()), name(span_name), category(span_category) {
+        if (tracer) {
+            start_ns = tracer->now_ns();
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    ~TraceSpan() {
+        if (tracer) {
+            tracer->record(name, category, start_ns, tracer->now_ns());
+        }
+    }
+};
+
+#endif // TRACING_H
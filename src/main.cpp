@@ -1,6 +1,23 @@
 #include "../include/models.h"
 #include "../include/database.h"
 #include "../include/html_generator.h"
+#include "../include/session_store.h"
+#include "../include/router.h"
+#include "../include/server_config.h"
+#include "../include/task_queue.h"
+#include "../include/rate_limiter.h"
+#include "../include/metrics.h"
+#include "../include/query_profiler.h"
+#include "../include/query_budget.h"
+#include "../include/tracing.h"
+#include "../include/logger.h"
+#include "../include/compression.h"
+#include "../include/static_assets.h"
+#include "../include/conditional_get.h"
+#include "../include/json_generator.h"
+#include "../include/json_reader.h"
+#include "../include/change_feed.h"
+#include <unordered_map>
 #include "../deps/httplib.h"
 #include <iostream>
 #include <sstream>
@@ -8,9 +25,33 @@
 #include <algorithm>
 #include <ctime>
 #include <cmath>
+#include <charconv>
+#include <limits>
 
 using namespace httplib;
 
+#ifdef HOTELS_COUNT_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+
+// Подсчет выделений в куче для сравнения с ареной запроса (см. Router::dispatch)
+void* operator new(std::size_t size) {
+    ++allocation_stats::heap_allocations;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+#endif
+
 std::map<std::string, std::string> parse_form_data(const std::string& body) {
     std::map<std::string, std::string> params;
     std::istringstream iss(body);
@@ -85,74 +126,482 @@ bool date_less(const std::string& date1, const std::string& date2) {
 }
 
 // Функции для работы с сессиями
-int64_t get_user_id_from_session(const Request& req) {
+std::string get_session_token(const Request& req) {
     if (req.has_header("Cookie")) {
         std::string cookies = req.get_header_value("Cookie");
-        size_t pos = cookies.find("user_id=");
-        if (pos != std::string::npos) {
-            size_t start = pos + 8; // "user_id=" length
-            size_t end = cookies.find(";", start);
-            if (end == std::string::npos) {
-                end = cookies.length();
-            }
-            std::string user_id_str = cookies.substr(start, end - start);
-            try {
-                return std::stoll(user_id_str);
-            } catch (...) {
-                return 0;
+        size_t pos = 0;
+        while ((pos = cookies.find("session=", pos)) != std::string::npos) {
+            if (pos == 0 || cookies[pos - 1] == ' ' || cookies[pos - 1] == ';') {
+                size_t start = pos + 8; // "session=" length
+                size_t end = cookies.find(";", start);
+                if (end == std::string::npos) {
+                    end = cookies.length();
+                }
+                return cookies.substr(start, end - start);
             }
+            pos += 8;
         }
     }
-    return 0;
+    return "";
+}
+
+void set_user_session(SessionStore& sessions, Response& res, int64_t user_id) {
+    std::string token = sessions.create(user_id);
+    res.set_header("Set-Cookie", "session=" + token + "; Path=/; HttpOnly; SameSite=Lax; Max-Age=" + std::to_string(sessions.get_ttl().count()));
+}
+
+void clear_user_session(SessionStore& sessions, const Request& req, Response& res) {
+    std::string token = get_session_token(req);
+    if (!token.empty()) {
+        sessions.destroy(token);
+    }
+    res.set_header("Set-Cookie", "session=; Path=/; HttpOnly; Expires=Thu, 01 Jan 1970 00:00:00 GMT");
+}
+
+const char* HTML_CONTENT_TYPE = "text/html; charset=utf-8";
+
+void redirect(Response& res, const std::string& location) {
+    res.set_header("Location", location);
+    res.status = 302;
+}
+
+// Служебные страницы доступны только с той же машины
+bool is_loopback(const std::string& addr) {
+    return addr == "127.0.0.1" || addr == "::1" || addr == "::ffff:127.0.0.1" || addr.rfind("127.", 0) == 0;
+}
+
+void render_error(Response& res, const std::string& message, const User* user) {
+    res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>" + message + "</div>", "", user), HTML_CONTENT_TYPE);
+}
+
+const char* JSON_CONTENT_TYPE = "application/json; charset=utf-8";
+
+bool is_api_request(const Request& req) {
+    return req.path.rfind("/api/", 0) == 0;
+}
+
+void render_json_error(Response& res, int status, const std::string& message) {
+    res.status = status;
+    res.set_content(JsonGenerator::error(message), JSON_CONTENT_TYPE);
+}
+
+// Целое из всей строки без исключений; false - не число
+bool parse_int(const std::string& text, int64_t& value) {
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+// Число гостей из формы: меньше minimum поднимается до minimum; false - не число
+bool parse_guest_count(const std::string& text, int minimum, int& value) {
+    int64_t count = 0;
+    if (!parse_int(text, count) || count > std::numeric_limits<int>::max()) {
+        return false;
+    }
+    value = static_cast<int>(std::max<int64_t>(count, minimum));
+    return true;
+}
+
+// Целое из параметра запроса; отсутствующий параметр оставляет value как есть
+bool parse_int_param(const Request& req, const char* name, int64_t& value) {
+    if (!req.has_param(name)) {
+        return true;
+    }
+    int64_t parsed = 0;
+    if (!parse_int(req.get_param_value(name), parsed) || parsed < 0) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+// ?after=&limit= для списков API; false - ответ с ошибкой 400 уже готов
+bool parse_api_page(const Request& req, Response& res, JsonGenerator::Page& page) {
+    int64_t limit = static_cast<int64_t>(page.limit);
+    if (!parse_int_param(req, "after", page.after) || !parse_int_param(req, "limit", limit) || limit == 0) {
+        render_json_error(res, 400, "after and limit must be non-negative integers, limit > 0");
+        return false;
+    }
+    page.limit = std::min(static_cast<size_t>(limit), JsonGenerator::Page::MAX_LIMIT);
+    return true;
+}
+
+// Событие SSE; многострочные данные передаются несколькими строками data:
+std::string sse_event(int64_t id, std::string_view event, std::string_view data) {
+    std::string out = "id: " + std::to_string(id) + "\nevent: ";
+    out.append(event.data(), event.size());
+    out += '\n';
+    size_t start = 0;
+    for (;;) {
+        size_t end = data.find('\n', start);
+        out += "data: ";
+        out.append(data.data() + start, (end == std::string_view::npos ? data.size() : end) - start);
+        out += '\n';
+        if (end == std::string_view::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+    out += '\n';
+    return out;
 }
 
-void set_user_session(Response& res, int64_t user_id) {
-    res.set_header("Set-Cookie", "user_id=" + std::to_string(user_id) + "; Path=/; HttpOnly");
+// Курсор журнала для потока SSE: при переподключении браузер присылает Last-Event-ID,
+// он важнее ?since= из исходного URL
+bool parse_event_cursor(const Request& req, int64_t& since) {
+    if (!parse_int_param(req, "since", since)) {
+        return false;
+    }
+    if (req.has_header("Last-Event-ID")) {
+        std::string id = req.get_header_value("Last-Event-ID");
+        std::from_chars(id.data(), id.data() + id.size(), since);
+    }
+    return true;
 }
 
-void clear_user_session(Response& res) {
-    res.set_header("Set-Cookie", "user_id=; Path=/; HttpOnly; Expires=Thu, 01 Jan 1970 00:00:00 GMT");
+// Поток SSE по журналу изменений. fetch(cursor) - записи после курсора, render - текст
+// событий для записи (пусто - запись подписчика не касается). Пока изменений нет,
+// поток спит в ChangeFeed::wait и раз в 15 с шлет комментарий, чтобы прокси не закрыли
+// соединение. lease - место ожидания; освобождается вместе с ответом.
+void stream_changes(Response& res, ChangeFeed& feed, std::shared_ptr<void> lease, int64_t since,
+                    std::function<ArenaVector<Change>(int64_t)> fetch, std::function<std::string(const Change&)> render) {
+    struct Stream {
+        int64_t cursor;
+        bool started = false;
+    };
+    auto stream = std::make_shared<Stream>(Stream{since});
+    res.set_header("Cache-Control", "no-store");
+    res.set_header("X-Accel-Buffering", "no");
+    res.set_chunked_content_provider("text/event-stream", [&feed, lease, stream, fetch, render](size_t, DataSink& sink) {
+        std::string out;
+        if (!stream->started) {
+            stream->started = true;
+            out += "retry: 3000\n\n";
+        }
+        int64_t seen = feed.last();
+        auto rows = fetch(stream->cursor);
+        for (const auto& change : rows) {
+            out += render(change);
+            stream->cursor = change.seq;
+        }
+        if (out.empty()) {
+            // Вся страница отброшена render, но курсор продвинулся: за ним могут ждать
+            // непрочитанные записи, поэтому следующая страница читается сразу, без ожидания
+            if (!rows.empty()) {
+                return true;
+            }
+            if (feed.wait(seen, std::chrono::seconds(15))) {
+                return true;
+            }
+            if (feed.is_stopped()) {
+                sink.done();
+                return true;
+            }
+            out += ": keepalive\n\n";
+        }
+        return sink.write(out.data(), out.size());
+    });
 }
 
-int main() {
+const size_t MAX_AVAILABILITY_QUERIES = 1000;
+
+// Тело пакетной проверки доступности:
+// {"queries": [{"room_id": 1, "check_in": "2030-01-01", "check_out": "2030-01-05"}, [2, "2030-01-01", "2030-01-03"], ...]}
+// Запрос - объект или компактный массив [room_id, check_in, check_out]. Ошибка - std::runtime_error.
+std::vector<AvailabilityQuery> parse_availability_queries(const std::string& body) {
+    std::vector<AvailabilityQuery> queries;
+    JsonReader reader(body);
+    std::string key;
+    reader.begin_object();
+    while (reader.next_key(key)) {
+        if (key != "queries") {
+            reader.skip();
+            continue;
+        }
+        reader.begin_array();
+        while (reader.next_element()) {
+            if (queries.size() == MAX_AVAILABILITY_QUERIES) {
+                throw std::runtime_error("too many queries, limit is " + std::to_string(MAX_AVAILABILITY_QUERIES));
+            }
+            AvailabilityQuery query;
+            if (reader.at_object()) {
+                reader.begin_object();
+                while (reader.next_key(key)) {
+                    if (key == "room_id") {
+                        query.room_id = reader.read_int();
+                    } else if (key == "check_in") {
+                        query.check_in = reader.read_string();
+                    } else if (key == "check_out") {
+                        query.check_out = reader.read_string();
+                    } else {
+                        reader.skip();
+                    }
+                }
+            } else {
+                reader.begin_array();
+                bool complete = reader.next_element();
+                query.room_id = reader.read_int();
+                complete = complete && reader.next_element();
+                query.check_in = reader.read_string();
+                complete = complete && reader.next_element();
+                query.check_out = reader.read_string();
+                if (!complete || reader.next_element()) {
+                    throw std::runtime_error("query must be [room_id, check_in, check_out]");
+                }
+            }
+            if (query.room_id <= 0 || !validate_date(query.check_in) || !validate_date(query.check_out) ||
+                !date_less(query.check_in, query.check_out)) {
+                throw std::runtime_error("query " + std::to_string(queries.size()) +
+                                         ": room_id > 0, check_in and check_out as YYYY-MM-DD, check_in < check_out");
+            }
+            queries.push_back(std::move(query));
+        }
+    }
+    reader.end();
+    return queries;
+}
+
+// Ответ API с ETag по телу: повторный запрос без изменений получает 304 без тела
+void send_json(const ConditionalGet& conditional, const Request& req, Response& res, std::string body, bool personal) {
+    PageVersion version;
+    version.add_bytes(body);
+    if (conditional.not_modified(req, res, version, personal)) {
+        return;
+    }
+    res.set_content(std::move(body), JSON_CONTENT_TYPE);
+}
+
+int main(int argc, char** argv) {
     try {
-        Database db("hotels.db");
+        ServerConfig config;
+        if (!ServerConfig::load(argc, argv, config)) {
+            return 0;
+        }
+        Logger::instance().set_level(Logger::parse_level(config.log_level));
+
+        Database db(config.db_path);
+        if (config.merge_guests) {
+            auto merged = db.merge_duplicate_guests();
+            Logger::info("Duplicate guests merged", {{"merged", merged.merged}, {"bookings_moved", merged.bookings_moved}, {"keyed", merged.keyed}});
+            return 0;
+        }
+        if (config.change_retention_days != 0) {
+            int pruned = db.prune_changes(static_cast<int64_t>(config.change_retention_days));
+            Logger::info("Change log pruned", {{"removed", pruned}, {"retention_days", config.change_retention_days}});
+        }
+        SessionStore sessions(db);
+        Router router;
         Server svr;
 
-        // Вспомогательная функция для получения пользователя из сессии
-        auto get_user_from_session = [&db](const Request& req) -> User {
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id != 0) {
-                return db.get_user(user_id);
-            }
-            return User();
+        auto queue_stats = std::make_shared<TaskQueueStats>();
+        size_t worker_threads = config.worker_threads();
+        size_t queue_capacity = config.queue_capacity();
+        svr.new_task_queue = [queue_stats, worker_threads, queue_capacity] {
+            return new BoundedTaskQueue(worker_threads, queue_capacity, queue_stats);
         };
+        svr.set_keep_alive_max_count(config.keep_alive_max_count);
+        svr.set_keep_alive_timeout(config.keep_alive_timeout);
+        svr.set_read_timeout(config.read_timeout);
+        svr.set_write_timeout(config.write_timeout);
+        svr.set_payload_max_length(config.payload_max_length);
+
+        AdmissionControl admission(
+            {0, std::chrono::milliseconds(config.queue_deadline_ms)},
+            {config.heavy_concurrency(), std::chrono::milliseconds(config.heavy_queue_deadline_ms)},
+            config.retry_after);
+
+        // Трассировка выборки запросов: начало - первым middleware, конец - в логгере,
+        // который httplib вызывает после записи ответа
+        Tracer tracer(config.trace_sample);
+        router.use([&tracer](RequestContext& ctx, const Request& req, Response& res) {
+            tracer.begin_request(ctx.route->pattern.c_str(), req.method, req.path, ctx.started_at);
+            return true;
+        });
+        router.observe([&tracer](const RequestContext& ctx, const Request& req, const Response& res) {
+            tracer.handler_finished();
+        });
+        svr.set_logger([&tracer](const Request& req, const Response& res) {
+            tracer.end_request();
+        });
+        db.add_statement_listener([](sqlite3_stmt* stmt, uint64_t nanoseconds) {
+            if (Tracer* t = Tracer::current()) {
+                uint64_t end = t->now_ns();
+                const char* sql = sqlite3_sql(stmt);
+                t->record("sqlite", "db", end > nanoseconds ? end - nanoseconds : 0, end, sql ? sql : "");
+            }
+        });
+
+        // Метрики: счетчики по потокам, время SQL - через профилирование SQLite
+        Metrics metrics;
+        db.add_statement_listener([&metrics](sqlite3_stmt*, uint64_t nanoseconds) {
+            metrics.record_query(nanoseconds);
+        });
+        router.use([&metrics](RequestContext& ctx, const Request& req, Response& res) {
+            metrics.request_started();
+            return true;
+        });
+        router.observe([&metrics](const RequestContext& ctx, const Request& req, const Response& res) {
+            metrics.request_finished(ctx.route->id, res.status == -1 ? 200 : res.status,
+                                     std::chrono::steady_clock::now() - ctx.started_at, res.body.size());
+        });
+
+        // Профилировщик SQL включается явно: подсчет строк требует трассировки каждой строки
+        std::unique_ptr<QueryProfiler> profiler;
+        if (config.profile_queries) {
+            profiler = std::make_unique<QueryProfiler>(db.path(), std::chrono::milliseconds(config.slow_query_ms));
+            QueryProfiler* p = profiler.get();
+            db.add_row_listener([p](sqlite3_stmt* stmt) {
+                p->on_row(stmt);
+            });
+            db.add_statement_listener([p](sqlite3_stmt* stmt, uint64_t nanoseconds) {
+                p->on_statement(stmt, nanoseconds);
+            });
+        }
+
+        // Бюджет SQL на запрос: предупреждение (или 500 в строгой сборке) при N+1
+        QueryBudget query_budget({config.query_budget, config.query_repeat_budget});
+        db.add_statement_listener([&query_budget](sqlite3_stmt* stmt, uint64_t) {
+            query_budget.record(stmt);
+        });
+        router.use([&query_budget](RequestContext& ctx, const Request& req, Response& res) {
+            query_budget.request_started();
+            return true;
+        });
+        // Фильтр, а не наблюдатель: исключение строгой сборки Router превращает в ответ 500
+        // до сжатия и до метрик
+        router.filter([&query_budget](const RequestContext& ctx, const Request& req, Response& res) {
+            query_budget.check(ctx.route->id);
+        });
+
+        // Статические файлы из каталога --static-dir; без них страницы ссылаются на CDN.
+        // URL подставляются в макет до сжатия его частей.
+        StaticAssets static_assets;
+        if (static_assets.load(config.static_dir) > 0) {
+            HtmlGenerator::set_static_urls(
+                static_assets.url("bootstrap/css/bootstrap.min.css", HtmlGenerator::CDN_BOOTSTRAP_CSS),
+                static_assets.url("bootstrap-icons/bootstrap-icons.css", HtmlGenerator::CDN_BOOTSTRAP_ICONS_CSS),
+                static_assets.url("bootstrap/js/bootstrap.bundle.min.js", HtmlGenerator::CDN_BOOTSTRAP_JS));
+        } else {
+            Logger::warn("Static directory is missing or empty, pages use CDN links", {{"dir", config.static_dir}});
+        }
+
+        // Сжатие ответов: неизменные части макета сжимаются один раз при запуске
+        Compression compression(static_cast<int>(config.gzip_level), config.gzip_min_size);
+        compression.set_layout(HtmlGenerator::layout_slots());
+        router.filter([&compression](const RequestContext& ctx, const Request& req, Response& res) {
+            TraceSpan span("compress", "http");
+            compression.apply(req, res);
+        });
+
+        // Условный GET для страниц номера, гостя и бронирования
+        ConditionalGet conditional;
+
+        // Уведомления о новых записях журнала изменений для /api/v1/changes/
+        ChangeFeed change_feed(db, config.change_waiter_limit());
+
+        // Middleware: admission control - до любой работы с сессией и базой
+        router.use([&admission](RequestContext& ctx, const Request& req, Response& res) {
+            auto decision = admission.try_admit(ctx.route->cost, BoundedTaskQueue::take_queue_wait(), ctx.admission);
+            if (decision == AdmissionControl::Decision::Admitted) {
+                return true;
+            }
+            res.status = 503;
+            res.set_header("Retry-After", std::to_string(admission.retry_after()));
+            res.set_content("Сервер перегружен, повторите запрос позже", "text/plain; charset=utf-8");
+            return false;
+        });
+
+        // Middleware: сессия и пользователь разбираются один раз на запрос
+        router.use([&sessions](RequestContext& ctx, const Request& req, Response& res) {
+            if (ctx.route->access == Access::Static) {
+                return true;
+            }
+            TraceSpan span("session", "middleware");
+            ctx.session_token = get_session_token(req);
+            if (!ctx.session_token.empty()) {
+                ctx.user = sessions.get_user(ctx.session_token);
+                ctx.user_id = ctx.user.user_id;
+            }
+            return true;
+        });
+
+        // Middleware: ограничение частоты записи на клиента - IP-адрес и, после входа, сессию
+        RateLimiter rate_limiter;
+        std::unordered_map<const Route*, size_t> rate_policies;  // заполняется после регистрации маршрутов
+        router.use([&rate_limiter, &rate_policies](RequestContext& ctx, const Request& req, Response& res) {
+            auto it = rate_policies.find(ctx.route);
+            if (it == rate_policies.end()) {
+                return true;
+            }
+            std::vector<std::string> clients{"ip:" + req.remote_addr};
+            if (ctx.user_id != 0) {
+                clients.push_back("s:" + ctx.session_token);
+            }
+            int retry_after = 0;
+            if (rate_limiter.allow(it->second, clients, retry_after)) {
+                return true;
+            }
+            res.status = 429;
+            res.set_header("Retry-After", std::to_string(retry_after));
+            render_error(res, "Слишком много запросов. Повторите попытку через " + std::to_string(retry_after) + " с.", &ctx.user);
+            return false;
+        });
+
+        // Middleware: проверка уровня доступа маршрута
+        router.use([](RequestContext& ctx, const Request& req, Response& res) {
+            if (ctx.route->access == Access::Public || ctx.route->access == Access::Static) {
+                return true;
+            }
+            if (ctx.route->access == Access::Local) {
+                if (!is_loopback(req.remote_addr)) {
+                    res.status = 404;
+                    return false;
+                }
+                return true;
+            }
+            // API отвечает кодом и JSON вместо перенаправления на форму входа
+            bool api = is_api_request(req);
+            if (!ctx.is_authenticated()) {
+                if (api) {
+                    render_json_error(res, 401, "authentication required");
+                } else {
+                    redirect(res, "/login/");
+                }
+                return false;
+            }
+            if (ctx.route->access == Access::Organization && !ctx.user.is_organization()) {
+                if (api) {
+                    render_json_error(res, 403, "forbidden");
+                } else {
+                    render_error(res, "Доступ запрещен", &ctx.user);
+                }
+                return false;
+            }
+            return true;
+        });
 
         // Главная страница
-        svr.Get("/", [&db, &get_user_from_session](const Request& req, Response& res) {
-            User user = get_user_from_session(req);
-            res.set_content(HtmlGenerator::home_page(db, &user), "text/html; charset=utf-8");
+        router.get("/", Access::Public, Cost::Heavy, [&db](RequestContext& ctx, const Request& req, Response& res) {
+            res.set_content(HtmlGenerator::home_page(db, &ctx.user), HTML_CONTENT_TYPE);
         });
 
         // Список номеров
-        svr.Get("/rooms/", [&db](const Request& req, Response& res) {
+        router.get("/rooms/", Access::User, Cost::Heavy, [&db](RequestContext& ctx, const Request& req, Response& res) {
             std::string type_filter = "";
             if (req.has_param("type")) {
                 type_filter = url_decode(req.get_param_value("type"));
             }
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id == 0) {
-                res.set_header("Location", "/login/");
-                res.status = 302;
-                return;
-            }
-            User user = db.get_user(user_id);
-            res.set_content(HtmlGenerator::rooms_list(db, type_filter, &user), "text/html; charset=utf-8");
+            res.set_content(HtmlGenerator::rooms_list(db, type_filter, &ctx.user), HTML_CONTENT_TYPE);
+        });
+
+        // Только карточки номеров для фильтра без перезагрузки страницы
+        router.get("/rooms/fragment/", Access::User, Cost::Heavy, [&db](RequestContext& ctx, const Request& req, Response& res) {
+            std::string type_filter = req.has_param("type") ? url_decode(req.get_param_value("type")) : "";
+            res.set_content(HtmlGenerator::rooms_fragment(db, type_filter), HTML_CONTENT_TYPE);
         });
 
         // Детали номера
-        svr.Get(R"(/rooms/(\d+)/)", [&db](const Request& req, Response& res) {
-            int64_t room_id = std::stoll(req.matches[1]);
+        router.get("/rooms/{room_id}/", Access::Public, [&db, &conditional](RequestContext& ctx, const Request& req, Response& res) {
+            int64_t room_id = ctx.param(0);
             std::string check_in = "";
             std::string check_out = "";
             if (req.has_param("check_in")) {
@@ -161,48 +610,42 @@ int main() {
             if (req.has_param("check_out")) {
                 check_out = url_decode(req.get_param_value("check_out"));
             }
-            res.set_content(HtmlGenerator::room_detail(db, room_id, check_in, check_out), "text/html; charset=utf-8");
+            // Проверка доступности на даты зависит от чужих бронирований - такие ответы не валидируются
+            if (check_in.empty() && check_out.empty()) {
+                PageVersion version = db.get_room_page_version(room_id);
+                if (version.found && conditional.not_modified(req, res, version, false)) {
+                    return;
+                }
+            }
+            res.set_content(HtmlGenerator::room_detail(db, room_id, check_in, check_out), HTML_CONTENT_TYPE);
         });
 
         // Список гостей
-        svr.Get("/guests/", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id == 0) {
-                res.set_header("Location", "/login/");
-                res.status = 302;
-                return;
-            }
+        router.get("/guests/", Access::User, Cost::Heavy, [&db](RequestContext& ctx, const Request& req, Response& res) {
             std::string search = "";
             if (req.has_param("search")) {
                 search = url_decode(req.get_param_value("search"));
             }
-            User user = db.get_user(user_id);
-            res.set_content(HtmlGenerator::guests_list(db, search, user_id, &user), "text/html; charset=utf-8");
+            res.set_content(HtmlGenerator::guests_list(db, search, ctx.user_id, &ctx.user), HTML_CONTENT_TYPE);
+        });
+
+        // Только строки таблицы гостей для поиска без перезагрузки страницы
+        router.get("/guests/fragment/", Access::User, Cost::Heavy, [&db](RequestContext& ctx, const Request& req, Response& res) {
+            std::string search = req.has_param("search") ? url_decode(req.get_param_value("search")) : "";
+            res.set_content(HtmlGenerator::guests_fragment(db, search, ctx.user_id), HTML_CONTENT_TYPE);
         });
 
         // Форма создания гостя (GET)
-        svr.Get("/guests/create/", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id == 0) {
-                res.set_header("Location", "/login/");
-                res.status = 302;
-                return;
-            }
-            res.set_content(HtmlGenerator::guest_form(), "text/html; charset=utf-8");
+        router.get("/guests/create/", Access::User, [](RequestContext& ctx, const Request& req, Response& res) {
+            res.set_content(HtmlGenerator::guest_form(), HTML_CONTENT_TYPE);
         });
 
         // Создание гостя (POST)
-        svr.Post("/guests/create/", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id == 0) {
-                res.set_header("Location", "/login/");
-                res.status = 302;
-                return;
-            }
+        router.post("/guests/create/", Access::User, [&db](RequestContext& ctx, const Request& req, Response& res) {
             auto params = parse_form_data(req.body);
 
             Guest guest;
-            guest.user_id = user_id;  // Связываем гостя с пользователем
+            guest.user_id = ctx.user_id;  // Связываем гостя с пользователем
             guest.first_name = params.count("first_name") ? params["first_name"] : "";
             guest.last_name = params.count("last_name") ? params["last_name"] : "";
             guest.middle_name = params.count("middle_name") ? params["middle_name"] : "";
@@ -213,62 +656,77 @@ int main() {
             if (guest.first_name.empty() || guest.last_name.empty() ||
                 guest.passport_number.empty() || guest.phone.empty()) {
                 std::string error = "Заполните все обязательные поля";
-                res.set_content(HtmlGenerator::guest_form(error, guest), "text/html; charset=utf-8");
+                res.set_content(HtmlGenerator::guest_form(error, guest), HTML_CONTENT_TYPE);
                 return;
             }
 
             try {
                 int64_t guest_id = db.create_guest(guest);
-                std::cerr << "[INFO] " << get_current_datetime() << " - Guest created successfully: ID=" << guest_id << ", user_id=" << guest.user_id << std::endl;
-                res.set_header("Location", "/guests/");
-                res.status = 302;
+                Logger::info("Guest created", {{"guest_id", guest_id}, {"user_id", guest.user_id}});
+                redirect(res, "/guests/");
             } catch (const std::exception& e) {
                 std::string error = "Ошибка при создании гостя: " + std::string(e.what());
-                std::cerr << "[ERROR] " << get_current_datetime() << " - Failed to create guest: " << e.what() << std::endl;
-                res.set_content(HtmlGenerator::guest_form(error, guest), "text/html; charset=utf-8");
+                Logger::error("Failed to create guest", {{"error", e.what()}});
+                res.set_content(HtmlGenerator::guest_form(error, guest), HTML_CONTENT_TYPE);
             }
         });
 
         // Детали гостя
-        svr.Get(R"(/guests/(\d+)/)", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id == 0) {
-                res.set_header("Location", "/login/");
-                res.status = 302;
+        router.get("/guests/{guest_id}/", Access::User, [&db, &conditional](RequestContext& ctx, const Request& req, Response& res) {
+            int64_t guest_id = ctx.param(0);
+            PageVersion version = db.get_guest_page_version(guest_id);
+            if (!version.found || version.user_id != ctx.user_id) {
+                render_error(res, "Гость не найден или у вас нет доступа к этому гостю", &ctx.user);
                 return;
             }
-            int64_t guest_id = std::stoll(req.matches[1]);
-            Guest guest = db.get_guest(guest_id);
-            if (guest.guest_id == 0 || guest.user_id != user_id) {
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>Гость не найден или у вас нет доступа к этому гостю</div>", "", &user), "text/html; charset=utf-8");
+            if (conditional.not_modified(req, res, version, true)) {
                 return;
             }
-            res.set_content(HtmlGenerator::guest_detail(db, guest_id), "text/html; charset=utf-8");
+            res.set_content(HtmlGenerator::guest_detail(db, guest_id), HTML_CONTENT_TYPE);
         });
 
         // Список бронирований (только для просмотра, без редактирования)
-        svr.Get("/bookings/", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id == 0) {
-                res.set_header("Location", "/login/");
-                res.status = 302;
-                return;
-            }
+        router.get("/bookings/", Access::User, Cost::Heavy, [&db](RequestContext& ctx, const Request& req, Response& res) {
             std::string search = "";
             if (req.has_param("search")) {
                 search = url_decode(req.get_param_value("search"));
             }
-            User user = db.get_user(user_id);
-            res.set_content(HtmlGenerator::bookings_list(db, search, &user), "text/html; charset=utf-8");
+            res.set_content(HtmlGenerator::bookings_list(db, search, &ctx.user), HTML_CONTENT_TYPE);
+        });
+
+        // Только строки таблицы бронирований для поиска без перезагрузки страницы
+        router.get("/bookings/fragment/", Access::User, Cost::Heavy, [&db](RequestContext& ctx, const Request& req, Response& res) {
+            std::string search = req.has_param("search") ? url_decode(req.get_param_value("search")) : "";
+            res.set_content(HtmlGenerator::bookings_fragment(db, search, ctx.user_id), HTML_CONTENT_TYPE);
+        });
+
+        // Подсказки для формы бронирования: <option> первых совпадений по началу строки
+        // (?q=<начало>&limit=<сколько>); форма бронирования открыта и без входа
+        router.get("/rooms/suggest/", Access::Public, [&db](RequestContext& ctx, const Request& req, Response& res) {
+            std::string prefix = req.has_param("q") ? url_decode(req.get_param_value("q")) : "";
+            int64_t limit = HtmlGenerator::SUGGEST_LIMIT;
+            if (!parse_int_param(req, "limit", limit) || limit == 0) {
+                limit = HtmlGenerator::SUGGEST_LIMIT;
+            }
+            res.set_content(HtmlGenerator::room_options(db, prefix, std::min(static_cast<size_t>(limit), HtmlGenerator::MAX_SUGGEST_LIMIT)), HTML_CONTENT_TYPE);
+        });
+
+        router.get("/guests/suggest/", Access::User, [&db](RequestContext& ctx, const Request& req, Response& res) {
+            std::string prefix = req.has_param("q") ? url_decode(req.get_param_value("q")) : "";
+            int64_t limit = HtmlGenerator::SUGGEST_LIMIT;
+            if (!parse_int_param(req, "limit", limit) || limit == 0) {
+                limit = HtmlGenerator::SUGGEST_LIMIT;
+            }
+            res.set_content(HtmlGenerator::guest_options(db, prefix, ctx.user_id, std::min(static_cast<size_t>(limit), HtmlGenerator::MAX_SUGGEST_LIMIT)), HTML_CONTENT_TYPE);
         });
 
         // Форма создания бронирования (GET)
-        svr.Get("/bookings/create/", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
+        router.get("/bookings/create/", Access::Public, Cost::Heavy, [&db](RequestContext& ctx, const Request& req, Response& res) {
             Booking booking;
-            if (req.has_param("room")) {
-                booking.room_id = std::stoll(url_decode(req.get_param_value("room")));
+            if (!parse_int_param(req, "room", booking.room_id)) {
+                res.status = 400;
+                render_error(res, "Неверный номер", &ctx.user);
+                return;
             }
             if (req.has_param("check_in")) {
                 booking.check_in_date = url_decode(req.get_param_value("check_in"));
@@ -276,12 +734,12 @@ int main() {
             if (req.has_param("check_out")) {
                 booking.check_out_date = url_decode(req.get_param_value("check_out"));
             }
-            res.set_content(HtmlGenerator::booking_form(db, "", booking, Guest(), user_id), "text/html; charset=utf-8");
+            res.set_content(HtmlGenerator::booking_form(db, "", booking, Guest(), ctx.user_id), HTML_CONTENT_TYPE);
         });
 
         // Создание бронирования (POST)
-        svr.Post("/bookings/create/", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
+        router.post("/bookings/create/", Access::Public, [&db](RequestContext& ctx, const Request& req, Response& res) {
+            int64_t user_id = ctx.user_id;
             auto params = parse_form_data(req.body);
 
             Booking booking;
@@ -292,20 +750,18 @@ int main() {
             int64_t guest_id = 0;
 
             if (!guest_id_str.empty()) {
-                try {
-                    guest_id = std::stoll(guest_id_str);
-                    guest = db.get_guest(guest_id);
-                    if (guest.guest_id == 0 || (user_id > 0 && guest.user_id != user_id)) {
-                        res.set_content(HtmlGenerator::booking_form(db, "Выбранный гость не найден", booking, guest, user_id), "text/html; charset=utf-8");
-                        return;
-                    }
-                } catch (...) {
-                    res.set_content(HtmlGenerator::booking_form(db, "Неверный ID гостя", booking, guest, user_id), "text/html; charset=utf-8");
+                if (!parse_int(guest_id_str, guest_id)) {
+                    res.status = 400;
+                    res.set_content(HtmlGenerator::booking_form(db, "Неверный ID гостя", booking, guest, user_id), HTML_CONTENT_TYPE);
+                    return;
+                }
+                guest = db.get_guest(guest_id);
+                if (guest.guest_id == 0 || (user_id > 0 && guest.user_id != user_id)) {
+                    res.set_content(HtmlGenerator::booking_form(db, "Выбранный гость не найден", booking, guest, user_id), HTML_CONTENT_TYPE);
                     return;
                 }
             } else {
                 // Создаем нового гостя
-                int64_t user_id = get_user_id_from_session(req);
                 guest.user_id = user_id;  // Связываем гостя с пользователем
                 guest.first_name = params.count("first_name") ? params["first_name"] : "";
                 guest.last_name = params.count("last_name") ? params["last_name"] : "";
@@ -317,16 +773,17 @@ int main() {
                 if (guest.first_name.empty() || guest.last_name.empty() ||
                     guest.passport_number.empty() || guest.phone.empty()) {
                     std::string error = "Заполните все обязательные поля гостя";
-                    res.set_content(HtmlGenerator::booking_form(db, error, booking, guest, user_id), "text/html; charset=utf-8");
+                    res.set_content(HtmlGenerator::booking_form(db, error, booking, guest, user_id), HTML_CONTENT_TYPE);
                     return;
                 }
 
+                // Постоянный гость (тот же паспорт у этого пользователя) не дублируется
                 try {
-                    guest_id = db.create_guest(guest);
+                    guest_id = db.upsert_guest(guest);
                 } catch (const std::exception& e) {
                     std::string error = "Ошибка при создании гостя: " + std::string(e.what());
-                    std::cerr << "[ERROR] " << get_current_datetime() << " - Failed to create guest in booking: " << e.what() << std::endl;
-                    res.set_content(HtmlGenerator::booking_form(db, error, booking, guest, user_id), "text/html; charset=utf-8");
+                    Logger::error("Failed to create guest in booking", {{"error", e.what()}});
+                    res.set_content(HtmlGenerator::booking_form(db, error, booking, guest, user_id), HTML_CONTENT_TYPE);
                     return;
                 }
             }
@@ -334,54 +791,56 @@ int main() {
             // Заполняем данные бронирования
             std::string room_id_str = params.count("room_id") ? params["room_id"] : "";
             if (room_id_str.empty()) {
-                res.set_content(HtmlGenerator::booking_form(db, "Выберите номер", booking, guest, user_id), "text/html; charset=utf-8");
+                res.set_content(HtmlGenerator::booking_form(db, "Выберите номер", booking, guest, user_id), HTML_CONTENT_TYPE);
+                return;
+            }
+            if (!parse_int(room_id_str, booking.room_id)) {
+                res.status = 400;
+                res.set_content(HtmlGenerator::booking_form(db, "Неверный номер", booking, guest, user_id), HTML_CONTENT_TYPE);
                 return;
             }
 
             try {
-                booking.room_id = std::stoll(room_id_str);
                 booking.guest_id = guest_id;
                 booking.check_in_date = params.count("check_in_date") ? params["check_in_date"] : "";
                 booking.check_out_date = params.count("check_out_date") ? params["check_out_date"] : "";
 
                 if (booking.check_in_date.empty() || booking.check_out_date.empty()) {
-                    res.set_content(HtmlGenerator::booking_form(db, "Укажите даты заезда и выезда", booking, guest, user_id), "text/html; charset=utf-8");
+                    res.set_content(HtmlGenerator::booking_form(db, "Укажите даты заезда и выезда", booking, guest, user_id), HTML_CONTENT_TYPE);
                     return;
                 }
 
                 // Валидация дат
                 if (!date_less(booking.check_in_date, booking.check_out_date)) {
-                    res.set_content(HtmlGenerator::booking_form(db, "Дата заезда должна быть раньше даты выезда", booking, guest, user_id), "text/html; charset=utf-8");
+                    res.set_content(HtmlGenerator::booking_form(db, "Дата заезда должна быть раньше даты выезда", booking, guest, user_id), HTML_CONTENT_TYPE);
                     return;
                 }
 
                 if (date_less(booking.check_in_date, get_current_date())) {
-                    res.set_content(HtmlGenerator::booking_form(db, "Дата заезда не может быть в прошлом", booking, guest, user_id), "text/html; charset=utf-8");
+                    res.set_content(HtmlGenerator::booking_form(db, "Дата заезда не может быть в прошлом", booking, guest, user_id), HTML_CONTENT_TYPE);
                     return;
                 }
 
                 // Проверка доступности номера
                 if (!db.is_room_available(booking.room_id, booking.check_in_date, booking.check_out_date)) {
-                    res.set_content(HtmlGenerator::booking_form(db, "Номер занят на выбранные даты", booking, guest, user_id), "text/html; charset=utf-8");
+                    Room room = db.get_room(booking.room_id);
+                    StayOptions options = db.find_stay_options(room.hotel_id, room.type_name, booking.check_in_date, booking.check_out_date);
+                    res.set_content(HtmlGenerator::booking_form(db, "Номер занят на выбранные даты", booking, guest, user_id, &options), HTML_CONTENT_TYPE);
                     return;
                 }
 
                 std::string adults_str = params.count("adults_count") ? params["adults_count"] : "1";
-                booking.adults_count = std::stoi(adults_str);
-                if (booking.adults_count < 1) {
-                    booking.adults_count = 1;
-                }
-
                 std::string children_str = params.count("children_count") ? params["children_count"] : "0";
-                booking.children_count = std::stoi(children_str);
-                if (booking.children_count < 0) {
-                    booking.children_count = 0;
+                if (!parse_guest_count(adults_str, 1, booking.adults_count) || !parse_guest_count(children_str, 0, booking.children_count)) {
+                    res.status = 400;
+                    res.set_content(HtmlGenerator::booking_form(db, "Неверное число гостей", booking, guest, user_id), HTML_CONTENT_TYPE);
+                    return;
                 }
 
                 // Получаем номер для расчета стоимости
                 Room room = db.get_room(booking.room_id);
                 if (room.room_id == 0) {
-                    res.set_content(HtmlGenerator::booking_form(db, "Номер не найден", booking, guest, user_id), "text/html; charset=utf-8");
+                    res.set_content(HtmlGenerator::booking_form(db, "Номер не найден", booking, guest, user_id), HTML_CONTENT_TYPE);
                     return;
                 }
 
@@ -404,61 +863,41 @@ int main() {
                 booking.special_requests = params.count("special_requests") ? params["special_requests"] : "";
 
                 db.create_booking(booking);
-                res.set_header("Location", "/bookings/");
-                res.status = 302;
+                redirect(res, "/bookings/");
             } catch (const std::exception& e) {
                 std::string error = "Ошибка при создании бронирования: " + std::string(e.what());
-                res.set_content(HtmlGenerator::booking_form(db, error, booking, guest, user_id), "text/html; charset=utf-8");
+                res.set_content(HtmlGenerator::booking_form(db, error, booking, guest, user_id), HTML_CONTENT_TYPE);
             }
         });
 
         // Детали бронирования
-        svr.Get(R"(/bookings/(\d+)/)", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id == 0) {
-                res.set_header("Location", "/login/");
-                res.status = 302;
+        router.get("/bookings/{booking_id}/", Access::User, [&db, &conditional](RequestContext& ctx, const Request& req, Response& res) {
+            int64_t booking_id = ctx.param(0);
+            // Версия страницы вместе с владельцами: доступ проверяется тем же запросом
+            PageVersion version = db.get_booking_page_version(booking_id);
+            if (!version.found) {
+                render_error(res, "Бронирование не найдено", &ctx.user);
                 return;
             }
-            int64_t booking_id = std::stoll(req.matches[1]);
-            Booking booking = db.get_booking(booking_id);
-            if (booking.booking_id == 0) {
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>Бронирование не найдено</div>", "", &user), "text/html; charset=utf-8");
+            // Доступ есть у пользователя, создавшего гостя, и у организации, владеющей отелем
+            bool has_access = version.user_id == ctx.user_id || (ctx.user.is_organization() && ctx.owns(version.organization_id));
+            if (!has_access) {
+                render_error(res, "У вас нет доступа к этому бронированию", &ctx.user);
                 return;
             }
-            Guest guest = db.get_guest(booking.guest_id);
-            // Проверяем, что гость принадлежит текущему пользователю
-            // Исключение: если пользователь - организация, владеющая отелем, то он может видеть бронирование
-            bool has_access = false;
-            if (guest.user_id == user_id) {
-                has_access = true;
-            } else {
-                // Проверяем, является ли пользователь организацией, владеющей отелем
-                User user = db.get_user(user_id);
-                if (user.is_organization()) {
-                    Room room = db.get_room(booking.room_id);
-                    Hotel hotel = db.get_hotel(room.hotel_id);
-                    if (hotel.organization_id == user_id) {
-                        has_access = true;
-                    }
-                }
-            }
-            if (!has_access) {
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>У вас нет доступа к этому бронированию</div>", "", &user), "text/html; charset=utf-8");
+            if (conditional.not_modified(req, res, version, true)) {
                 return;
             }
-            res.set_content(HtmlGenerator::booking_detail(db, booking_id), "text/html; charset=utf-8");
+            res.set_content(HtmlGenerator::booking_detail(db, booking_id), HTML_CONTENT_TYPE);
         });
 
         // Регистрация (GET)
-        svr.Get("/register/", [&db](const Request& req, Response& res) {
-            res.set_content(HtmlGenerator::registration_form(), "text/html; charset=utf-8");
+        router.get("/register/", Access::Public, [](RequestContext& ctx, const Request& req, Response& res) {
+            res.set_content(HtmlGenerator::registration_form(), HTML_CONTENT_TYPE);
         });
 
         // Регистрация (POST)
-        svr.Post("/register/", [&db](const Request& req, Response& res) {
+        router.post("/register/", Access::Public, [&db, &sessions](RequestContext& ctx, const Request& req, Response& res) {
             auto params = parse_form_data(req.body);
 
             User user;
@@ -476,25 +915,25 @@ int main() {
             // Валидация
             if (user.full_name.empty() || user.phone.empty() || user.email.empty() || password.empty()) {
                 std::string error = "Заполните все обязательные поля";
-                res.set_content(HtmlGenerator::registration_form(error, user), "text/html; charset=utf-8");
+                res.set_content(HtmlGenerator::registration_form(error, user), HTML_CONTENT_TYPE);
                 return;
             }
 
             if (user.user_type != "user" && user.user_type != "organization") {
                 std::string error = "Выберите тип регистрации";
-                res.set_content(HtmlGenerator::registration_form(error, user), "text/html; charset=utf-8");
+                res.set_content(HtmlGenerator::registration_form(error, user), HTML_CONTENT_TYPE);
                 return;
             }
 
             if (user.user_type == "organization" && user.organization_name.empty()) {
                 std::string error = "Укажите название организации";
-                res.set_content(HtmlGenerator::registration_form(error, user), "text/html; charset=utf-8");
+                res.set_content(HtmlGenerator::registration_form(error, user), HTML_CONTENT_TYPE);
                 return;
             }
 
             if (password != password_confirm) {
                 std::string error = "Пароли не совпадают";
-                res.set_content(HtmlGenerator::registration_form(error, user), "text/html; charset=utf-8");
+                res.set_content(HtmlGenerator::registration_form(error, user), HTML_CONTENT_TYPE);
                 return;
             }
 
@@ -502,7 +941,7 @@ int main() {
             User existing = db.get_user_by_email(user.email);
             if (existing.user_id != 0) {
                 std::string error = "Пользователь с таким email уже зарегистрирован";
-                res.set_content(HtmlGenerator::registration_form(error, user), "text/html; charset=utf-8");
+                res.set_content(HtmlGenerator::registration_form(error, user), HTML_CONTENT_TYPE);
                 return;
             }
 
@@ -510,141 +949,109 @@ int main() {
 
             try {
                 int64_t user_id = db.create_user(user);
-                set_user_session(res, user_id);
+                set_user_session(sessions, res, user_id);
                 if (user.user_type == "organization") {
-                    res.set_header("Location", "/organization/dashboard/");
+                    redirect(res, "/organization/dashboard/");
                 } else {
-                    res.set_header("Location", "/profile/?registered=1");
+                    redirect(res, "/profile/?registered=1");
                 }
-                res.status = 302;
             } catch (const std::exception& e) {
                 std::string error = "Ошибка при регистрации: " + std::string(e.what());
-                std::cerr << "[ERROR] " << get_current_datetime() << " - Failed to register user: " << e.what() << std::endl;
-                res.set_content(HtmlGenerator::registration_form(error, user), "text/html; charset=utf-8");
+                Logger::error("Failed to register user", {{"error", e.what()}});
+                res.set_content(HtmlGenerator::registration_form(error, user), HTML_CONTENT_TYPE);
             }
         });
 
         // Панель организации
-        svr.Get("/organization/dashboard/", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id == 0) {
-                res.set_header("Location", "/login/");
-                res.status = 302;
-                return;
-            }
+        router.get("/organization/dashboard/", Access::Organization, Cost::Heavy, [&db](RequestContext& ctx, const Request& req, Response& res) {
+            res.set_content(HtmlGenerator::organization_dashboard(db, ctx.user_id, &ctx.user), HTML_CONTENT_TYPE);
+        });
 
-            User user = db.get_user(user_id);
-            if (user.user_id == 0 || !user.is_organization()) {
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>Организация не найдена</div>", "", &user), "text/html; charset=utf-8");
-                return;
-            }
-            res.set_content(HtmlGenerator::organization_dashboard(db, user_id, &user), "text/html; charset=utf-8");
+        // Живое обновление панели организации: число номеров по отелям, новый отель - перезагрузка
+        router.get("/organization/dashboard/events/", Access::Organization, [&db, &change_feed](RequestContext& ctx, const Request& req, Response& res) {
+            int64_t since = 0;
+            if (!parse_event_cursor(req, since)) {
+                res.status = 400;
+                return;
+            }
+            auto lease = change_feed.acquire();
+            if (!lease) {
+                res.status = 204;
+                return;
+            }
+            int64_t organization_id = ctx.user_id;
+            stream_changes(res, change_feed, lease, since,
+                           [&db, organization_id](int64_t cursor) { return db.get_organization_changes(organization_id, cursor, 100); },
+                           [&db](const Change& change) {
+                               if (change.entity == "hotel" && change.operation == "insert") {
+                                   return sse_event(change.seq, "hotel-added", std::to_string(change.entity_id));
+                               }
+                               if (change.entity != "room") {
+                                   return std::string();
+                               }
+                               return sse_event(change.seq, "hotel", JsonGenerator::hotel_delta(change.hotel_id, static_cast<size_t>(db.get_hotel_rooms_count(change.hotel_id))));
+                           });
         });
 
         // Создание отеля (GET)
-        svr.Get("/hotels/create/", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id == 0) {
-                res.set_header("Location", "/login/");
-                res.status = 302;
-                return;
-            }
-
-            User user = db.get_user(user_id);
-            if (user.user_id == 0 || !user.is_organization()) {
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>Организация не найдена</div>", "", &user), "text/html; charset=utf-8");
-                return;
-            }
-            res.set_content(HtmlGenerator::hotel_form(user_id, "", Hotel(), &user), "text/html; charset=utf-8");
+        router.get("/hotels/create/", Access::Organization, [](RequestContext& ctx, const Request& req, Response& res) {
+            res.set_content(HtmlGenerator::hotel_form(ctx.user_id, "", Hotel(), &ctx.user), HTML_CONTENT_TYPE);
         });
 
         // Создание отеля (POST)
-        svr.Post("/hotels/create/", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id == 0) {
-                res.set_header("Location", "/login/");
-                res.status = 302;
-                return;
-            }
-
-            User user = db.get_user(user_id);
-            if (user.user_id == 0 || !user.is_organization()) {
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>Организация не найдена</div>", "", &user), "text/html; charset=utf-8");
-                return;
-            }
-
+        router.post("/hotels/create/", Access::Organization, [&db](RequestContext& ctx, const Request& req, Response& res) {
             auto params = parse_form_data(req.body);
 
             Hotel hotel;
-            hotel.organization_id = user_id;
+            hotel.organization_id = ctx.user_id;
             hotel.name = params.count("name") ? params["name"] : "";
             hotel.description = params.count("description") ? params["description"] : "";
             hotel.address = params.count("address") ? params["address"] : "";
 
             if (hotel.name.empty()) {
                 std::string error = "Укажите название отеля";
-                res.set_content(HtmlGenerator::hotel_form(user_id, error, hotel, &user), "text/html; charset=utf-8");
+                res.set_content(HtmlGenerator::hotel_form(ctx.user_id, error, hotel, &ctx.user), HTML_CONTENT_TYPE);
                 return;
             }
 
             try {
                 db.create_hotel(hotel);
-                res.set_header("Location", "/organization/dashboard/");
-                res.status = 302;
+                redirect(res, "/organization/dashboard/");
             } catch (const std::exception& e) {
                 std::string error = "Ошибка при создании отеля: " + std::string(e.what());
-                std::cerr << "[ERROR] " << get_current_datetime() << " - Failed to create hotel: " << e.what() << std::endl;
-                res.set_content(HtmlGenerator::hotel_form(user_id, error, hotel, &user), "text/html; charset=utf-8");
+                Logger::error("Failed to create hotel", {{"error", e.what()}});
+                res.set_content(HtmlGenerator::hotel_form(ctx.user_id, error, hotel, &ctx.user), HTML_CONTENT_TYPE);
             }
         });
 
         // Создание номера в отеле (GET)
-        svr.Get(R"(/hotels/(\d+)/rooms/create/)", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id == 0) {
-                res.set_header("Location", "/login/");
-                res.status = 302;
-                return;
-            }
-
-            int64_t hotel_id = std::stoll(req.matches[1]);
+        router.get("/hotels/{hotel_id}/rooms/create/", Access::User, [&db](RequestContext& ctx, const Request& req, Response& res) {
+            int64_t hotel_id = ctx.param(0);
             Hotel hotel = db.get_hotel(hotel_id);
             if (hotel.hotel_id == 0) {
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>Отель не найден</div>", "", &user), "text/html; charset=utf-8");
+                render_error(res, "Отель не найден", &ctx.user);
                 return;
             }
 
-            if (hotel.organization_id != user_id) {
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>У вас нет доступа к этому отелю</div>", "", &user), "text/html; charset=utf-8");
+            if (!ctx.owns(hotel.organization_id)) {
+                render_error(res, "У вас нет доступа к этому отелю", &ctx.user);
                 return;
             }
 
-            User user = db.get_user(user_id);
-            res.set_content(HtmlGenerator::room_form_for_hotel(db, hotel_id, hotel.organization_id, "", Room(), &user), "text/html; charset=utf-8");
+            res.set_content(HtmlGenerator::room_form_for_hotel(db, hotel_id, hotel.organization_id, "", Room(), &ctx.user), HTML_CONTENT_TYPE);
         });
 
         // Создание номера в отеле (POST)
-        svr.Post(R"(/hotels/(\d+)/rooms/create/)", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id == 0) {
-                res.set_header("Location", "/login/");
-                res.status = 302;
-                return;
-            }
-
-            int64_t hotel_id = std::stoll(req.matches[1]);
+        router.post("/hotels/{hotel_id}/rooms/create/", Access::User, [&db](RequestContext& ctx, const Request& req, Response& res) {
+            int64_t hotel_id = ctx.param(0);
             Hotel hotel = db.get_hotel(hotel_id);
             if (hotel.hotel_id == 0) {
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>Отель не найден</div>", "", &user), "text/html; charset=utf-8");
+                render_error(res, "Отель не найден", &ctx.user);
                 return;
             }
 
-            if (hotel.organization_id != user_id) {
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>У вас нет доступа к этому отелю</div>", "", &user), "text/html; charset=utf-8");
+            if (!ctx.owns(hotel.organization_id)) {
+                render_error(res, "У вас нет доступа к этому отелю", &ctx.user);
                 return;
             }
 
@@ -669,36 +1076,31 @@ int main() {
 
             if (room.number.empty() || room.name.empty() || room.type_name.empty() || room.price_per_day <= 0) {
                 std::string error = "Заполните все обязательные поля (включая цену за день)";
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::room_form_for_hotel(db, hotel_id, hotel.organization_id, error, room, &user), "text/html; charset=utf-8");
+                res.set_content(HtmlGenerator::room_form_for_hotel(db, hotel_id, hotel.organization_id, error, room, &ctx.user), HTML_CONTENT_TYPE);
                 return;
             }
 
             try {
                 db.create_room(room);
-                res.set_header("Location", "/organization/dashboard/");
-                res.status = 302;
+                redirect(res, "/organization/dashboard/");
             } catch (const std::exception& e) {
                 std::string error = "Ошибка при создании номера: " + std::string(e.what());
-                std::cerr << "[ERROR] " << get_current_datetime() << " - Failed to create room: " << e.what() << std::endl;
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::room_form_for_hotel(db, hotel_id, hotel.organization_id, error, room, &user), "text/html; charset=utf-8");
+                Logger::error("Failed to create room", {{"error", e.what()}});
+                res.set_content(HtmlGenerator::room_form_for_hotel(db, hotel_id, hotel.organization_id, error, room, &ctx.user), HTML_CONTENT_TYPE);
             }
         });
 
         // Вход (GET)
-        svr.Get("/login/", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id != 0) {
-                res.set_header("Location", "/profile/");
-                res.status = 302;
+        router.get("/login/", Access::Public, [](RequestContext& ctx, const Request& req, Response& res) {
+            if (ctx.is_authenticated()) {
+                redirect(res, "/profile/");
                 return;
             }
-            res.set_content(HtmlGenerator::login_form(), "text/html; charset=utf-8");
+            res.set_content(HtmlGenerator::login_form(), HTML_CONTENT_TYPE);
         });
 
         // Вход (POST)
-        svr.Post("/login/", [&db](const Request& req, Response& res) {
+        router.post("/login/", Access::Public, [&db, &sessions](RequestContext& ctx, const Request& req, Response& res) {
             auto params = parse_form_data(req.body);
 
             std::string email = params.count("email") ? params["email"] : "";
@@ -706,52 +1108,35 @@ int main() {
 
             if (email.empty() || password.empty()) {
                 std::string error = "Заполните все поля";
-                res.set_content(HtmlGenerator::login_form(error), "text/html; charset=utf-8");
+                res.set_content(HtmlGenerator::login_form(error), HTML_CONTENT_TYPE);
                 return;
             }
 
             User user = db.get_user_by_email(email);
             if (user.user_id == 0) {
                 std::string error = "Неверный email или пароль";
-                res.set_content(HtmlGenerator::login_form(error), "text/html; charset=utf-8");
+                res.set_content(HtmlGenerator::login_form(error), HTML_CONTENT_TYPE);
                 return;
             }
 
             if (user.password != password) {
                 std::string error = "Неверный email или пароль";
-                res.set_content(HtmlGenerator::login_form(error), "text/html; charset=utf-8");
+                res.set_content(HtmlGenerator::login_form(error), HTML_CONTENT_TYPE);
                 return;
             }
 
-            set_user_session(res, user.user_id);
-            res.set_header("Location", "/profile/");
-            res.status = 302;
+            set_user_session(sessions, res, user.user_id);
+            redirect(res, "/profile/");
         });
 
         // Выход
-        svr.Get("/logout/", [&db](const Request& req, Response& res) {
-            clear_user_session(res);
-            res.set_header("Location", "/");
-            res.status = 302;
+        router.get("/logout/", Access::Public, [&sessions](RequestContext& ctx, const Request& req, Response& res) {
+            clear_user_session(sessions, req, res);
+            redirect(res, "/");
         });
 
         // Профиль (GET)
-        svr.Get("/profile/", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id == 0) {
-                res.set_header("Location", "/login/");
-                res.status = 302;
-                return;
-            }
-
-            User user = db.get_user(user_id);
-            if (user.user_id == 0) {
-                clear_user_session(res);
-                res.set_header("Location", "/login/");
-                res.status = 302;
-                return;
-            }
-
+        router.get("/profile/", Access::User, [](RequestContext& ctx, const Request& req, Response& res) {
             std::string success = "";
             if (req.has_param("registered")) {
                 success = "Регистрация успешна! Добро пожаловать!";
@@ -761,26 +1146,12 @@ int main() {
                 success = "Пароль успешно изменен!";
             }
 
-            res.set_content(HtmlGenerator::profile_page(user, "", success), "text/html; charset=utf-8");
+            res.set_content(HtmlGenerator::profile_page(ctx.user, "", success), HTML_CONTENT_TYPE);
         });
 
         // Профиль (POST) - обновление данных
-        svr.Post("/profile/", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id == 0) {
-                res.set_header("Location", "/login/");
-                res.status = 302;
-                return;
-            }
-
-            User user = db.get_user(user_id);
-            if (user.user_id == 0) {
-                clear_user_session(res);
-                res.set_header("Location", "/login/");
-                res.status = 302;
-                return;
-            }
-
+        router.post("/profile/", Access::User, [&db](RequestContext& ctx, const Request& req, Response& res) {
+            User user = ctx.user;
             auto params = parse_form_data(req.body);
 
             user.full_name = params.count("full_name") ? params["full_name"] : "";
@@ -789,7 +1160,7 @@ int main() {
 
             if (user.full_name.empty() || user.phone.empty() || new_email.empty()) {
                 std::string error = "Заполните все обязательные поля";
-                res.set_content(HtmlGenerator::profile_page(user, error), "text/html; charset=utf-8");
+                res.set_content(HtmlGenerator::profile_page(user, error), HTML_CONTENT_TYPE);
                 return;
             }
 
@@ -798,7 +1169,7 @@ int main() {
                 User existing = db.get_user_by_email(new_email);
                 if (existing.user_id != 0 && existing.user_id != user.user_id) {
                     std::string error = "Пользователь с таким email уже существует";
-                    res.set_content(HtmlGenerator::profile_page(user, error), "text/html; charset=utf-8");
+                    res.set_content(HtmlGenerator::profile_page(user, error), HTML_CONTENT_TYPE);
                     return;
                 }
             }
@@ -809,39 +1180,24 @@ int main() {
                 user.organization_name = params.count("organization_name") ? params["organization_name"] : "";
                 if (user.organization_name.empty()) {
                     std::string error = "Укажите название организации";
-                    res.set_content(HtmlGenerator::profile_page(user, error), "text/html; charset=utf-8");
+                    res.set_content(HtmlGenerator::profile_page(user, error), HTML_CONTENT_TYPE);
                     return;
                 }
             }
 
             try {
                 db.update_user(user);
-                res.set_header("Location", "/profile/?updated=1");
-                res.status = 302;
+                redirect(res, "/profile/?updated=1");
             } catch (const std::exception& e) {
                 std::string error = "Ошибка при обновлении данных: " + std::string(e.what());
-                std::cerr << "[ERROR] " << get_current_datetime() << " - Failed to update user profile: " << e.what() << std::endl;
-                res.set_content(HtmlGenerator::profile_page(user, error), "text/html; charset=utf-8");
+                Logger::error("Failed to update user profile", {{"error", e.what()}});
+                res.set_content(HtmlGenerator::profile_page(user, error), HTML_CONTENT_TYPE);
             }
         });
 
         // Изменение пароля (POST)
-        svr.Post("/profile/password/", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id == 0) {
-                res.set_header("Location", "/login/");
-                res.status = 302;
-                return;
-            }
-
-            User user = db.get_user(user_id);
-            if (user.user_id == 0) {
-                clear_user_session(res);
-                res.set_header("Location", "/login/");
-                res.status = 302;
-                return;
-            }
-
+        router.post("/profile/password/", Access::User, [&db](RequestContext& ctx, const Request& req, Response& res) {
+            const User& user = ctx.user;
             auto params = parse_form_data(req.body);
 
             std::string current_password = params.count("current_password") ? params["current_password"] : "";
@@ -850,48 +1206,34 @@ int main() {
 
             if (current_password.empty() || new_password.empty() || new_password_confirm.empty()) {
                 std::string error = "Заполните все поля";
-                res.set_content(HtmlGenerator::profile_page(user, error), "text/html; charset=utf-8");
+                res.set_content(HtmlGenerator::profile_page(user, error), HTML_CONTENT_TYPE);
                 return;
             }
 
             if (user.password != current_password) {
                 std::string error = "Текущий пароль неверен";
-                res.set_content(HtmlGenerator::profile_page(user, error), "text/html; charset=utf-8");
+                res.set_content(HtmlGenerator::profile_page(user, error), HTML_CONTENT_TYPE);
                 return;
             }
 
             if (new_password != new_password_confirm) {
                 std::string error = "Новые пароли не совпадают";
-                res.set_content(HtmlGenerator::profile_page(user, error), "text/html; charset=utf-8");
+                res.set_content(HtmlGenerator::profile_page(user, error), HTML_CONTENT_TYPE);
                 return;
             }
 
             try {
-                db.update_user_password(user_id, new_password);
-                res.set_header("Location", "/profile/?password_updated=1");
-                res.status = 302;
+                db.update_user_password(ctx.user_id, new_password);
+                redirect(res, "/profile/?password_updated=1");
             } catch (const std::exception& e) {
                 std::string error = "Ошибка при изменении пароля: " + std::string(e.what());
-                std::cerr << "[ERROR] " << get_current_datetime() << " - Failed to update password: " << e.what() << std::endl;
-                res.set_content(HtmlGenerator::profile_page(user, error), "text/html; charset=utf-8");
+                Logger::error("Failed to update password", {{"error", e.what()}});
+                res.set_content(HtmlGenerator::profile_page(user, error), HTML_CONTENT_TYPE);
             }
         });
 
         // Управление номерами организации
-        svr.Get("/organization/rooms/", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id == 0) {
-                res.set_header("Location", "/login/");
-                res.status = 302;
-                return;
-            }
-
-            User user = db.get_user(user_id);
-            if (user.user_id == 0 || !user.is_organization()) {
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>Доступ запрещен</div>", "", &user), "text/html; charset=utf-8");
-                return;
-            }
-
+        router.get("/organization/rooms/", Access::Organization, Cost::Heavy, [&db](RequestContext& ctx, const Request& req, Response& res) {
             std::string success = "";
             if (req.has_param("updated")) {
                 success = "Номер успешно обновлен!";
@@ -899,60 +1241,40 @@ int main() {
                 success = "Номер успешно удален!";
             }
 
-            res.set_content(HtmlGenerator::organization_rooms_list(db, user_id, "", success, &user), "text/html; charset=utf-8");
+            res.set_content(HtmlGenerator::organization_rooms_list(db, ctx.user_id, "", success, &ctx.user), HTML_CONTENT_TYPE);
         });
 
-        // Редактирование номера (GET)
-        svr.Get(R"(/rooms/(\d+)/edit/)", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id == 0) {
-                res.set_header("Location", "/login/");
-                res.status = 302;
-                return;
-            }
-
-            int64_t room_id = std::stoll(req.matches[1]);
-            Room room = db.get_room(room_id);
+        // Загрузка номера с проверкой, что он принадлежит отелю текущей организации
+        auto load_owned_room = [&db](RequestContext& ctx, Response& res, Room& room) -> bool {
+            room = db.get_room(ctx.param(0));
             if (room.room_id == 0) {
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>Номер не найден</div>", "", &user), "text/html; charset=utf-8");
-                return;
+                render_error(res, "Номер не найден", &ctx.user);
+                return false;
             }
-
             Hotel hotel = db.get_hotel(room.hotel_id);
-            if (hotel.organization_id != user_id) {
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>У вас нет доступа к этому номеру</div>", "", &user), "text/html; charset=utf-8");
-                return;
-            }
-
-            User user = db.get_user(user_id);
-            res.set_content(HtmlGenerator::room_edit_form(db, room_id, "", room, &user), "text/html; charset=utf-8");
-        });
-
-        // Редактирование номера (POST)
-        svr.Post(R"(/rooms/(\d+)/edit/)", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id == 0) {
-                res.set_header("Location", "/login/");
-                res.status = 302;
-                return;
+            if (!ctx.owns(hotel.organization_id)) {
+                render_error(res, "У вас нет доступа к этому номеру", &ctx.user);
+                return false;
             }
+            return true;
+        };
 
-            int64_t room_id = std::stoll(req.matches[1]);
-            Room room = db.get_room(room_id);
-            if (room.room_id == 0) {
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>Номер не найден</div>", "", &user), "text/html; charset=utf-8");
+        // Редактирование номера (GET)
+        router.get("/rooms/{room_id}/edit/", Access::User, [&db, load_owned_room](RequestContext& ctx, const Request& req, Response& res) {
+            Room room;
+            if (!load_owned_room(ctx, res, room)) {
                 return;
             }
+            res.set_content(HtmlGenerator::room_edit_form(db, room.room_id, "", room, &ctx.user), HTML_CONTENT_TYPE);
+        });
 
-            Hotel hotel = db.get_hotel(room.hotel_id);
-            if (hotel.organization_id != user_id) {
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>У вас нет доступа к этому номеру</div>", "", &user), "text/html; charset=utf-8");
+        // Редактирование номера (POST)
+        router.post("/rooms/{room_id}/edit/", Access::User, [&db, load_owned_room](RequestContext& ctx, const Request& req, Response& res) {
+            Room room;
+            if (!load_owned_room(ctx, res, room)) {
                 return;
             }
+            int64_t room_id = room.room_id;
 
             auto params = parse_form_data(req.body);
 
@@ -973,73 +1295,42 @@ int main() {
 
             if (room.number.empty() || room.name.empty() || room.type_name.empty() || room.price_per_day <= 0) {
                 std::string error = "Заполните все обязательные поля";
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::room_edit_form(db, room_id, error, room, &user), "text/html; charset=utf-8");
+                res.set_content(HtmlGenerator::room_edit_form(db, room_id, error, room, &ctx.user), HTML_CONTENT_TYPE);
                 return;
             }
 
             try {
                 db.update_room(room);
-                res.set_header("Location", "/organization/rooms/?updated=1");
-                res.status = 302;
+                redirect(res, "/organization/rooms/?updated=1");
             } catch (const std::exception& e) {
                 std::string error = "Ошибка при обновлении номера: " + std::string(e.what());
-                std::cerr << "[ERROR] " << get_current_datetime() << " - Failed to update room: " << e.what() << std::endl;
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::room_edit_form(db, room_id, error, room, &user), "text/html; charset=utf-8");
+                Logger::error("Failed to update room", {{"error", e.what()}});
+                res.set_content(HtmlGenerator::room_edit_form(db, room_id, error, room, &ctx.user), HTML_CONTENT_TYPE);
             }
         });
 
         // Удаление номера
-        svr.Get(R"(/rooms/(\d+)/delete/)", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id == 0) {
-                res.set_header("Location", "/login/");
-                res.status = 302;
-                return;
-            }
-
-            int64_t room_id = std::stoll(req.matches[1]);
-            Room room = db.get_room(room_id);
-            if (room.room_id == 0) {
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>Номер не найден</div>", "", &user), "text/html; charset=utf-8");
-                return;
-            }
-
-            Hotel hotel = db.get_hotel(room.hotel_id);
-            if (hotel.organization_id != user_id) {
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>У вас нет доступа к этому номеру</div>", "", &user), "text/html; charset=utf-8");
+        router.get("/rooms/{room_id}/delete/", Access::User, [&db, load_owned_room](RequestContext& ctx, const Request& req, Response& res) {
+            Room room;
+            if (!load_owned_room(ctx, res, room)) {
                 return;
             }
 
             try {
-                db.delete_room(room_id);
-                res.set_header("Location", "/organization/rooms/?deleted=1");
-                res.status = 302;
+                db.delete_room(room.room_id);
+                redirect(res, "/organization/rooms/?deleted=1");
             } catch (const std::exception& e) {
-                std::cerr << "[ERROR] " << get_current_datetime() << " - Failed to delete room: " << e.what() << std::endl;
-                User user = db.get_user(user_id);
-                std::string error = "Ошибка при удалении номера: " + std::string(e.what());
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>" + error + "</div>", "", &user), "text/html; charset=utf-8");
+                Logger::error("Failed to delete room", {{"error", e.what()}});
+                render_error(res, "Ошибка при удалении номера: " + std::string(e.what()), &ctx.user);
             }
         });
 
         // Бронирования отеля
-        svr.Get(R"(/hotels/(\d+)/bookings/)", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id == 0) {
-                res.set_header("Location", "/login/");
-                res.status = 302;
-                return;
-            }
-
-            int64_t hotel_id = std::stoll(req.matches[1]);
+        router.get("/hotels/{hotel_id}/bookings/", Access::User, Cost::Heavy, [&db](RequestContext& ctx, const Request& req, Response& res) {
+            int64_t hotel_id = ctx.param(0);
             Hotel hotel = db.get_hotel(hotel_id);
-            if (hotel.hotel_id == 0 || hotel.organization_id != user_id) {
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>Отель не найден или доступ запрещен</div>", "", &user), "text/html; charset=utf-8");
+            if (hotel.hotel_id == 0 || !ctx.owns(hotel.organization_id)) {
+                render_error(res, "Отель не найден или доступ запрещен", &ctx.user);
                 return;
             }
 
@@ -1048,98 +1339,144 @@ int main() {
                 success = "Бронирование успешно обновлено!";
             }
 
-            User user = db.get_user(user_id);
-            res.set_content(HtmlGenerator::hotel_bookings_list(db, hotel_id, "", success, &user), "text/html; charset=utf-8");
+            res.set_content(HtmlGenerator::hotel_bookings_list(db, hotel_id, "", success, &ctx.user), HTML_CONTENT_TYPE);
         });
 
-        // Редактирование бронирования (GET)
-        svr.Get(R"(/bookings/(\d+)/edit/)", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id == 0) {
-                res.set_header("Location", "/login/");
-                res.status = 302;
+        // Стойка регистрации: заезды, выезды и проживающие на ?date= (по умолчанию - сегодня)
+        router.get("/hotels/{hotel_id}/front-desk/", Access::User, [&db](RequestContext& ctx, const Request& req, Response& res) {
+            int64_t hotel_id = ctx.param(0);
+            Hotel hotel = db.get_hotel(hotel_id);
+            if (hotel.hotel_id == 0 || !ctx.owns(hotel.organization_id)) {
+                render_error(res, "Отель не найден или доступ запрещен", &ctx.user);
                 return;
             }
-
-            int64_t booking_id = std::stoll(req.matches[1]);
-            Booking booking = db.get_booking(booking_id);
-            if (booking.booking_id == 0) {
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>Бронирование не найдено</div>", "", &user), "text/html; charset=utf-8");
-                return;
+            std::string date = req.has_param("date") ? url_decode(req.get_param_value("date")) : "";
+            if (!validate_date(date)) {
+                date = get_current_date();
             }
+            res.set_content(HtmlGenerator::front_desk(db, hotel_id, date, &ctx.user), HTML_CONTENT_TYPE);
+        });
 
-            Room room = db.get_room(booking.room_id);
-            Hotel hotel = db.get_hotel(room.hotel_id);
-            if (hotel.organization_id != user_id) {
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>У вас нет доступа к этому бронированию</div>", "", &user), "text/html; charset=utf-8");
+        // Сетка занятости номеров: ?from=<первый день>&days=<30-90>, по умолчанию - 30 дней с сегодня
+        router.get("/hotels/{hotel_id}/calendar/", Access::User, Cost::Heavy, [&db](RequestContext& ctx, const Request& req, Response& res) {
+            int64_t hotel_id = ctx.param(0);
+            Hotel hotel = db.get_hotel(hotel_id);
+            if (hotel.hotel_id == 0 || !ctx.owns(hotel.organization_id)) {
+                render_error(res, "Отель не найден или доступ запрещен", &ctx.user);
                 return;
             }
-
-            User user = db.get_user(user_id);
-            res.set_content(HtmlGenerator::booking_edit_form(db, booking_id, "", booking, &user), "text/html; charset=utf-8");
+            int64_t first_day = 0;
+            if (!req.has_param("from") || !date_utils::parse_day(url_decode(req.get_param_value("from")), first_day)) {
+                date_utils::parse_day(get_current_date(), first_day);
+            }
+            int64_t days = 30;
+            if (!parse_int_param(req, "days", days) || days < 1) {
+                days = 30;
+            }
+            days = std::min<int64_t>(days, OccupancyCalendar::MAX_DAYS);
+            res.set_content(HtmlGenerator::occupancy_calendar(db, hotel_id, first_day, static_cast<int>(days), &ctx.user), HTML_CONTENT_TYPE);
         });
 
-        // Редактирование бронирования (POST)
-        svr.Post(R"(/bookings/(\d+)/edit/)", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id == 0) {
-                res.set_header("Location", "/login/");
-                res.status = 302;
+        // Живое обновление таблицы бронирований отеля: готовые строки таблицы по SSE.
+        // Если все места подписчиков заняты - 204, и страница остается без живого обновления
+        router.get("/hotels/{hotel_id}/bookings/events/", Access::Organization, [&db, &change_feed](RequestContext& ctx, const Request& req, Response& res) {
+            int64_t hotel_id = ctx.param(0);
+            Hotel hotel = db.get_hotel(hotel_id);
+            if (hotel.hotel_id == 0 || !ctx.owns(hotel.organization_id)) {
+                res.status = 404;
+                return;
+            }
+            int64_t since = 0;
+            if (!parse_event_cursor(req, since)) {
+                res.status = 400;
                 return;
             }
+            auto lease = change_feed.acquire();
+            if (!lease) {
+                res.status = 204;
+                return;
+            }
+            stream_changes(res, change_feed, lease, since,
+                           [&db, hotel_id](int64_t cursor) { return db.get_changes(cursor, 100, hotel_id); },
+                           [&db, hotel_id](const Change& change) {
+                               if (change.entity != "booking") {
+                                   return std::string();
+                               }
+                               std::string row = change.operation == "delete" ? "" : HtmlGenerator::hotel_booking_row(db, hotel_id, change.entity_id);
+                               return row.empty() ? sse_event(change.seq, "booking-removed", std::to_string(change.entity_id))
+                                                  : sse_event(change.seq, "booking", row);
+                           });
+        });
 
-            int64_t booking_id = std::stoll(req.matches[1]);
-            Booking booking = db.get_booking(booking_id);
+        // Загрузка бронирования с проверкой, что оно относится к отелю текущей организации
+        auto load_owned_booking = [&db](RequestContext& ctx, Response& res, Booking& booking, Hotel& hotel) -> bool {
+            booking = db.get_booking(ctx.param(0));
             if (booking.booking_id == 0) {
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>Бронирование не найдено</div>", "", &user), "text/html; charset=utf-8");
+                render_error(res, "Бронирование не найдено", &ctx.user);
+                return false;
+            }
+            Room room = db.get_room(booking.room_id);
+            hotel = db.get_hotel(room.hotel_id);
+            if (!ctx.owns(hotel.organization_id)) {
+                render_error(res, "У вас нет доступа к этому бронированию", &ctx.user);
+                return false;
+            }
+            return true;
+        };
+
+        // Редактирование бронирования (GET)
+        router.get("/bookings/{booking_id}/edit/", Access::User, [&db, load_owned_booking](RequestContext& ctx, const Request& req, Response& res) {
+            Booking booking;
+            Hotel hotel;
+            if (!load_owned_booking(ctx, res, booking, hotel)) {
                 return;
             }
+            res.set_content(HtmlGenerator::booking_edit_form(db, booking.booking_id, "", booking, &ctx.user), HTML_CONTENT_TYPE);
+        });
 
-            Room room = db.get_room(booking.room_id);
-            Hotel hotel = db.get_hotel(room.hotel_id);
-            if (hotel.organization_id != user_id) {
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>У вас нет доступа к этому бронированию</div>", "", &user), "text/html; charset=utf-8");
+        // Редактирование бронирования (POST)
+        router.post("/bookings/{booking_id}/edit/", Access::User, [&db, load_owned_booking](RequestContext& ctx, const Request& req, Response& res) {
+            Booking booking;
+            Hotel hotel;
+            if (!load_owned_booking(ctx, res, booking, hotel)) {
                 return;
             }
+            int64_t booking_id = booking.booking_id;
 
             auto params = parse_form_data(req.body);
 
             std::string room_id_str = params.count("room_id") ? params["room_id"] : "";
-            booking.room_id = std::stoll(room_id_str);
             booking.check_in_date = params.count("check_in_date") ? params["check_in_date"] : "";
             booking.check_out_date = params.count("check_out_date") ? params["check_out_date"] : "";
-            booking.adults_count = std::stoi(params.count("adults_count") ? params["adults_count"] : "1");
-            booking.children_count = std::stoi(params.count("children_count") ? params["children_count"] : "0");
             booking.special_requests = params.count("special_requests") ? params["special_requests"] : "";
+            if (!parse_int(room_id_str, booking.room_id) ||
+                !parse_guest_count(params.count("adults_count") ? params["adults_count"] : "1", 1, booking.adults_count) ||
+                !parse_guest_count(params.count("children_count") ? params["children_count"] : "0", 0, booking.children_count)) {
+                res.status = 400;
+                res.set_content(HtmlGenerator::booking_edit_form(db, booking_id, "Неверный номер или число гостей", booking, &ctx.user), HTML_CONTENT_TYPE);
+                return;
+            }
 
             if (booking.check_in_date.empty() || booking.check_out_date.empty()) {
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::booking_edit_form(db, booking_id, "Укажите даты заезда и выезда", booking, &user), "text/html; charset=utf-8");
+                res.set_content(HtmlGenerator::booking_edit_form(db, booking_id, "Укажите даты заезда и выезда", booking, &ctx.user), HTML_CONTENT_TYPE);
                 return;
             }
 
             if (!date_less(booking.check_in_date, booking.check_out_date)) {
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::booking_edit_form(db, booking_id, "Дата заезда должна быть раньше даты выезда", booking, &user), "text/html; charset=utf-8");
+                res.set_content(HtmlGenerator::booking_edit_form(db, booking_id, "Дата заезда должна быть раньше даты выезда", booking, &ctx.user), HTML_CONTENT_TYPE);
                 return;
             }
 
             // Пересчитываем стоимость
             Room new_room = db.get_room(booking.room_id);
             if (new_room.room_id == 0) {
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::booking_edit_form(db, booking_id, "Номер не найден", booking, &user), "text/html; charset=utf-8");
+                res.set_content(HtmlGenerator::booking_edit_form(db, booking_id, "Номер не найден", booking, &ctx.user), HTML_CONTENT_TYPE);
                 return;
             }
 
             // Проверка доступности номера (исключая текущее бронирование)
             if (!db.is_room_available(booking.room_id, booking.check_in_date, booking.check_out_date, booking_id)) {
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::booking_edit_form(db, booking_id, "Номер занят на выбранные даты", booking, &user), "text/html; charset=utf-8");
+                res.set_content(HtmlGenerator::booking_edit_form(db, booking_id, "Номер занят на выбранные даты", booking, &ctx.user), HTML_CONTENT_TYPE);
                 return;
             }
 
@@ -1159,80 +1496,433 @@ int main() {
 
             try {
                 db.update_booking(booking);
-                res.set_header("Location", "/hotels/" + std::to_string(hotel.hotel_id) + "/bookings/?updated=1");
-                res.status = 302;
+                redirect(res, "/hotels/" + std::to_string(hotel.hotel_id) + "/bookings/?updated=1");
             } catch (const std::exception& e) {
                 std::string error = "Ошибка при обновлении бронирования: " + std::string(e.what());
-                std::cerr << "[ERROR] " << get_current_datetime() << " - Failed to update booking: " << e.what() << std::endl;
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::booking_edit_form(db, booking_id, error, booking, &user), "text/html; charset=utf-8");
+                Logger::error("Failed to update booking", {{"error", e.what()}});
+                res.set_content(HtmlGenerator::booking_edit_form(db, booking_id, error, booking, &ctx.user), HTML_CONTENT_TYPE);
             }
         });
 
         // Мои бронирования (для пользователей)
-        svr.Get("/my-bookings/", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id == 0) {
-                res.set_header("Location", "/login/");
-                res.status = 302;
-                return;
-            }
-
+        router.get("/my-bookings/", Access::User, Cost::Heavy, [&db](RequestContext& ctx, const Request& req, Response& res) {
             std::string success = "";
             if (req.has_param("cancelled")) {
                 success = "Бронирование успешно отменено!";
             }
 
-            User user = db.get_user(user_id);
-            res.set_content(HtmlGenerator::user_bookings_list(db, user_id, "", success, &user), "text/html; charset=utf-8");
+            res.set_content(HtmlGenerator::user_bookings_list(db, ctx.user_id, "", success, &ctx.user), HTML_CONTENT_TYPE);
         });
 
         // Отмена бронирования
-        svr.Get(R"(/bookings/(\d+)/cancel/)", [&db](const Request& req, Response& res) {
-            int64_t user_id = get_user_id_from_session(req);
-            if (user_id == 0) {
-                res.set_header("Location", "/login/");
-                res.status = 302;
-                return;
-            }
-
-            int64_t booking_id = std::stoll(req.matches[1]);
+        router.get("/bookings/{booking_id}/cancel/", Access::User, [&db](RequestContext& ctx, const Request& req, Response& res) {
+            int64_t booking_id = ctx.param(0);
             Booking booking = db.get_booking(booking_id);
             if (booking.booking_id == 0) {
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>Бронирование не найдено</div>", "", &user), "text/html; charset=utf-8");
+                render_error(res, "Бронирование не найдено", &ctx.user);
                 return;
             }
 
             Guest guest = db.get_guest(booking.guest_id);
-            if (guest.user_id != user_id) {
-                User user = db.get_user(user_id);
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>Вы можете отменять только свои бронирования</div>", "", &user), "text/html; charset=utf-8");
+            if (guest.user_id != ctx.user_id) {
+                render_error(res, "Вы можете отменять только свои бронирования", &ctx.user);
                 return;
             }
 
             try {
                 db.delete_booking(booking_id);
-                res.set_header("Location", "/my-bookings/?cancelled=1");
-                res.status = 302;
+                redirect(res, "/my-bookings/?cancelled=1");
             } catch (const std::exception& e) {
-                std::cerr << "[ERROR] " << get_current_datetime() << " - Failed to delete booking: " << e.what() << std::endl;
-                User user = db.get_user(user_id);
-                std::string error = "Ошибка при отмене бронирования: " + std::string(e.what());
-                res.set_content(HtmlGenerator::base_template("Ошибка", "<div class='alert alert-danger'>" + error + "</div>", "", &user), "text/html; charset=utf-8");
+                Logger::error("Failed to delete booking", {{"error", e.what()}});
+                render_error(res, "Ошибка при отмене бронирования: " + std::string(e.what()), &ctx.user);
             }
         });
 
         // Контакты
-        svr.Get("/contact/", [&db, &get_user_from_session](const Request& req, Response& res) {
-            User user = get_user_from_session(req);
-            res.set_content(HtmlGenerator::contact_page(&user), "text/html; charset=utf-8");
+        router.get("/contact/", Access::Public, [](RequestContext& ctx, const Request& req, Response& res) {
+            res.set_content(HtmlGenerator::contact_page(&ctx.user), HTML_CONTENT_TYPE);
+        });
+
+        // JSON API: постраничные списки (?after=<id>&limit=<n>, ссылка на следующую страницу в "next")
+        // и отдельные записи; все ответы валидируются по ETag
+        router.get("/api/v1/hotels/", Access::User, Cost::Heavy, [&db, &conditional](RequestContext& ctx, const Request& req, Response& res) {
+            JsonGenerator::Page page;
+            if (!parse_api_page(req, res, page)) {
+                return;
+            }
+            send_json(conditional, req, res, JsonGenerator::hotels(db, page), false);
         });
 
-        std::cout << "Сервер запущен на http://localhost:8080" << std::endl;
+        router.get("/api/v1/hotels/{hotel_id}/", Access::User, [&db, &conditional](RequestContext& ctx, const Request& req, Response& res) {
+            Hotel hotel = db.get_hotel(ctx.param(0));
+            if (hotel.hotel_id == 0) {
+                render_json_error(res, 404, "hotel not found");
+                return;
+            }
+            send_json(conditional, req, res, JsonGenerator::hotel(hotel), false);
+        });
+
+        router.get("/api/v1/rooms/", Access::User, Cost::Heavy, [&db, &conditional](RequestContext& ctx, const Request& req, Response& res) {
+            JsonGenerator::Page page;
+            int64_t hotel_id = 0;
+            if (!parse_int_param(req, "hotel_id", hotel_id)) {
+                render_json_error(res, 400, "hotel_id must be a non-negative integer");
+                return;
+            }
+            if (!parse_api_page(req, res, page)) {
+                return;
+            }
+            send_json(conditional, req, res, JsonGenerator::rooms(db, hotel_id, page), false);
+        });
+
+        // Номер - как и HTML-страница номера, без входа; версия строки проверяется до выборки
+        router.get("/api/v1/rooms/{room_id}/", Access::Public, [&db, &conditional](RequestContext& ctx, const Request& req, Response& res) {
+            int64_t room_id = ctx.param(0);
+            PageVersion version = db.get_room_page_version(room_id);
+            if (!version.found) {
+                render_json_error(res, 404, "room not found");
+                return;
+            }
+            version.add(JsonGenerator::ETAG_SALT);
+            if (conditional.not_modified(req, res, version, false)) {
+                return;
+            }
+            res.set_content(JsonGenerator::room(db.get_room(room_id)), JSON_CONTENT_TYPE);
+        });
+
+        // Доступность зависит от чужих бронирований - ответ не кэшируется
+        router.get("/api/v1/rooms/{room_id}/availability/", Access::Public, [&db](RequestContext& ctx, const Request& req, Response& res) {
+            int64_t room_id = ctx.param(0);
+            std::string check_in = req.has_param("check_in") ? url_decode(req.get_param_value("check_in")) : "";
+            std::string check_out = req.has_param("check_out") ? url_decode(req.get_param_value("check_out")) : "";
+            if (!validate_date(check_in) || !validate_date(check_out) || !date_less(check_in, check_out)) {
+                render_json_error(res, 400, "check_in and check_out must be YYYY-MM-DD, check_in < check_out");
+                return;
+            }
+            if (db.get_room(room_id).room_id == 0) {
+                render_json_error(res, 404, "room not found");
+                return;
+            }
+            res.set_header("Cache-Control", "no-store");
+            if (db.is_room_available(room_id, check_in, check_out)) {
+                res.set_content(JsonGenerator::availability(room_id, check_in, check_out, true), JSON_CONTENT_TYPE);
+                return;
+            }
+            FreeWindows windows = db.find_free_windows(room_id, check_in, check_out, get_current_date());
+            res.set_content(JsonGenerator::availability(room_id, check_in, check_out, false, &windows), JSON_CONTENT_TYPE);
+        });
+
+        // Размещение в отеле по типу номера: свободные на весь срок номера или, если их нет,
+        // цепочка номеров с наименьшим числом переездов (?type=&check_in=&check_out=)
+        router.get("/api/v1/hotels/{hotel_id}/stays/", Access::Public, [&db](RequestContext& ctx, const Request& req, Response& res) {
+            int64_t hotel_id = ctx.param(0);
+            std::string type = req.has_param("type") ? url_decode(req.get_param_value("type")) : "";
+            std::string check_in = req.has_param("check_in") ? url_decode(req.get_param_value("check_in")) : "";
+            std::string check_out = req.has_param("check_out") ? url_decode(req.get_param_value("check_out")) : "";
+            int64_t in_day = 0;
+            int64_t out_day = 0;
+            if (type.empty() || !date_utils::parse_day(check_in, in_day) || !date_utils::parse_day(check_out, out_day) ||
+                in_day >= out_day || out_day - in_day > OccupancyCalendar::MAX_DAYS) {
+                render_json_error(res, 400, "type, check_in and check_out (YYYY-MM-DD, check_in < check_out, at most " +
+                                                std::to_string(OccupancyCalendar::MAX_DAYS) + " nights) are required");
+                return;
+            }
+            if (db.get_hotel(hotel_id).hotel_id == 0) {
+                render_json_error(res, 404, "hotel not found");
+                return;
+            }
+            res.set_header("Cache-Control", "no-store");
+            res.set_content(JsonGenerator::stay_options(db.find_stay_options(hotel_id, type, check_in, check_out)), JSON_CONTENT_TYPE);
+        });
+
+        // Пакетная проверка доступности: сотни пар (номер, даты) за один запрос и один проход по бронированиям
+        router.post("/api/v1/availability/", Access::Public, Cost::Heavy, [&db](RequestContext& ctx, const Request& req, Response& res) {
+            std::vector<AvailabilityQuery> queries;
+            try {
+                queries = parse_availability_queries(req.body);
+            } catch (const std::runtime_error& e) {
+                render_json_error(res, 400, e.what());
+                return;
+            }
+            res.set_header("Cache-Control", "no-store");
+            res.set_content(JsonGenerator::availability_batch(db.check_availability(queries)), JSON_CONTENT_TYPE);
+        });
+
+        // Журнал изменений: ?since=<seq> - записи после курсора, ?wait=<сек> - long-poll до первой записи,
+        // Accept: text/event-stream - поток SSE (курсор из Last-Event-ID при переподключении)
+        router.get("/api/v1/changes/", Access::Organization, [&db, &change_feed, &admission](RequestContext& ctx, const Request& req, Response& res) {
+            const int64_t MAX_WAIT_SECONDS = 30;
+            int64_t since = 0;
+            int64_t hotel_id = 0;
+            int64_t wait = 0;
+            int64_t limit = static_cast<int64_t>(JsonGenerator::Page::DEFAULT_LIMIT);
+            if (!parse_event_cursor(req, since) || !parse_int_param(req, "hotel_id", hotel_id) ||
+                !parse_int_param(req, "wait", wait) || !parse_int_param(req, "limit", limit) || limit == 0) {
+                render_json_error(res, 400, "since, hotel_id, wait and limit must be non-negative integers, limit > 0");
+                return;
+            }
+            if (hotel_id != 0 && !ctx.owns(db.get_hotel(hotel_id).organization_id)) {
+                render_json_error(res, 404, "hotel not found");
+                return;
+            }
+            size_t page = std::min(static_cast<size_t>(limit), JsonGenerator::Page::MAX_LIMIT);
+            bool sse = req.has_header("Accept") && req.get_header_value("Accept").find("text/event-stream") != std::string::npos;
+            res.set_header("Cache-Control", "no-store");
+
+            // Только отели организации: записи о гостях (hotel_id = NULL) сюда не попадают
+            int64_t organization_id = ctx.user_id;
+            auto fetch = [&db, organization_id, hotel_id, page](int64_t cursor) {
+                return hotel_id != 0 ? db.get_changes(cursor, page, hotel_id) : db.get_organization_changes(organization_id, cursor, page);
+            };
+            if (!sse && wait == 0) {
+                auto rows = fetch(since);
+                res.set_content(JsonGenerator::changes(rows, rows.empty() ? since : rows.back().seq), JSON_CONTENT_TYPE);
+                return;
+            }
+            auto lease = change_feed.acquire();
+            if (!lease) {
+                res.set_header("Retry-After", std::to_string(admission.retry_after()));
+                render_json_error(res, 503, "too many change subscribers");
+                return;
+            }
+
+            if (sse) {
+                stream_changes(res, change_feed, lease, since,
+                               fetch,
+                               [](const Change& change) { return sse_event(change.seq, "change", JsonGenerator::change(change)); });
+                return;
+            }
+
+            // Курсор seen берется до выборки: запись, появившаяся между ними, разбудит wait сразу
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(std::min(wait, MAX_WAIT_SECONDS));
+            for (;;) {
+                int64_t seen = change_feed.last();
+                auto rows = fetch(since);
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+                if (!rows.empty() || left.count() <= 0 || !change_feed.wait(seen, left)) {
+                    res.set_content(JsonGenerator::changes(rows, rows.empty() ? since : rows.back().seq), JSON_CONTENT_TYPE);
+                    return;
+                }
+            }
+        });
+
+        router.get("/api/v1/guests/", Access::User, Cost::Heavy, [&db, &conditional](RequestContext& ctx, const Request& req, Response& res) {
+            JsonGenerator::Page page;
+            if (!parse_api_page(req, res, page)) {
+                return;
+            }
+            send_json(conditional, req, res, JsonGenerator::guests(db, ctx.user_id, page), true);
+        });
+
+        router.get("/api/v1/guests/{guest_id}/", Access::User, [&db, &conditional](RequestContext& ctx, const Request& req, Response& res) {
+            int64_t guest_id = ctx.param(0);
+            PageVersion version = db.get_guest_page_version(guest_id);
+            if (!version.found || version.user_id != ctx.user_id) {
+                render_json_error(res, 404, "guest not found");
+                return;
+            }
+            version.add(JsonGenerator::ETAG_SALT);
+            if (conditional.not_modified(req, res, version, true)) {
+                return;
+            }
+            res.set_content(JsonGenerator::guest(db.get_guest(guest_id)), JSON_CONTENT_TYPE);
+        });
+
+        router.get("/api/v1/bookings/", Access::User, Cost::Heavy, [&db, &conditional](RequestContext& ctx, const Request& req, Response& res) {
+            JsonGenerator::Page page;
+            if (!parse_api_page(req, res, page)) {
+                return;
+            }
+            send_json(conditional, req, res, JsonGenerator::bookings(db, ctx.user_id, ctx.user.is_organization(), page), true);
+        });
+
+        router.get("/api/v1/bookings/{booking_id}/", Access::User, [&db, &conditional](RequestContext& ctx, const Request& req, Response& res) {
+            int64_t booking_id = ctx.param(0);
+            PageVersion version = db.get_booking_page_version(booking_id);
+            bool has_access = version.found &&
+                              (version.user_id == ctx.user_id || (ctx.user.is_organization() && ctx.owns(version.organization_id)));
+            if (!has_access) {
+                render_json_error(res, 404, "booking not found");
+                return;
+            }
+            version.add(JsonGenerator::ETAG_SALT);
+            if (conditional.not_modified(req, res, version, true)) {
+                return;
+            }
+            res.set_content(JsonGenerator::booking(db.get_booking(booking_id)), JSON_CONTENT_TYPE);
+        });
+
+        // Статические файлы: по хешированному URL кэшируются браузером навсегда
+        router.get("/static/*", Access::Static, [&static_assets](RequestContext& ctx, const Request& req, Response& res) {
+            if (!static_assets.serve(req, res)) {
+                res.status = 404;
+                res.set_content("Not found", "text/plain; charset=utf-8");
+            }
+        });
+
+        // Политики ограничения частоты для маршрутов записи
+        struct WriteLimit {
+            const char* pattern;
+            const char* name;
+            const std::string& spec;
+        };
+        const WriteLimit write_limits[] = {
+            {"/login/", "login", config.rate_login},
+            {"/register/", "register", config.rate_register},
+            {"/bookings/create/", "booking", config.rate_booking},
+            {"/guests/create/", "guest", config.rate_guest},
+        };
+        for (const auto& limit : write_limits) {
+            const Route* route = router.route("POST", limit.pattern);
+            if (!route) {
+                throw std::runtime_error(std::string("Rate limited route is not registered: ") + limit.pattern);
+            }
+            rate_policies[route] = rate_limiter.add_policy(RateLimiter::parse_policy(limit.name, limit.spec));
+        }
+        rate_limiter.start();
+
+        // Состояние сервера и очереди соединений
+        router.get("/admin/server/", Access::Local, [&config, queue_stats, &admission, &rate_limiter, &compression, &change_feed](RequestContext& ctx, const Request& req, Response& res) {
+            const TaskQueueStats& stats = *queue_stats;
+            std::vector<std::pair<std::string, std::string>> rows = {
+                {"Адрес", config.host + ":" + std::to_string(config.port)},
+                {"База данных", config.db_path},
+                {"Файл конфигурации", config.config_file.empty() ? "-" : config.config_file},
+                {"Рабочих потоков", std::to_string(stats.threads)},
+                {"Занято потоков", std::to_string(stats.active.load())},
+                {"Емкость очереди", std::to_string(stats.capacity)},
+                {"Соединений в очереди", std::to_string(stats.depth.load())},
+                {"Максимум в очереди", std::to_string(stats.peak_depth.load())},
+                {"Принято соединений", std::to_string(stats.accepted.load())},
+                {"Отклонено (очередь полна)", std::to_string(stats.rejected.load())},
+                {"Обслужено соединений", std::to_string(stats.completed.load())},
+                {"Keep-alive: запросов / таймаут", std::to_string(config.keep_alive_max_count) + " / " + std::to_string(config.keep_alive_timeout) + " с"},
+                {"Таймауты чтения / записи", std::to_string(config.read_timeout) + " / " + std::to_string(config.write_timeout) + " с"},
+                {"Максимальный размер тела", std::to_string(config.payload_max_length) + " байт"},
+            };
+            for (Cost cost : {Cost::Light, Cost::Heavy}) {
+                const auto& limits = admission.get_limits(cost);
+                const auto& counters = admission.get_stats(cost);
+                std::string name = cost == Cost::Heavy ? "Тяжелые страницы" : "Легкие страницы";
+                rows.push_back({name + ": лимит / срок очереди",
+                                (limits.max_concurrent ? std::to_string(limits.max_concurrent) : std::string("-")) + " / " +
+                                std::to_string(limits.max_queue_wait.count()) + " мс"});
+                rows.push_back({name + ": выполняется / максимум", std::to_string(counters.in_flight.load()) + " / " + std::to_string(counters.peak_in_flight.load())});
+                rows.push_back({name + ": принято", std::to_string(counters.admitted.load())});
+                rows.push_back({name + ": отклонено (лимит / срок)", std::to_string(counters.shed_concurrency.load()) + " / " + std::to_string(counters.shed_deadline.load())});
+            }
+            for (size_t i = 0; i < rate_limiter.policy_count(); ++i) {
+                const auto& policy = rate_limiter.get_policy(i);
+                const auto& counters = rate_limiter.get_stats(i);
+                rows.push_back({"Лимит записи " + policy.name + ": пропущено / отклонено",
+                                std::to_string(counters.allowed.load()) + " / " + std::to_string(counters.limited.load())});
+            }
+            rows.push_back({"Лимит записи: активных корзин / удалено", std::to_string(rate_limiter.bucket_count()) + " / " + std::to_string(rate_limiter.swept_count())});
+            rows.push_back({"Журнал: уровень", config.log_level});
+            for (LogLevel level : {LogLevel::Debug, LogLevel::Info, LogLevel::Warn, LogLevel::Error}) {
+                const Logger& logger = Logger::instance();
+                rows.push_back({std::string("Журнал ") + Logger::level_label(level) + ": записано / отброшено",
+                                std::to_string(logger.written_count(level)) + " / " + std::to_string(logger.dropped_count(level))});
+            }
+            const auto& gzip = compression.get_stats();
+            rows.push_back({"Сжатие: уровень / порог", compression.enabled()
+                ? std::to_string(compression.get_level()) + " / " + std::to_string(compression.get_min_size()) + " байт"
+                : std::string("выключено")});
+            rows.push_back({"Сжатие: ответов / пропущено (малый размер)", std::to_string(gzip.compressed.load()) + " / " + std::to_string(gzip.skipped_small.load())});
+            rows.push_back({"Сжатие: байт до / после", std::to_string(gzip.bytes_in.load()) + " / " + std::to_string(gzip.bytes_out.load())});
+            rows.push_back({"Сжатие: байт макета из готовых фрагментов", std::to_string(gzip.fragment_bytes.load())});
+            rows.push_back({"Журнал изменений: последний seq", std::to_string(change_feed.last())});
+            rows.push_back({"Журнал изменений: подписчиков / лимит / отказано",
+                            std::to_string(change_feed.get_waiters()) + " / " + std::to_string(change_feed.get_max_waiters()) + " / " +
+                            std::to_string(change_feed.get_stats().rejected.load())});
+            res.set_content(HtmlGenerator::admin_page("Состояние сервера", rows), HTML_CONTENT_TYPE);
+        });
+
+        // Профиль SQL-запросов, журнал медленных запросов и бюджет по маршрутам
+        router.get("/admin/queries/", Access::Local, [&profiler, &query_budget](RequestContext& ctx, const Request& req, Response& res) {
+            auto ms = [](uint64_t nanoseconds) {
+                std::ostringstream out;
+                out << std::fixed << std::setprecision(3) << nanoseconds / 1000000.0;
+                return out.str();
+            };
+            std::vector<HtmlGenerator::AdminTable> tables;
+
+            const auto& limits = query_budget.get_limits();
+            HtmlGenerator::AdminTable budget{"Бюджет на запрос: операторов " +
+                (limits.max_queries ? std::to_string(limits.max_queries) : std::string("-")) + ", повторов " +
+                (limits.max_repeats ? std::to_string(limits.max_repeats) : std::string("-")),
+                {"Маршрут", "Максимум операторов", "Превышений (всего)", "Превышений (повторы)"}, {}};
+            for (size_t i = 0; i < query_budget.route_count(); ++i) {
+                const auto& stats = query_budget.get_stats(i);
+                if (stats.peak_queries.load() == 0) continue;
+                budget.rows.push_back({query_budget.get_route_name(i), std::to_string(stats.peak_queries.load()),
+                                       std::to_string(stats.over_total.load()), std::to_string(stats.over_repeats.load())});
+            }
+            tables.push_back(std::move(budget));
+
+            std::string note = "Профилировщик выключен. Запустите сервер с --profile-queries=1.";
+            if (profiler) {
+                HtmlGenerator::AdminTable queries{"По формам запроса",
+                    {"Запрос", "Вызовов", "Всего, мс", "Среднее, мс", "Максимум, мс", "Строк", "Шагов полного сканирования", "Сортировок", "Автоиндексов", "Шагов VM", "Медленных"}, {}};
+                for (const auto& q : profiler->get_queries()) {
+                    queries.rows.push_back({q.sql, std::to_string(q.calls), ms(q.total_ns), ms(q.total_ns / q.calls), ms(q.max_ns),
+                                            std::to_string(q.rows), std::to_string(q.fullscan_steps), std::to_string(q.sorts),
+                                            std::to_string(q.autoindexes), std::to_string(q.vm_steps), std::to_string(q.slow)});
+                }
+                tables.push_back(std::move(queries));
+
+                HtmlGenerator::AdminTable slow{"Медленные запросы (последние " + std::to_string(QueryProfiler::SLOW_LOG_SIZE) + ")",
+                    {"Время", "Длительность, мс", "Строк", "Шагов полного сканирования", "Сортировок", "Запрос", "План"}, {}};
+                for (const auto& q : profiler->get_slow_log()) {
+                    slow.rows.push_back({q.time, ms(q.nanoseconds), std::to_string(q.rows), std::to_string(q.fullscan_steps),
+                                         std::to_string(q.sorts), q.sql, q.plan});
+                }
+                tables.push_back(std::move(slow));
+
+                note = "Порог медленного запроса: " +
+                    (profiler->slow_threshold_ms() ? std::to_string(profiler->slow_threshold_ms()) + " мс" : std::string("выключен"));
+            }
+            res.set_content(HtmlGenerator::admin_tables_page("SQL-запросы", note, tables), HTML_CONTENT_TYPE);
+        });
+
+        // Последние трассированные запросы в формате Chrome trace_event (chrome://tracing, Perfetto)
+        // Выгрузка может быть большой, поэтому отдается chunked-ответом со сжатием на лету
+        router.get("/admin/trace/", Access::Local, [&tracer, &compression](RequestContext& ctx, const Request& req, Response& res) {
+            size_t requests = 20;
+            if (req.has_param("requests")) {
+                try {
+                    requests = std::stoul(req.get_param_value("requests"));
+                } catch (const std::exception&) {
+                }
+            }
+            res.set_header("Content-Disposition", "attachment; filename=\"trace.json\"");
+            compression.stream(req, res, "application/json", [&tracer, requests](const std::function<bool(std::string_view)>& write) {
+                tracer.write_chrome_json(requests, write);
+            });
+        });
+
+        // Метрики в формате Prometheus
+        router.get("/metrics", Access::Local, [&metrics](RequestContext& ctx, const Request& req, Response& res) {
+            res.set_content(metrics.render(), "text/plain; version=0.0.4; charset=utf-8");
+        });
+
+        std::vector<std::string> route_names;
+        for (const auto& route : router.all_routes()) {
+            route_names.push_back(route->method + " " + route->pattern);
+        }
+        query_budget.set_route_names(route_names);
+        metrics.set_route_names(std::move(route_names));
+
+        router.attach(svr);
+
+        std::cout << "Сервер запущен на http://" << config.host << ":" << config.port
+                  << " (потоков: " << worker_threads << ", очередь: " << queue_capacity << ")" << std::endl;
         std::cout << "Нажмите Ctrl+C для остановки" << std::endl;
 
-        svr.listen("0.0.0.0", 8080);
+        if (!svr.listen(config.host, config.port)) {
+            std::cerr << "Ошибка: не удалось запустить сервер на " << config.host << ":" << config.port << std::endl;
+            return 1;
+        }
     } catch (const std::exception& e) {
         std::cerr << "Ошибка: " << e.what() << std::endl;
         return 1;
@@ -1240,4 +1930,3 @@ int main() {
 
     return 0;
 }
-